@@ -4,21 +4,54 @@
 // Abstract data type ImageClass is used to implement the image object.
 // Each image object of the imageClass can be compared with the overridden 
 // operator== and operator!= and copied using the operator= method. 
+// Pixels are kept in one contiguous, cache line aligned buffer that GIF
+// files are decoded into and encoded from directly.
 //---------------------------------------------------------------------------
 #include "ImageLib.h"
 #include "ImageClass.h"
+#include "gifCodec.h"
+#include "metrics.h"
+#include "pixelKernels.h"
+#include "rawImage.h"
+#include <cstring>
 #include <iostream>
 
 using namespace std;
 
+//---------------------------------------------------------------------------
+// imageClass()
+// Default constructor
+// Postcondition: Creates an empty 0 x 0 image with no pixels
+imageClass::imageClass()
+	: rows(0), cols(0), stride(0), pixels(nullptr), mapping(nullptr),
+	borrowed(false) {
+}
+
 //---------------------------------------------------------------------------
 // imageClass(filename)
 // Constructor with filename
 // Precondition: Uses filename as input to create inputImage object
 //				 Runs ImageLib to ReadGIF using filename
 // Postcondition: Changes current inputImage object to Image based on filename
-imageClass::imageClass(string filename) {
-	inputImage = ReadGIF(filename);
+//				  Rows are decoded straight into the pixel buffer, raw
+//				  image files are mapped in place instead
+imageClass::imageClass(string filename)
+	: rows(0), cols(0), stride(0), pixels(nullptr), mapping(nullptr),
+	borrowed(false) {
+	stageTimer timer(STAGE_READ);
+	rawImageHeader header;
+	if (readRawHeader(filename, header)) {
+		mapRaw(filename);
+		return;
+	}
+	gifDecoder decoder;
+	if (!decoder.open(filename)) {
+		return;
+	}
+	allocate(decoder.getRow(), decoder.getCol());
+	while (pixels != nullptr && decoder.hasRows()) {
+		decoder.readRow(rowSpan(decoder.nextRowIndex()));
+	}
 }
 
 
@@ -28,37 +61,97 @@ imageClass::imageClass(string filename) {
 // Precondition: Uses rows and columns as input to create a black image at 
 //				 that size 
 // Postcondition: Each pixel color value to 255 after creating a new
-//				  inputImage object. 
-imageClass::imageClass(int rows, int columns) {
-	if (rows > 0 && columns > 0) {
-		// Image Row & Column is flipped from the image library so I swapped 
-		inputImage = CreateImage(rows, columns);
-
-//		WriteGIF("output.gif", inputImage);
-//		cout << "Image created!" << endl;
-	} else {
-		cout << "invalid image size!" << endl;
-	}
+//				  inputImage object. The image is empty if rows or
+//				  columns is not positive.
+imageClass::imageClass(int rows, int columns)
+	: rows(0), cols(0), stride(0), pixels(nullptr), mapping(nullptr),
+	borrowed(false) {
+	allocate(rows, columns);
 }
 
 //---------------------------------------------------------------------------
 // imageClass(imageClass otherImage)
 // Copy constructor 
-// Precondition: Uses otherImage object and copies to current image using 
-//				 ImageLib's CopyImage method.
-// Postcondition: Creates deep copy of otherImage to current image
-imageClass::imageClass(imageClass const & otherImage) {
-	inputImage = CopyImage(otherImage.inputImage);  // Deep copy
-//	cout << "Image object copied" << endl;
+// Precondition: Uses otherImage object and copies to current image
+// Postcondition: Creates deep copy of otherImage to current image, a
+//				  copy of a view owns its pixels
+imageClass::imageClass(imageClass const & otherImage)
+	: rows(0), cols(0), stride(0), pixels(nullptr), mapping(nullptr),
+	borrowed(false) {
+	allocate(otherImage.rows, otherImage.cols);
+	if (pixels != nullptr) {
+		copyPixels(otherImage);  // Deep copy
+	}
+}
+
+//---------------------------------------------------------------------------
+// imageClass(imageClass &&otherImage)
+// Move constructor
+// Postcondition: Takes the pixels of otherImage without copying them,
+//				  otherImage is left empty
+imageClass::imageClass(imageClass &&otherImage) noexcept
+	: rows(otherImage.rows), cols(otherImage.cols),
+	stride(otherImage.stride), pixels(otherImage.pixels),
+	mapping(otherImage.mapping), borrowed(otherImage.borrowed) {
+	otherImage.rows = 0;
+	otherImage.cols = 0;
+	otherImage.stride = 0;
+	otherImage.pixels = nullptr;
+	otherImage.mapping = nullptr;
+	otherImage.borrowed = false;
+}
+
+//---------------------------------------------------------------------------
+// clone()
+// Precondition: no input
+// Postcondition: Returns a deep copy that owns its pixels, for the
+//				  places a copy is meant rather than a move
+imageClass imageClass::clone() const {
+	return imageClass(*this);
+}
+
+//---------------------------------------------------------------------------
+// view()
+// Precondition: the rectangle lies inside the image, which outlives
+//				 the view and is not resized while it is in use
+// Postcondition: Returns an image of the rectangle that shares these
+//				  pixels, so writes through either show in both. The
+//				  view is empty if the rectangle is not inside.
+imageClass imageClass::view(int top, int left, int rows, int columns) {
+	imageClass part;
+	if (top < 0 || left < 0 || rows <= 0 || columns <= 0 ||
+		top + rows > this->rows || left + columns > cols) {
+		return part;
+	}
+	part.rows = rows;
+	part.cols = columns;
+	part.stride = stride;
+	part.pixels = pixels + (size_t)top * stride + left;
+	part.borrowed = true;
+	return part;
+}
+
+//---------------------------------------------------------------------------
+// isView()
+// Postcondition: Returns true if the pixels belong to another image
+bool imageClass::isView() const {
+	return borrowed;
 }
 
 //---------------------------------------------------------------------------
 // getImage()
 // Image accessor
 // Precondition: Runs when called through the ImageClass object
-// Postcondition: Returns inputImage package
-image imageClass::getImage() {
-	return inputImage;
+// Postcondition: Returns a newly allocated ImageLib copy of the pixels,
+//				  the caller releases it with DeallocateImage
+image imageClass::getImage() const {
+	image legacy = CreateImage(rows, cols);
+	if (legacy.pixels != nullptr) {
+		for (int row = 0; row < rows; row++) {
+			memcpy(legacy.pixels[row], rowSpan(row), cols * sizeof(pixel));
+		}
+	}
+	return legacy;
 }
 
 //---------------------------------------------------------------------------
@@ -66,9 +159,8 @@ image imageClass::getImage() {
 // Pixel accessor
 // Precondition: Uses rows and columns as input
 // Postcondition: Returns inputImage pixel
-pixel imageClass::getPixel(int rows, int cols) {
-	pixel retPixel = inputImage.pixels[rows][cols];
-	return retPixel;
+pixel imageClass::getPixel(int rows, int cols) const {
+	return pixels[(size_t)rows * stride + cols];
 }
 
 //---------------------------------------------------------------------------
@@ -76,8 +168,8 @@ pixel imageClass::getPixel(int rows, int cols) {
 // Row accessor
 // Precondition: no input
 // Postcondition: Returns inputImage row
-int imageClass::getRow() {
-	return inputImage.rows;
+int imageClass::getRow() const {
+	return rows;
 }
 
 //---------------------------------------------------------------------------
@@ -85,8 +177,79 @@ int imageClass::getRow() {
 // Col accessor
 // Precondition: no input
 // Postcondition: Returns inputImage col
-int imageClass::getCol() {
-	return inputImage.cols;
+int imageClass::getCol() const {
+	return cols;
+}
+
+//---------------------------------------------------------------------------
+// getStride()
+// Precondition: no input
+// Postcondition: Returns the number of pixels from one row to the next,
+//				  rows are padded so each starts on a cache line
+int imageClass::getStride() const {
+	return stride;
+}
+
+//---------------------------------------------------------------------------
+// isMapped()
+// Postcondition: Returns true if the pixels are a mapping of a raw
+//				  image file rather than a buffer of their own
+bool imageClass::isMapped() const {
+	return mapping != nullptr;
+}
+
+//---------------------------------------------------------------------------
+// rowSpan()
+// Row accessor
+// Precondition: row is within the image
+// Postcondition: Returns the first of getCol() contiguous pixels of row
+pixel *imageClass::rowSpan(int row) {
+	return pixels + (size_t)row * stride;
+}
+
+const pixel *imageClass::rowSpan(int row) const {
+	return pixels + (size_t)row * stride;
+}
+
+//---------------------------------------------------------------------------
+// toPlanar()
+// Precondition: planes is any planarImage
+// Postcondition: planes is resized to this image and holds its red,
+//				  green and blue values in separate planes
+void imageClass::toPlanar(planarImage &planes) const {
+	planes.resize(rows, cols);
+	for (int row = 0; row < planes.getRow(); row++) {
+		const pixel *src = rowSpan(row);
+		byte *red = planes.row(0, row);
+		byte *green = planes.row(1, row);
+		byte *blue = planes.row(2, row);
+		for (int col = 0; col < cols; col++) {
+			red[col] = src[col].red;
+			green[col] = src[col].green;
+			blue[col] = src[col].blue;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// fromPlanar()
+// Precondition: planes has the same size as this image
+// Postcondition: Pixels are set from the red, green and blue planes
+void imageClass::fromPlanar(const planarImage &planes) {
+	if (planes.getRow() != rows || planes.getCol() != cols) {
+		return;
+	}
+	for (int row = 0; row < rows; row++) {
+		pixel *dst = rowSpan(row);
+		const byte *red = planes.row(0, row);
+		const byte *green = planes.row(1, row);
+		const byte *blue = planes.row(2, row);
+		for (int col = 0; col < cols; col++) {
+			dst[col].red = red[col];
+			dst[col].green = green[col];
+			dst[col].blue = blue[col];
+		}
+	}
 }
 
 //---------------------------------------------------------------------------
@@ -95,8 +258,10 @@ int imageClass::getCol() {
 // Precondition: Uses rows, columns, red color value, green color value, blue
 //				 color value as input.
 // Postcondition: Sets current image pixel colors individually
-void imageClass::setPixel(int rows, int cols, int red, int green, int blue) {
-	if (rows >= 0 && cols >= 0) {
+//				  Returns false and changes nothing if the pixel is
+//				  outside the image
+bool imageClass::setPixel(int rows, int cols, int red, int green, int blue) {
+	if (rows >= 0 && cols >= 0 && rows < this->rows && cols < this->cols) {
 		// Red overflow & underflow check
 		if (red > 255) {
 			red = 255;
@@ -122,13 +287,13 @@ void imageClass::setPixel(int rows, int cols, int red, int green, int blue) {
 		}
 
 		// Set color values
-		inputImage.pixels[rows][cols].red = red;
-		inputImage.pixels[rows][cols].green = green;
-		inputImage.pixels[rows][cols].blue = blue;
-	}
-	else {
-		cout << "unable to set pixel." << endl;
+		pixel &target = pixels[(size_t)rows * stride + cols];
+		target.red = red;
+		target.green = green;
+		target.blue = blue;
+		return true;
 	}
+	return false;
 }
 
 
@@ -139,13 +304,43 @@ void imageClass::setPixel(int rows, int cols, int red, int green, int blue) {
 // Precondition: Uses another imageClass object to copy the image to the
 //				 existing image.
 // Postcondition: Returns the modified current imageClass copied 
-//				  from the other image. 
+//				  from the other image. A view of the same size is
+//				  written through, so its parent changes too.
 imageClass& imageClass::operator=(const imageClass & otherImage) {
 	if (this != &otherImage) {
-		DeallocateImage(inputImage);
-		inputImage = CopyImage(otherImage.inputImage);
+		if (rows != otherImage.rows || cols != otherImage.cols) {
+			release();
+			allocate(otherImage.rows, otherImage.cols);
+		}
+		if (pixels != nullptr) {
+			copyPixels(otherImage);
+		}
+	}
+	return *this;
+}
+
+//---------------------------------------------------------------------------
+// operator= (move)
+// Precondition: Uses another imageClass object to take the pixels of
+// Postcondition: The current pixels are released and those of
+//				  otherImage taken without copying, otherImage is left
+//				  empty
+imageClass& imageClass::operator=(imageClass &&otherImage) noexcept {
+	if (this != &otherImage) {
+		release();
+		rows = otherImage.rows;
+		cols = otherImage.cols;
+		stride = otherImage.stride;
+		pixels = otherImage.pixels;
+		mapping = otherImage.mapping;
+		borrowed = otherImage.borrowed;
+		otherImage.rows = 0;
+		otherImage.cols = 0;
+		otherImage.stride = 0;
+		otherImage.pixels = nullptr;
+		otherImage.mapping = nullptr;
+		otherImage.borrowed = false;
 	}
-	cout << "Current image copied to existing image" << endl;
 	return *this;
 }
 
@@ -158,23 +353,14 @@ imageClass& imageClass::operator=(const imageClass & otherImage) {
 //				  with the pixel of the otherImage
 //				  Returns true if both are the same, else false
 bool imageClass::operator==(const imageClass & otherImage) const {
-	int columnsInput = otherImage.inputImage.cols;
-	int rowsInput = otherImage.inputImage.rows;
-	for (int row = 0; row < rowsInput; row++) {
-		for (int col = 0; col < columnsInput; col++) {
-			if (inputImage.pixels[row][col].red != 
-				otherImage.inputImage.pixels[row][col].red ||
-				inputImage.pixels[row][col].blue != 
-				otherImage.inputImage.pixels[row][col].blue ||
-				inputImage.pixels[row][col].green != 
-				otherImage.inputImage.pixels[row][col].green) {
-				cout << "Images are different" << endl;
-				return false;
-			}
-			
+	if (rows != otherImage.rows || cols != otherImage.cols) {
+		return false;
+	}
+	for (int row = 0; row < rows; row++) {
+		if (!pixelsEqual(rowSpan(row), otherImage.rowSpan(row), cols)) {
+			return false;
 		}
 	}
-	cout << "Images the same" << endl;
 	return true;
 }
 
@@ -196,8 +382,8 @@ bool imageClass::operator!=(const imageClass & otherImage) const {
 // Postcondition: Returns rows and columns
 ostream & operator<<(ostream & output, const imageClass & otherImage) {
 	// Image Row & Column is flipped from the image library so I swapped 
-	output << "rows: " << otherImage.inputImage.cols << " columns: "
-		<< otherImage.inputImage.rows << endl;
+	output << "rows: " << otherImage.cols << " columns: "
+		<< otherImage.rows << endl;
 	return output;
 }
 
@@ -207,8 +393,7 @@ ostream & operator<<(ostream & output, const imageClass & otherImage) {
 // Precondition: Runs through a ImageClass object
 // Postcondition: Deallocates image from memory
 imageClass::~imageClass() {
-//	cout << "Deallocating image" << endl;
-	DeallocateImage(inputImage);
+	release();
 }
 
 //---------------------------------------------------------------------------
@@ -218,24 +403,18 @@ imageClass::~imageClass() {
 // Postcondition: 
 //				Returns a counter based on the number of 
 //				different pixels betweeen the two images.
-int imageClass:: compareImage(imageClass otherImage) {
+int imageClass::compareImage(const imageClass & otherImage) const {
 	int counter = 0;
 
 	// Different sized images
-	if (inputImage.rows != otherImage.inputImage.rows || 
-		inputImage.cols != otherImage.inputImage.cols) {
-		return NULL;
+	if (rows != otherImage.rows || cols != otherImage.cols) {
+		return 0;
 	}
 
-	for (int row = 0; row < inputImage.rows; row++) {
-		for (int col = 0; col < inputImage.cols; col++) {
-			// Increase counter if pixel is different colored
-			if (getPixel(row, col).blue != otherImage.getPixel(row, col).blue ||
-				getPixel(row, col).red != otherImage.getPixel(row, col).red ||
-				getPixel(row, col).green != otherImage.getPixel(row, col).green) {
-				counter++;
-			}
-		}
+	// Increase counter for every differently colored pixel
+	for (int row = 0; row < rows; row++) {
+		counter += (int)countPixelDifferences(rowSpan(row),
+			otherImage.rowSpan(row), cols);
 	}
 	return counter;
 }
@@ -245,16 +424,15 @@ int imageClass:: compareImage(imageClass otherImage) {
 // Precondition: Use another imageClass object to create photonegative
 //				 valid imageClass object used
 // Postcondition: Returns new photonegative imageClass object
-imageClass imageClass:: photoNegative() {
-	imageClass negImage(*this); // Duplicate imageClass object
-	for (int row = 0; row < inputImage.rows; row++) {
-		for (int col = 0; col < inputImage.cols; col++) {
-			// Column modulus 9 + red pixel value
-			// Blue pixel value - row modulus 7
-			setPixel(row, col, (int)(255-getPixel(row, col).red),
-				(int)(255-getPixel(row, col).green),
-				(int)(255-getPixel(row, col).blue));
-		}
+//				  Each row is negated straight from this image into the new
+//				  one, so the pixels are only read once.
+imageClass imageClass::photoNegative() const {
+	if (pixels == nullptr) {
+		return imageClass();
+	}
+	imageClass negImage(rows, cols);
+	for (int row = 0; row < rows; row++) {
+		negatePixels(rowSpan(row), negImage.rowSpan(row), cols);
 	}
 	return negImage;
 }
@@ -264,5 +442,91 @@ imageClass imageClass:: photoNegative() {
 // Precondition: Filename as a string is used as input
 // Postcondition: Writes a GIF using the image library
 void imageClass::createGIF(string filename) {
-	WriteGIF(filename,inputImage);
+	if (pixels == nullptr) {
+		return;
+	}
+	writeGIFRows(filename, rows, cols,
+		[this](int row) { return rowSpan(row); });
+}
+
+//---------------------------------------------------------------------------
+// allocate()
+// Precondition: rows and columns are greater than or equal to 0
+// Postcondition: Owns a zero filled buffer of that size
+void imageClass::allocate(int rows, int columns) {
+	if (rows <= 0 || columns <= 0) {
+		return;
+	}
+	int newStride = rowStride(columns, sizeof(pixel));
+	pixels = static_cast<pixel *>(
+		alignedAlloc((size_t)rows * newStride * sizeof(pixel)));
+	if (pixels != nullptr) {
+		this->rows = rows;
+		cols = columns;
+		stride = newStride;
+	}
+}
+
+//---------------------------------------------------------------------------
+// mapRaw()
+// Precondition: The image is empty, filename is a raw image file
+// Postcondition: Pixels point into a private mapping of the file,
+//				  the image stays empty if it can not be mapped
+void imageClass::mapRaw(const string &filename) {
+	rawImageHeader header;
+	mappedFile *file = new mappedFile;
+	// the header is read again from the mapping itself, the file may have
+	// been replaced since it was first checked
+	if (!file->open(filename) || file->size() < sizeof(header)) {
+		delete file;
+		return;
+	}
+	memcpy(&header, file->data(), sizeof(header));
+	if (!validRawHeader(header) || file->size() < header.headerSize ||
+		file->size() - header.headerSize < header.dataSize) {
+		delete file;
+		return;
+	}
+	mapping = file;
+	pixels = reinterpret_cast<pixel *>(file->data() + header.headerSize);
+	rows = (int)header.rows;
+	cols = (int)header.cols;
+	stride = (int)header.stride;
+}
+
+//---------------------------------------------------------------------------
+// copyPixels()
+// Precondition: otherImage has the same size as this image and the
+//				 two do not share pixels
+// Postcondition: The pixels of otherImage are copied row by row, in
+//				  one block when this image owns the padding between rows
+void imageClass::copyPixels(const imageClass &otherImage) {
+	// the padding of a view is pixels of its parent, and must not be
+	// written
+	if (stride == otherImage.stride && !borrowed) {
+		memcpy(pixels, otherImage.pixels,
+			((size_t)(rows - 1) * stride + cols) * sizeof(pixel));
+		return;
+	}
+	for (int row = 0; row < rows; row++) {
+		memcpy(rowSpan(row), otherImage.rowSpan(row), cols * sizeof(pixel));
+	}
+}
+
+//---------------------------------------------------------------------------
+// release()
+// Postcondition: Frees or unmaps the pixels and sets the size to 0 x 0,
+//				  a view only lets go of them
+void imageClass::release() {
+	if (mapping != nullptr) {
+		delete mapping;
+		mapping = nullptr;
+	} else if (!borrowed) {
+		alignedFree(pixels);
+	}
+	borrowed = false;
+	pixels = nullptr;
+	rows = 0;
+	cols = 0;
+	stride = 0;
 }
@@ -10,10 +10,13 @@
 
 #pragma once
 #include "ImageLib.h"
+#include "pixelBuffer.h"
 #include <iostream>
 
 using namespace std;
 
+class mappedFile;
+
 class imageClass {
 	// Overloaded <<
 	// Output stream, displays rows and columns of the image object
@@ -23,11 +26,18 @@ class imageClass {
 
 public:
 
+	// imageClass()
+	// Default constructor
+	// Postcondition: Creates an empty 0 x 0 image with no pixels
+	imageClass();
+
 	// imageClass(filename)
 	// Constructor with filename
 	// Precondition: Uses filename as input to create inputImage object
 	//				 Runs ImageLib to ReadGIF using filename
 	// Postcondition: Changes current inputImage object to Image based on filename
+	//				  Raw image files (see rawImage.h) are mapped in place
+	//				  instead of decoded, the file is never written to
 	imageClass(string filename);
 
 	// imageClass(rows & columns)
@@ -35,47 +45,113 @@ public:
 	// Precondition: Uses rows and columns as input to create a black image at 
 	//				 that size 
 	// Postcondition: Each pixel color value to 255 after creating a new
-	//				  inputImage object. 
+	//				  inputImage object. The image is empty if rows or
+	//				  columns is not positive.
 	imageClass(int rows, int columns);
 
 	// imageClass(imageClass otherImage)
 	// Copy constructor 
 	// Precondition: Uses otherImage object and copies to current image using 
 	//				 ImageLib's CopyImage method.
-	// Postcondition: Creates deep copy of otherImage to current image
+	// Postcondition: Creates deep copy of otherImage to current image, a
+	//				  copy of a view owns its pixels
 	imageClass(imageClass const & otherImage);
 
+	// imageClass(imageClass &&otherImage)
+	// Move constructor
+	// Postcondition: Takes the pixels of otherImage without copying them,
+	//				  otherImage is left empty
+	imageClass(imageClass &&otherImage) noexcept;
+
+	// clone()
+	// Precondition: no input
+	// Postcondition: Returns a deep copy that owns its pixels, for the
+	//				  places a copy is meant rather than a move
+	imageClass clone() const;
+
+	// view()
+	// Precondition: the rectangle lies inside the image, which outlives
+	//				 the view and is not resized while it is in use
+	// Postcondition: Returns an image of the rectangle that shares these
+	//				  pixels, so writes through either show in both. The
+	//				  view is empty if the rectangle is not inside.
+	imageClass view(int top, int left, int rows, int columns);
+
+	// isView()
+	// Postcondition: Returns true if the pixels belong to another image
+	bool isView() const;
+
 	// getImage()
 	// Image accessor
 	// Precondition: Runs when called through the ImageClass object
-	// Postcondition: Returns inputImage package
-	image getImage();
+	// Postcondition: Returns a newly allocated ImageLib copy of the pixels,
+	//				  the caller releases it with DeallocateImage
+	image getImage() const;
 
 	// getPixel()
 	// Pixel accessor
 	// Precondition: Uses rows and columns as input
 	// Postcondition: Returns inputImage pixel
-	pixel getPixel(int rows, int cols);
+	pixel getPixel(int rows, int cols) const;
+
+	int getRow() const;
+
+	int getCol() const;
 
-	int getRow();
+	// getStride()
+	// Precondition: no input
+	// Postcondition: Returns the number of pixels from one row to the next,
+	//				  rows are padded so each starts on a cache line
+	int getStride() const;
 
-	int getCol();
+	// isMapped()
+	// Postcondition: Returns true if the pixels are a mapping of a raw
+	//				  image file rather than a buffer of their own
+	bool isMapped() const;
+
+	// rowSpan()
+	// Row accessor
+	// Precondition: row is within the image
+	// Postcondition: Returns the first of getCol() contiguous pixels of row
+	pixel *rowSpan(int row);
+	const pixel *rowSpan(int row) const;
+
+	// toPlanar()
+	// Precondition: planes is any planarImage
+	// Postcondition: planes is resized to this image and holds its red,
+	//				  green and blue values in separate planes
+	void toPlanar(planarImage &planes) const;
+
+	// fromPlanar()
+	// Precondition: planes has the same size as this image
+	// Postcondition: Pixels are set from the red, green and blue planes
+	void fromPlanar(const planarImage &planes);
 
 	// setPixel()
 	// Pixel mutator
 	// Precondition: Uses rows, columns, red color value, green color value, blue
 	//				 color value as input.
 	// Postcondition: Sets current image pixel colors individually
-	void setPixel(int rows, int cols, int red, int green, int blue);
+	//				  Returns false and changes nothing if the pixel is
+	//				  outside the image
+	bool setPixel(int rows, int cols, int red, int green, int blue);
 
 	// operator=
 	// Copies otherImage to current image
 	// Precondition: Uses another imageClass object to copy the image to the
 	//				 existing image.
 	// Postcondition: Returns the modified current imageClass copied 
-	//				  from the other image. 
+	//				  from the other image. A view of the same size is
+	//				  written through, so its parent changes too.
 	imageClass& operator=(const imageClass & otherImage);
 
+	// operator= (move)
+	// Precondition: Uses another imageClass object to take the pixels of
+	// Postcondition: The current pixels are released and those of
+	//				  otherImage taken without copying, otherImage is left
+	//				  empty
+	imageClass& operator=(imageClass &&otherImage) noexcept;
+
 	// operator==
 	// Boolean comparison with current object and other object
 	// Precondition: Uses another imageClass object to compare the image to the
@@ -103,16 +179,44 @@ public:
 	// Postcondition: 
 	//				Returns a counter based on the number of 
 	//				different pixels betweeen the two images.
-	int compareImage(imageClass otherImage);
+	int compareImage(const imageClass & otherImage) const;
 
 	// photoNegative()
 	// Precondition: Use another imageClass object to create photonegative
 	//				 valid imageClass object used
 	// Postcondition: Returns new photonegative imageClass object
-	imageClass photoNegative();
+	imageClass photoNegative() const;
 
 	void createGIF(string filename);
 
 private:
-	image inputImage;
+	int rows;
+	int cols;
+	int stride;		// pixels from the start of one row to the next
+	pixel *pixels;	// rows * stride pixels, aligned to BUFFER_ALIGNMENT
+	mappedFile *mapping;	// file the pixels belong to, or nullptr
+	bool borrowed;	// pixels belong to another image
+
+	// allocate()
+	// Precondition: rows and columns are greater than or equal to 0
+	// Postcondition: Owns a zero filled buffer of that size
+	void allocate(int rows, int columns);
+
+	// mapRaw()
+	// Precondition: The image is empty, filename is a raw image file
+	// Postcondition: Pixels point into a private mapping of the file,
+	//				  the image stays empty if it can not be mapped
+	void mapRaw(const string &filename);
+
+	// copyPixels()
+	// Precondition: otherImage has the same size as this image and the
+	//				 two do not share pixels
+	// Postcondition: The pixels of otherImage are copied row by row, in
+	//				  one block when this image owns the padding between rows
+	void copyPixels(const imageClass &otherImage);
+
+	// release()
+	// Postcondition: Frees or unmaps the pixels and sets the size to 0 x 0,
+	//				  a view only lets go of them
+	void release();
 };
@@ -0,0 +1,107 @@
+// ImageLib.cpp
+// Author: Terence Ho
+//
+// In-tree implementation of the ImageLib interface described in ImageLib.h,
+// replacing the prebuilt Windows ImageLib.lib. GIF files are read and
+// written with gifCodec. An image keeps one block of pixels with the row
+// pointers pointing into it, so pixels[i][j] works as before.
+//---------------------------------------------------------------------------
+#include "ImageLib.h"
+#include "gifCodec.h"
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// ReadGIF()
+// Preconditions:  filename refers to a file that stores a GIF image.
+// Postconditions: returns the image contained in "filename", or an image
+//			with rows = 0, cols = 0, pixels = nullptr if it can not be read.
+image ReadGIF(string filename) {
+	gifDecoder decoder;
+	if (!decoder.open(filename)) {
+		return CreateImage(0, 0);
+	}
+	image result = CreateImage(decoder.getRow(), decoder.getCol());
+	while (result.pixels != nullptr && decoder.hasRows()) {
+		decoder.readRow(result.pixels[decoder.nextRowIndex()]);
+	}
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// WriteGIF()
+// Preconditions:  filename is valid filename to store a GIF image.
+//		   inputImage holds an image.
+// Postconditions: inputImage is saved as a GIF image at filename.
+void WriteGIF(string filename, image inputImage) {
+	if (inputImage.pixels == nullptr) {
+		return;
+	}
+	writeGIFRows(filename, inputImage.rows, inputImage.cols,
+		[&inputImage](int row) { return inputImage.pixels[row]; });
+}
+
+//---------------------------------------------------------------------------
+// DeallocateImage()
+// Preconditions:  inputImage was made by CreateImage, CopyImage or ReadGIF.
+// Postconditions: the pixels are deallocated and the image is set to
+//			rows = 0, cols = 0, pixels = nullptr.
+void DeallocateImage(image &inputImage) {
+	if (inputImage.pixels != nullptr) {
+		delete[] inputImage.pixels[0];
+		delete[] inputImage.pixels;
+	}
+	inputImage.rows = 0;
+	inputImage.cols = 0;
+	inputImage.pixels = nullptr;
+}
+
+//---------------------------------------------------------------------------
+// CopyImage()
+// Preconditions:  inputImage holds an image.
+// Postconditions: returns a copy of inputImage in newly allocated memory,
+//			or an empty image if there is not enough memory.
+image CopyImage(image inputImage) {
+	image result = CreateImage(inputImage.rows, inputImage.cols);
+	if (result.pixels != nullptr) {
+		for (int row = 0; row < result.rows; row++) {
+			memcpy(result.pixels[row], inputImage.pixels[row],
+				result.cols * sizeof(pixel));
+		}
+	}
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// CreateImage()
+// Preconditions:  rows and cols describe the desired size of the new image.
+// Postconditions: returns a black image of that size in newly allocated
+//			memory, or an empty image if the size is not positive or there
+//			is not enough memory.
+image CreateImage(int rows, int cols) {
+	image result;
+	result.rows = 0;
+	result.cols = 0;
+	result.pixels = nullptr;
+	if (rows <= 0 || cols <= 0) {
+		return result;
+	}
+
+	pixel **rowPointers = new (nothrow) pixel *[rows];
+	pixel *block = new (nothrow) pixel[(size_t)rows * cols];
+	if (rowPointers == nullptr || block == nullptr) {
+		delete[] rowPointers;
+		delete[] block;
+		return result;
+	}
+	memset(block, 0, (size_t)rows * cols * sizeof(pixel));
+	for (int row = 0; row < rows; row++) {
+		rowPointers[row] = block + (size_t)row * cols;
+	}
+	result.rows = rows;
+	result.cols = cols;
+	result.pixels = rowPointers;
+	return result;
+}
@@ -0,0 +1,393 @@
+// batchSegment.cpp
+// Author: Terence Ho
+//
+// Batch pipeline over a shared thread pool. Decode workers take the next
+// input by index, segment workers label the image and render the region
+// colours into a new image, and encode workers write it out. Each image
+// carries its own timings through the queues, and the encode stage adds
+// them to the report once the image is written.
+//---------------------------------------------------------------------------
+#include "batchSegment.h"
+#include "ImageClass.h"
+#include "boundedQueue.h"
+#include "gifCodec.h"
+#include "threadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock batchClock;
+
+// One image on its way through the pipeline
+struct batchItem {
+	size_t index;					// position in the input list
+	imageClass image;				// decoded input, then rendered output
+	batchClock::time_point start;
+	double decodeMs;
+	double segmentMs;
+	uint64_t regions;
+};
+
+//----------------------------------------------------------------------------
+// elapsedMs()
+// Postcondition: Returns the milliseconds from start until now
+double elapsedMs(batchClock::time_point start) {
+	return chrono::duration<double, milli>(batchClock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------
+// percentiles()
+// Precondition: samples holds one latency per image
+// Postcondition: Returns the nearest-rank percentiles of samples, all 0
+//				  if there are none
+stageLatency percentiles(vector<double> &samples) {
+	stageLatency latency = { 0, 0, 0, 0 };
+	if (samples.empty()) {
+		return latency;
+	}
+	sort(samples.begin(), samples.end());
+	auto rank = [&samples](double fraction) {
+		size_t index = (size_t)(fraction * samples.size() + 0.999999);
+		return samples[index == 0 ? 0 : index - 1];
+	};
+	latency.p50 = rank(0.50);
+	latency.p90 = rank(0.90);
+	latency.p99 = rank(0.99);
+	latency.max = samples.back();
+	return latency;
+}
+
+//----------------------------------------------------------------------------
+// fileSize()
+// Postcondition: Returns the size of the file in bytes, 0 if it is missing
+uint64_t fileSize(const string &filename) {
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return 0;
+	}
+	return (uint64_t)info.st_size;
+}
+
+//----------------------------------------------------------------------------
+// fileIdentity()
+// Postcondition: Returns true and sets identity to the device and file
+//				  number of path if it exists. Two paths with the same
+//				  identity are one file however they are spelled.
+bool fileIdentity(const string &path, pair<uint64_t, uint64_t> &identity) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), 0,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	BY_HANDLE_FILE_INFORMATION info;
+	bool found = GetFileInformationByHandle(file, &info) != 0;
+	CloseHandle(file);
+	if (!found) {
+		return false;
+	}
+	identity.first = info.dwVolumeSerialNumber;
+	identity.second = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) {
+		return false;
+	}
+	identity.first = (uint64_t)info.st_dev;
+	identity.second = (uint64_t)info.st_ino;
+#endif
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// isDirectory()
+// Postcondition: Returns true if path names a directory
+bool isDirectory(const string &path) {
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR) != 0;
+}
+
+//----------------------------------------------------------------------------
+// isImageName()
+// Postcondition: Returns true if name ends in .gif or .raw in any case
+bool isImageName(const string &name) {
+	if (name.size() < 4) {
+		return false;
+	}
+	string extension = name.substr(name.size() - 4);
+	for (char &letter : extension) {
+		letter = (char)tolower((unsigned char)letter);
+	}
+	return extension == ".gif" || extension == ".raw";
+}
+
+//----------------------------------------------------------------------------
+// listDirectory()
+// Precondition: path names a directory
+// Postcondition: Adds the image files directly inside it to names
+bool listDirectory(const string &path, vector<string> &names) {
+#ifdef _WIN32
+	WIN32_FIND_DATAA entry;
+	HANDLE search = FindFirstFileA((path + "\\*").c_str(), &entry);
+	if (search == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	do {
+		if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 &&
+			isImageName(entry.cFileName)) {
+			names.push_back(path + "/" + entry.cFileName);
+		}
+	} while (FindNextFileA(search, &entry));
+	FindClose(search);
+#else
+	DIR *directory = opendir(path.c_str());
+	if (directory == nullptr) {
+		return false;
+	}
+	while (dirent *entry = readdir(directory)) {
+		string name = path + "/" + entry->d_name;
+		if (isImageName(entry->d_name) && !isDirectory(name)) {
+			names.push_back(name);
+		}
+	}
+	closedir(directory);
+#endif
+	return true;
+}
+
+}
+
+//----------------------------------------------------------------------------
+// listInputs()
+// Precondition: path is a file, a directory, or @ followed by a file
+//				 that lists one path per line
+// Postcondition: Adds the images path names to inputs. Directories give
+//				  their .gif and .raw files in name order.
+//				  Returns false if path can not be read.
+bool listInputs(const string &path, vector<string> &inputs) {
+	if (!path.empty() && path[0] == '@') {
+		ifstream list(path.substr(1));
+		if (!list) {
+			return false;
+		}
+		string line;
+		while (getline(list, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (!line.empty()) {
+				inputs.push_back(line);
+			}
+		}
+		return true;
+	}
+	if (isDirectory(path)) {
+		vector<string> names;
+		if (!listDirectory(path, names)) {
+			return false;
+		}
+		sort(names.begin(), names.end());
+		inputs.insert(inputs.end(), names.begin(), names.end());
+		return true;
+	}
+	inputs.push_back(path);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// outputName()
+// Precondition: input is an image path
+// Postcondition: Returns the path in outputDir of the GIF written for input,
+//				  the name of input with its extension replaced by .gif
+string outputName(const string &input, const string &outputDir) {
+	size_t slash = input.find_last_of("/\\");
+	string name = slash == string::npos ? input : input.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	if (dot != string::npos && dot > 0) {
+		name = name.substr(0, dot);
+	}
+	if (outputDir.empty()) {
+		return name + ".gif";
+	}
+	char last = outputDir.back();
+	return outputDir + (last == '/' || last == '\\' ? "" : "/") + name + ".gif";
+}
+
+//----------------------------------------------------------------------------
+// runBatch()
+// Precondition: options.outputDir exists, the worker counts and queue
+//				 depth are greater than 0
+// Postcondition: Every input is segmented and rendered with the average
+//				  colour of its regions into outputDir. An image whose
+//				  output would replace one of the inputs is failed instead.
+//				  Returns the throughput and latency of the batch.
+batchReport runBatch(const batchOptions &options) {
+	const int decoders = max(1, options.decodeWorkers);
+	const int segmenters = max(1, options.segmentWorkers);
+	const int encoders = max(1, options.encodeWorkers);
+	const vector<string> &inputs = options.inputs;
+
+	// inputs with the same name in different directories get numbered
+	// outputs instead of overwriting each other
+	vector<string> outputs;
+	set<string> taken;
+	for (size_t index = 0; index < inputs.size(); index++) {
+		string name = outputName(inputs[index], options.outputDir);
+		for (int copy = 2; taken.count(name) != 0; copy++) {
+			name = outputName(inputs[index], options.outputDir);
+			name.insert(name.size() - 4, "_" + to_string(copy));
+		}
+		taken.insert(name);
+		outputs.push_back(name);
+	}
+
+	// an output that is already one of the inputs, under whatever path,
+	// is never written, so no input is lost before or after it is read
+	set<pair<uint64_t, uint64_t>> inputFiles;
+	pair<uint64_t, uint64_t> identity;
+	for (const string &input : inputs) {
+		if (fileIdentity(input, identity)) {
+			inputFiles.insert(identity);
+		}
+	}
+	vector<bool> overwritesInput(inputs.size(), false);
+	for (size_t index = 0; index < outputs.size(); index++) {
+		overwritesInput[index] = fileIdentity(outputs[index], identity) &&
+			inputFiles.count(identity) != 0;
+	}
+
+	batchReport report;
+	report.images = 0;
+	report.inputBytes = 0;
+	report.pixels = 0;
+	report.regions = 0;
+	vector<double> decodeMs;
+	vector<double> segmentMs;
+	vector<double> encodeMs;
+	vector<double> totalMs;
+	mutex reportLock;
+
+	boundedQueue<batchItem> toSegment(options.queueDepth);
+	boundedQueue<batchItem> toEncode(options.queueDepth);
+	atomic<size_t> nextInput(0);
+	atomic<int> decodersLeft(decoders);
+	atomic<int> segmentersLeft(segmenters);
+
+	const batchClock::time_point batchStart = batchClock::now();
+	{
+		// every stage worker blocks on a queue, so each needs its own thread
+		threadPool pool(decoders + segmenters + encoders);
+		// tiles of every image run on one pool kept for the whole batch,
+		// one worker per segment worker
+		threadPool tilePool(options.mode == SEGMENT_TILES ? segmenters : 1);
+
+		for (int worker = 0; worker < decoders; worker++) {
+			pool.submit([&] {
+				for (size_t index = nextInput++; index < inputs.size();
+					index = nextInput++) {
+					batchItem item;
+					item.index = index;
+					item.start = batchClock::now();
+					item.image = imageClass(inputs[index]);
+					item.decodeMs = elapsedMs(item.start);
+					item.segmentMs = 0;
+					item.regions = 0;
+					toSegment.push(move(item));
+				}
+				if (--decodersLeft == 0) {
+					toSegment.close();
+				}
+			});
+		}
+
+		for (int worker = 0; worker < segmenters; worker++) {
+			pool.submit([&] {
+				// kept between images so their buffers are reused
+				segmentationResult result;
+				imageClass converted;
+				batchItem item;
+				while (toSegment.pop(item)) {
+					const imageClass &input = item.image;
+					if (input.getRow() > 0 && input.getCol() > 0) {
+						batchClock::time_point start = batchClock::now();
+						segmentImage(input, result, options.mode, tilePool,
+							options.growing, options.space, &converted);
+						imageClass output(input.getRow(), input.getCol());
+						result.render(output);
+						item.regions = result.regionCount();
+						item.image = move(output);
+						item.segmentMs = elapsedMs(start);
+					}
+					toEncode.push(move(item));
+				}
+				if (--segmentersLeft == 0) {
+					toEncode.close();
+				}
+			});
+		}
+
+		for (int worker = 0; worker < encoders; worker++) {
+			pool.submit([&] {
+				batchItem item;
+				while (toEncode.pop(item)) {
+					const string &input = inputs[item.index];
+					const string &output = outputs[item.index];
+					imageClass &rendered = item.image;
+					bool written = false;
+					double encodeTime = 0;
+					if (rendered.getRow() > 0 && !overwritesInput[item.index]) {
+						batchClock::time_point start = batchClock::now();
+						written = writeGIFRows(output, rendered.getRow(),
+							rendered.getCol(),
+							[&rendered](int row) { return rendered.rowSpan(row); });
+						encodeTime = elapsedMs(start);
+					}
+					uint64_t bytes = fileSize(input);
+					uint64_t pixels = (uint64_t)rendered.getRow() * rendered.getCol();
+					double total = elapsedMs(item.start);
+					item.image = imageClass();
+
+					lock_guard<mutex> guard(reportLock);
+					if (!written) {
+						report.failed.push_back(input);
+						continue;
+					}
+					report.images++;
+					report.inputBytes += bytes;
+					report.pixels += pixels;
+					report.regions += item.regions;
+					decodeMs.push_back(item.decodeMs);
+					segmentMs.push_back(item.segmentMs);
+					encodeMs.push_back(encodeTime);
+					totalMs.push_back(total);
+				}
+			});
+		}
+		pool.wait();
+	}
+	report.seconds = elapsedMs(batchStart) / 1000.0;
+
+	report.decode = percentiles(decodeMs);
+	report.segment = percentiles(segmentMs);
+	report.encode = percentiles(encodeMs);
+	report.total = percentiles(totalMs);
+	return report;
+}
@@ -0,0 +1,78 @@
+// batchSegment.h
+// Author: Terence Ho
+//
+// This file describes the batch mode, which segments many images in one
+// process. Decoding, segmentation and encoding each run on their own
+// workers of one thread pool and hand images to the next stage through
+// bounded queues. A stage that falls behind makes the stages before it
+// wait, so only a few images are in memory at any time however long the
+// list is. The report gives the throughput of the whole batch and the
+// latency percentiles of every stage.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "segmentation.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct batchOptions {
+	vector<string> inputs;	// GIF or raw image files
+	string outputDir;		// outputs are named after their input
+	segmentMode mode;
+	growOptions growing;	// used by SEGMENT_SEEDED and SEGMENT_PRIORITY
+	colorSpace space;		// colours the pixels are compared in
+	int decodeWorkers;
+	int segmentWorkers;
+	int encodeWorkers;
+	int queueDepth;			// images waiting between two stages
+};
+
+// Latency of one stage over every image, in milliseconds
+struct stageLatency {
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+struct batchReport {
+	int images;				// images written
+	vector<string> failed;	// inputs that could not be read or written
+	uint64_t inputBytes;	// size of the files read
+	uint64_t pixels;
+	uint64_t regions;
+	double seconds;			// wall clock time of the whole batch
+	stageLatency decode;
+	stageLatency segment;
+	stageLatency encode;
+	stageLatency total;		// read to written, including queue waits
+};
+
+//----------------------------------------------------------------------------
+// listInputs()
+// Precondition: path is a file, a directory, or @ followed by a file
+//				 that lists one path per line
+// Postcondition: Adds the images path names to inputs. Directories give
+//				  their .gif and .raw files in name order.
+//				  Returns false if path can not be read.
+bool listInputs(const string &path, vector<string> &inputs);
+
+//----------------------------------------------------------------------------
+// outputName()
+// Precondition: input is an image path
+// Postcondition: Returns the path in outputDir of the GIF written for input,
+//				  the name of input with its extension replaced by .gif
+string outputName(const string &input, const string &outputDir);
+
+//----------------------------------------------------------------------------
+// runBatch()
+// Precondition: options.outputDir exists, the worker counts and queue
+//				 depth are greater than 0
+// Postcondition: Every input is segmented and rendered with the average
+//				  colour of its regions into outputDir. An image whose
+//				  output would replace one of the inputs is failed instead.
+//				  Returns the throughput and latency of the batch.
+batchReport runBatch(const batchOptions &options);
@@ -0,0 +1,929 @@
+// benchmark.cpp
+// Author: Terence Ho
+//
+// Benchmark suite for the segmentation pipeline. Each stage (GIF decode,
+// raw cache mapping, pyramid halving, labelling, streaming segmentation
+// from the file, region averaging, rendering, image comparison and GIF
+// encode) is timed on synthetic images of several sizes and region
+// profiles. Like Google Benchmark, a stage is repeated until it has run
+// for a minimum time, and the report gives the time per iteration,
+// pixels per second and heap allocations per iteration, so two builds
+// can be compared before a release.
+//
+// Usage: Program4Bench [--sizes 256,1024,...] [--max-size N]
+//						[--filter text] [--min-time seconds] [--csv]
+//						[--kernel scalar|sse2|avx2]
+//		  Program4Bench --check kernels | stats | merge | metrics
+// --check kernels runs every pixel kernel at every supported level on rows
+// of 1 to 64 pixels and prints how many results differ from the scalar
+// level. --check stats segments random images with every mode and
+// compares every column of the region table with a count made pixel by
+// pixel from the label map. --check merge runs the merge pass with random
+// limits and checks that no pair of neighbours it should have joined is
+// left, the statistics included. --check metrics counts from more threads
+// than there are metric slots, one after another and all at once, and
+// checks that the report loses no count.
+//---------------------------------------------------------------------------
+#include "ImageClass.h"
+#include "colorSpace.h"
+#include "metrics.h"
+#include "pixelKernels.h"
+#include "priorityGrowing.h"
+#include "pyramidSegment.h"
+#include "rawImage.h"
+#include "regionGraph.h"
+#include "runComponents.h"
+#include "segmentation.h"
+#include "streamSegment.h"
+#include "threadPool.h"
+#include "thresholdSweep.h"
+#include "tileSegment.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// Every heap allocation of the process goes through these, so a benchmark
+// can report how many allocations one iteration makes.
+namespace {
+atomic<uint64_t> allocationCount(0);
+atomic<uint64_t> allocationBytes(0);
+}
+
+void *operator new(size_t size) {
+	allocationCount++;
+	allocationBytes += size;
+	void *block = malloc(size == 0 ? 1 : size);
+	if (block == nullptr) {
+		throw bad_alloc();
+	}
+	return block;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept {
+	allocationCount++;
+	allocationBytes += size;
+	return malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *block) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, const nothrow_t &) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+	free(block);
+}
+
+namespace {
+
+// Region layouts the synthetic images are drawn with
+enum imageProfile {
+	PROFILE_UNIFORM,		// one colour, a single region
+	PROFILE_NOISE,			// random colours, many tiny regions
+	PROFILE_CHECKERBOARD,	// 8x8 squares of two distant colours
+	PROFILE_GRADIENT		// smooth ramps that seed flooding cuts into bands
+};
+
+const char *PROFILE_NAMES[] = { "uniform", "noise", "checkerboard", "gradient" };
+
+// Benchmark names of the connectivity and similarity rules, by enum value
+const char *CONNECT_NAMES[] = { "4", "8" };
+const char *SIMILAR_NAMES[] = { "Seed", "Neighbour", "Mean", "Luma" };
+const char *SPACE_NAMES[] = { "RGB", "YCbCr", "Lab" };
+
+struct options {
+	vector<int> sizes;
+	int maxSize;
+	string filter;
+	double minTime;
+	bool csv;
+	string check;		// self-check to run instead of timing, or empty
+};
+
+// Results of every pixel kernel on one pair of rows
+struct kernelResults {
+	vector<pixel> negated;
+	size_t differences;
+	bool equalSelf;
+	bool equalOther;
+	vector<uint64_t> similar;	// masks for every metric and threshold
+	vector<uint64_t> pairs;		// masks for every threshold
+	vector<pixel> transformed;
+	vector<pixel> lab;
+	vector<pixel> downsampled;
+};
+
+// Thresholds the mask kernels are checked with, below, around and past
+// the largest distances
+const int CHECK_THRESHOLDS[] = { 0, 1, 40, 100, 300, 442, 443, 800 };
+
+// An arbitrary matrix with negative weights and offsets, so the check
+// clamps at both ends
+const colorMatrix CHECK_MATRIX = {
+	{ { 4899, 9617, 1868 }, { -2765, -5427, 8192 }, { 8192, -6860, -1332 } },
+	{ 1 << 13, (128 << 14) + (1 << 13), -(20 << 14) }
+};
+
+//----------------------------------------------------------------------------
+// fillImage()
+// Precondition: image is a valid image
+// Postcondition: image is drawn with profile
+void fillImage(imageClass &image, imageProfile profile) {
+	const int rows = image.getRow();
+	const int cols = image.getCol();
+	uint32_t state = 12345;
+	for (int row = 0; row < rows; row++) {
+		pixel *target = image.rowSpan(row);
+		for (int col = 0; col < cols; col++) {
+			pixel &p = target[col];
+			switch (profile) {
+			case PROFILE_UNIFORM:
+				p.red = 120;
+				p.green = 80;
+				p.blue = 60;
+				break;
+			case PROFILE_NOISE:
+				state = state * 1664525u + 1013904223u;
+				p.red = (byte)(state >> 24);
+				p.green = (byte)(state >> 16);
+				p.blue = (byte)(state >> 8);
+				break;
+			case PROFILE_CHECKERBOARD: {
+				bool dark = ((row >> 3) + (col >> 3)) % 2 == 0;
+				p.red = dark ? 20 : 230;
+				p.green = dark ? 30 : 220;
+				p.blue = dark ? 40 : 210;
+				break;
+			}
+			case PROFILE_GRADIENT:
+				p.red = (byte)((int64_t)col * 255 / cols);
+				p.green = (byte)((int64_t)row * 255 / rows);
+				p.blue = 128;
+				break;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// runCase()
+// Precondition: body runs one iteration of the stage on pixels pixels
+// Postcondition: body is run once to warm up, then repeatedly until
+//				  minTime has passed, and one report line is printed
+void runCase(const options &opts, const string &name, uint64_t pixels,
+	const function<void()> &body) {
+	if (!opts.filter.empty() && name.find(opts.filter) == string::npos) {
+		return;
+	}
+	body();
+
+	uint64_t iterations = 0;
+	uint64_t startCount = allocationCount;
+	uint64_t startBytes = allocationBytes;
+	auto start = chrono::steady_clock::now();
+	double elapsed = 0;
+	do {
+		body();
+		iterations++;
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	} while (elapsed < opts.minTime);
+	double allocations = (double)(allocationCount - startCount) / iterations;
+	double kilobytes = (double)(allocationBytes - startBytes) / iterations / 1024;
+	double milliseconds = elapsed * 1000 / iterations;
+	double megapixels = pixels * iterations / elapsed / 1e6;
+
+	if (opts.csv) {
+		cout << name << ',' << milliseconds << ',' << iterations << ','
+			<< megapixels << ',' << allocations << ',' << kilobytes << endl;
+	} else {
+		cout << left << setw(34) << name << right << fixed
+			<< setprecision(3) << setw(12) << milliseconds
+			<< setw(12) << iterations
+			<< setprecision(1) << setw(12) << megapixels
+			<< setw(12) << allocations
+			<< setw(12) << kilobytes << endl;
+	}
+}
+
+//----------------------------------------------------------------------------
+// runSize()
+// Precondition: size is the width and height of the images to time
+// Postcondition: Every stage is timed for every profile at that size
+void runSize(const options &opts, int size, threadPool &pool) {
+	const uint64_t pixels = (uint64_t)size * size;
+	for (int which = 0; which < 4; which++) {
+		imageProfile profile = (imageProfile)which;
+		string suffix = string("/") + PROFILE_NAMES[which] + "/" +
+			to_string(size);
+		string gifName = string("bench_") + PROFILE_NAMES[which] + "_" +
+			to_string(size) + ".gif";
+
+		imageClass input(size, size);
+		fillImage(input, profile);
+		input.createGIF(gifName);
+		imageClass copy(input);
+		imageClass output(size, size);
+		segmentationResult result;
+
+		runCase(opts, "ReadGIF" + suffix, pixels, [&] {
+			imageClass decoded(gifName);
+		});
+		// mapping plus one pass over the pixels, so every page is loaded
+		string rawName = gifName + ".raw";
+		convertGIFToRaw(gifName, rawName);
+		runCase(opts, "ReadRaw" + suffix, pixels, [&] {
+			imageClass mapped(rawName);
+			volatile int differences = mapped.compareImage(input);
+			(void)differences;
+		});
+		remove(rawName.c_str());
+		runCase(opts, "SeedFlood" + suffix, pixels, [&] {
+			segmentImage(input, result, SEGMENT_SEEDED);
+		});
+		// converting into each colour space into a reused image, then the
+		// whole of seed flooding on the converted pixels, converting into
+		// the same image
+		imageClass converted;
+		for (int space = SPACE_YCBCR; space <= SPACE_LAB; space++) {
+			runCase(opts, string("Convert") + SPACE_NAMES[space] + suffix,
+				pixels, [&] {
+				convertImage(input, converted, (colorSpace)space);
+			});
+			runCase(opts, string("SeedFlood") + SPACE_NAMES[space] + suffix,
+				pixels, [&] {
+				segmentImage(input, result, SEGMENT_SEEDED, 0, DEFAULT_GROW,
+					(colorSpace)space, &converted);
+			});
+		}
+		// every connectivity with every similarity rule, each its own
+		// instance of the flood fill engine
+		for (int connect = CONNECT_4; connect <= CONNECT_8; connect++) {
+			for (int rule = SIMILAR_SEED; rule <= SIMILAR_LUMA; rule++) {
+				const growOptions growing = { (connectivity)connect,
+					(similarityRule)rule, SEED_THRESHOLD, METRIC_L1 };
+				runCase(opts, string("Grow") + CONNECT_NAMES[connect] +
+					SIMILAR_NAMES[rule] + suffix, pixels, [&] {
+					segmentSeeded(input, result, growing);
+				});
+			}
+		}
+		// closest pixel to the region average first, from a bucket queue
+		for (int connect = CONNECT_4; connect <= CONNECT_8; connect++) {
+			const growOptions growing = { (connectivity)connect, SIMILAR_MEAN,
+				SEED_THRESHOLD, METRIC_L1 };
+			runCase(opts, string("Priority") + CONNECT_NAMES[connect] + suffix,
+				pixels, [&] {
+				segmentPriority(input, result, growing);
+			});
+		}
+		// one 2x2 halving into a reused level, the coarsest level alone as
+		// a preview with no budget, then that preview at full resolution
+		imageClass half;
+		runCase(opts, "Downsample" + suffix, pixels, [&] {
+			downsampleImage(input, half);
+		});
+		pyramidSegmenter pyramid;
+		pyramidOptions previewOnly = DEFAULT_PYRAMID;
+		previewOnly.budgetMs = 0;
+		runCase(opts, "PyramidPreview" + suffix, pixels, [&] {
+			pyramid.preview(input, previewOnly);
+		});
+		runCase(opts, "PyramidFull" + suffix, pixels, [&] {
+			pyramid.preview(input, previewOnly);
+			pyramid.refine(result);
+		});
+		runCase(opts, "Components" + suffix, pixels, [&] {
+			segmentImage(input, result, SEGMENT_COMPONENTS);
+		});
+		runCase(opts, "Runs" + suffix, pixels, [&] {
+			segmentImage(input, result, SEGMENT_RUNS);
+		});
+		// runs and statistics only, no label map, then painted from runs
+		regionStore runRegions;
+		runCase(opts, "RunsNoLabels" + suffix, pixels, [&] {
+			segmentRuns(input, runRegions);
+		});
+		runCase(opts, "RenderRuns" + suffix, pixels, [&] {
+			renderRuns(runRegions, output);
+		});
+		runCase(opts, "MergeSmall" + suffix, pixels, [&] {
+			segmentImage(input, result, SEGMENT_COMPONENTS);
+			mergeOptions merging = { 16, 0 };
+			mergeRegions(input, result, merging);
+		});
+		// 100 thresholds from one sorted edge list, then the regions of
+		// the last one, to set against 100 Components runs
+		runCase(opts, "Sweep" + suffix, pixels, [&] {
+			thresholdSweep sweep;
+			sweep.build(input);
+			for (int threshold = 2; threshold <= 200; threshold += 2) {
+				sweep.setThreshold(threshold);
+			}
+			sweep.segment(result);
+		});
+		runCase(opts, "Tiles" + suffix, pixels, [&] {
+			segmentTiles(input, result, pool);
+		});
+		runCase(opts, "Stream" + suffix, pixels, [&] {
+			uint64_t regions = 0;
+			segmentStream(gifName, [&](const regionStats &) { regions++; });
+			volatile uint64_t keep = regions;
+			(void)keep;
+		});
+
+		// the stages below work on the seed flooded regions
+		segmentImage(input, result, SEGMENT_SEEDED);
+		runCase(opts, "RegionAverage" + suffix, pixels, [&] {
+			unsigned int sink = 0;
+			for (int label = 0; label < result.regionCount(); label++) {
+				sink += result.getRegions().averageColor(label).red;
+			}
+			volatile unsigned int keep = sink;
+			(void)keep;
+		});
+		runCase(opts, "Render" + suffix, pixels, [&] {
+			result.render(output);
+		});
+		runCase(opts, "RenderPalette" + suffix, pixels, [&] {
+			result.render(output, RENDER_PALETTE);
+		});
+		runCase(opts, "RenderBoundary" + suffix, pixels, [&] {
+			result.render(output, RENDER_BOUNDARY, &input);
+		});
+		runCase(opts, "CompareImage" + suffix, pixels, [&] {
+			volatile int differences = input.compareImage(copy);
+			(void)differences;
+		});
+		runCase(opts, "CloneImage" + suffix, pixels, [&] {
+			imageClass cloned = input.clone();
+		});
+		runCase(opts, "PhotoNegative" + suffix, pixels, [&] {
+			imageClass negative = input.photoNegative();
+		});
+		runCase(opts, "WriteGIF" + suffix, pixels, [&] {
+			output.createGIF("bench_output.gif");
+		});
+		remove(gifName.c_str());
+		remove("bench_output.gif");
+	}
+}
+
+//----------------------------------------------------------------------------
+// runKernels()
+// Precondition: first and second hold 2 * count pixels
+// Postcondition: results holds every kernel run at the current level on
+//				  the first count pixels, downsampling on all of them
+void runKernels(const vector<pixel> &first, const vector<pixel> &second,
+	size_t count, kernelResults &results) {
+	// one pixel more than written, which must stay as it is
+	const pixel guard = { 1, 2, 3 };
+	results.negated.assign(count + 1, guard);
+	results.transformed.assign(count + 1, guard);
+	results.lab.assign(count + 1, guard);
+	results.downsampled.assign(count + 1, guard);
+	negatePixels(first.data(), results.negated.data(), count);
+	results.differences = countPixelDifferences(first.data(), second.data(),
+		count);
+	results.equalSelf = pixelsEqual(first.data(), first.data(), count);
+	results.equalOther = pixelsEqual(first.data(), second.data(), count);
+
+	const size_t words = maskWords(count);
+	results.similar.clear();
+	results.pairs.clear();
+	for (int threshold : CHECK_THRESHOLDS) {
+		for (int metric = METRIC_L1; metric <= METRIC_MAX; metric++) {
+			results.similar.resize(results.similar.size() + words);
+			similarPixels(first.data(), count, second[0], threshold,
+				(colorMetric)metric, &results.similar[results.similar.size() - words]);
+		}
+		// each pixel against the next, as the run finder compares them
+		results.pairs.resize(results.pairs.size() + words);
+		similarPairs(first.data(), first.data() + 1, count, threshold,
+			&results.pairs[results.pairs.size() - words]);
+	}
+	transformPixels(first.data(), results.transformed.data(), count,
+		CHECK_MATRIX);
+	labPixels(first.data(), results.lab.data(), count);
+	downsamplePixels(first.data(), second.data(), results.downsampled.data(),
+		count);
+}
+
+//----------------------------------------------------------------------------
+// samePixels()
+// Postcondition: Returns true if first and second hold the same pixels
+bool samePixels(const vector<pixel> &first, const vector<pixel> &second) {
+	return first.size() == second.size() &&
+		pixelsEqual(first.data(), second.data(), first.size());
+}
+
+//----------------------------------------------------------------------------
+// checkKernels()
+// Postcondition: Every kernel at every supported level has been run on
+//				  rows of 1 to 64 pixels and compared with the scalar
+//				  level. Prints and returns the number of rows that differ.
+int checkKernels() {
+	const kernelLevel active = activeKernelLevel();
+	uint32_t state = 12345;
+	int mismatches = 0;
+	for (int level = KERNEL_SSE2; level <= KERNEL_AVX2; level++) {
+		if (setKernelLevel((kernelLevel)level) != level) {
+			cout << kernelLevelName((kernelLevel)level) << ": not supported"
+				<< endl;
+			continue;
+		}
+		int levelMismatches = 0;
+		for (size_t count = 1; count <= 64; count++) {
+			// the second row mostly repeats the first, so equal and
+			// different pixels both come up
+			vector<pixel> first(2 * count);
+			vector<pixel> second(2 * count);
+			for (size_t i = 0; i < first.size(); i++) {
+				state = state * 1664525u + 1013904223u;
+				first[i].red = (byte)(state >> 24);
+				first[i].green = (byte)(state >> 16);
+				first[i].blue = (byte)(state >> 8);
+				second[i] = first[i];
+				if ((state & 3) == 0) {
+					second[i].green = (byte)(second[i].green + (state >> 2));
+				}
+			}
+			kernelResults expected;
+			kernelResults actual;
+			setKernelLevel(KERNEL_SCALAR);
+			runKernels(first, second, count, expected);
+			setKernelLevel((kernelLevel)level);
+			runKernels(first, second, count, actual);
+			// pixelsEqual is itself under test, so it runs at scalar
+			setKernelLevel(KERNEL_SCALAR);
+			bool same = samePixels(expected.negated, actual.negated) &&
+				expected.differences == actual.differences &&
+				expected.equalSelf == actual.equalSelf &&
+				expected.equalOther == actual.equalOther &&
+				expected.similar == actual.similar &&
+				expected.pairs == actual.pairs &&
+				samePixels(expected.transformed, actual.transformed) &&
+				samePixels(expected.lab, actual.lab) &&
+				samePixels(expected.downsampled, actual.downsampled);
+			if (!same) {
+				cout << kernelLevelName((kernelLevel)level) << ": differs at "
+					<< count << " pixels" << endl;
+				levelMismatches++;
+			}
+		}
+		cout << kernelLevelName((kernelLevel)level) << ": " << levelMismatches
+			<< " of 64 widths differ" << endl;
+		mismatches += levelMismatches;
+	}
+	setKernelLevel(active);
+	cout << "Kernel mismatches: " << mismatches << endl;
+	return mismatches;
+}
+
+//----------------------------------------------------------------------------
+// nextRandom()
+// Postcondition: state is stepped and its high bits returned
+uint32_t nextRandom(uint32_t &state) {
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+//----------------------------------------------------------------------------
+// fillRandom()
+// Precondition: image is a valid image, levels is greater than 0
+// Postcondition: Every pixel is one of levels grey steps 60 apart with a
+//				  little noise, so one level gives a single region and
+//				  several give regions of every size and shape
+void fillRandom(imageClass &image, int levels, uint32_t &state) {
+	for (int row = 0; row < image.getRow(); row++) {
+		pixel *target = image.rowSpan(row);
+		for (int col = 0; col < image.getCol(); col++) {
+			int value = (int)(nextRandom(state) % levels) * 60;
+			target[col].red = (byte)value;
+			target[col].green = (byte)((value + nextRandom(state) % 20) % 256);
+			target[col].blue = (byte)(nextRandom(state) % 40);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// closeTo()
+// Postcondition: Returns true if value is expected to within rounding
+bool closeTo(double value, double expected) {
+	double difference = value > expected ? value - expected : expected - value;
+	return difference <= 1e-6 * (1 + (expected < 0 ? -expected : expected));
+}
+
+//----------------------------------------------------------------------------
+// statisticMismatches()
+// Precondition: result was segmented from input
+// Postcondition: Returns the number of regions of result whose area, box,
+//				  centroid, means, variances or perimeter differ from a
+//				  count over the label map, plus the pixels with a label
+//				  that is not a region. The perimeter counts the sides of
+//				  every pixel on the image border or next to another label.
+int statisticMismatches(const imageClass &input,
+	const segmentationResult &result) {
+	const regionTable &table = result.getTable();
+	const labelMap &labels = result.getLabels();
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	const size_t regions = table.size();
+	vector<uint64_t> areas(regions, 0);
+	vector<regionBox> boxes(regions, regionBox{ rows, cols, -1, -1 });
+	vector<double> rowSums(regions, 0);
+	vector<double> colSums(regions, 0);
+	vector<double> sums(regions * 3, 0);
+	vector<double> squares(regions * 3, 0);
+	vector<uint64_t> perimeters(regions, 0);
+	int mismatches = 0;
+
+	for (int row = 0; row < rows; row++) {
+		const uint32_t *line = labels.rowSpan(row);
+		const pixel *in = input.rowSpan(row);
+		for (int col = 0; col < cols; col++) {
+			const uint32_t label = line[col];
+			if (label >= regions) {
+				mismatches++;
+				continue;
+			}
+			areas[label]++;
+			regionBox &box = boxes[label];
+			box.top = min(box.top, row);
+			box.left = min(box.left, col);
+			box.bottom = max(box.bottom, row);
+			box.right = max(box.right, col);
+			rowSums[label] += row;
+			colSums[label] += col;
+			const int channels[3] = { in[col].red, in[col].green, in[col].blue };
+			for (int channel = 0; channel < 3; channel++) {
+				sums[label * 3 + channel] += channels[channel];
+				squares[label * 3 + channel] += channels[channel] *
+					channels[channel];
+			}
+			perimeters[label] +=
+				(row == 0 || labels.rowSpan(row - 1)[col] != label) +
+				(row + 1 == rows || labels.rowSpan(row + 1)[col] != label) +
+				(col == 0 || line[col - 1] != label) +
+				(col + 1 == cols || line[col + 1] != label);
+		}
+	}
+
+	for (uint32_t label = 0; label < regions; label++) {
+		const double area = (double)areas[label];
+		bool same = table.area(label) == areas[label] &&
+			table.perimeter(label) == perimeters[label];
+		if (same && areas[label] > 0) {
+			const regionBox box = table.box(label);
+			same = box.top == boxes[label].top &&
+				box.left == boxes[label].left &&
+				box.bottom == boxes[label].bottom &&
+				box.right == boxes[label].right &&
+				closeTo(table.centroidRow(label), rowSums[label] / area) &&
+				closeTo(table.centroidCol(label), colSums[label] / area);
+			for (int channel = 0; channel < 3; channel++) {
+				const double mean = sums[label * 3 + channel] / area;
+				const double variance = squares[label * 3 + channel] / area -
+					mean * mean;
+				same = same && closeTo(table.mean(label, channel), mean) &&
+					closeTo(table.variance(label, channel),
+						variance > 0 ? variance : 0);
+			}
+		}
+		mismatches += !same;
+	}
+	return mismatches;
+}
+
+//----------------------------------------------------------------------------
+// checkStatistics()
+// Postcondition: Random images of 1 to 150 pixels a side have been
+//				  segmented with every mode, every growing rule and the
+//				  pyramid, and their region tables compared with counts
+//				  from the label map. Prints and returns the number of
+//				  regions that differ.
+int checkStatistics() {
+	// names of the ways each image is segmented, in the order run below
+	const char *names[] = { "seeded", "components", "tiles", "runs",
+		"priority4", "priority8", "pyramid" };
+	const int WAYS = 7;
+	int mismatches[WAYS] = { 0 };
+	int growMismatches = 0;
+	uint32_t state = 2024;
+	threadPool pool(3);
+	segmentationResult result;
+	pyramidSegmenter pyramid;
+
+	for (int image = 0; image < 60; image++) {
+		imageClass input(1 + nextRandom(state) % 150,
+			1 + nextRandom(state) % 150);
+		fillRandom(input, 1 + nextRandom(state) % 6, state);
+
+		for (int way = 0; way < WAYS; way++) {
+			if (way == 6) {
+				pyramidOptions options = DEFAULT_PYRAMID;
+				options.budgetMs = 0;
+				pyramid.preview(input, options);
+				pyramid.refine(result);
+			} else if (way == 4 || way == 5) {
+				growOptions growing = { way == 4 ? CONNECT_4 : CONNECT_8,
+					SIMILAR_MEAN, SEED_THRESHOLD, METRIC_L1 };
+				segmentImage(input, result, SEGMENT_PRIORITY, pool, growing);
+			} else {
+				segmentImage(input, result, (segmentMode)way, pool);
+			}
+			mismatches[way] += statisticMismatches(input, result);
+		}
+		// every connectivity with every similarity rule of seed flooding
+		for (int connect = CONNECT_4; connect <= CONNECT_8; connect++) {
+			for (int rule = SIMILAR_SEED; rule <= SIMILAR_LUMA; rule++) {
+				const growOptions growing = { (connectivity)connect,
+					(similarityRule)rule, SEED_THRESHOLD, METRIC_L1 };
+				segmentSeeded(input, result, growing);
+				growMismatches += statisticMismatches(input, result);
+			}
+		}
+	}
+
+	int total = growMismatches;
+	for (int way = 0; way < WAYS; way++) {
+		cout << names[way] << ": " << mismatches[way] << " regions differ"
+			<< endl;
+		total += mismatches[way];
+	}
+	cout << "growing rules: " << growMismatches << " regions differ" << endl;
+	cout << "Statistics mismatches: " << total << endl;
+	return total;
+}
+
+//----------------------------------------------------------------------------
+// mergeMismatches()
+// Precondition: result was merged from input with options
+// Postcondition: Returns the number of neighbouring pairs of regions the
+//				  merge should have joined, plus the regions that are
+//				  empty or not numbered in scan order
+int mergeMismatches(const imageClass &input, const segmentationResult &result,
+	const mergeOptions &options) {
+	const labelMap &labels = result.getLabels();
+	const regionStore &regions = result.getRegions();
+	const regionTable &table = result.getTable();
+	const uint32_t count = (uint32_t)result.regionCount();
+	int mismatches = 0;
+	uint32_t nextNew = 0;
+	vector<pair<uint32_t, uint32_t>> touching;
+
+	for (int row = 0; row < input.getRow(); row++) {
+		const uint32_t *line = labels.rowSpan(row);
+		const uint32_t *below = row + 1 < input.getRow() ?
+			labels.rowSpan(row + 1) : nullptr;
+		for (int col = 0; col < input.getCol(); col++) {
+			const uint32_t label = line[col];
+			if (label >= count) {
+				mismatches++;
+				continue;
+			}
+			// a label seen for the first time must be the next one
+			if (label == nextNew) {
+				nextNew++;
+			} else if (label > nextNew) {
+				mismatches++;
+				nextNew = label + 1;
+			}
+			if (col + 1 < input.getCol() && line[col + 1] != label) {
+				touching.push_back(make_pair(min(label, line[col + 1]),
+					max(label, line[col + 1])));
+			}
+			if (below != nullptr && below[col] != label) {
+				touching.push_back(make_pair(min(label, below[col]),
+					max(label, below[col])));
+			}
+		}
+	}
+	sort(touching.begin(), touching.end());
+	touching.erase(unique(touching.begin(), touching.end()), touching.end());
+
+	for (const pair<uint32_t, uint32_t> &regionPair : touching) {
+		if (regionPair.second >= count) {
+			continue;
+		}
+		const bool small = table.area(regionPair.first) < options.minArea ||
+			table.area(regionPair.second) < options.minArea;
+		const bool similar = colorDistance(
+			regions.averageColor(regionPair.first),
+			regions.averageColor(regionPair.second)) < options.colorThreshold;
+		mismatches += small || similar;
+	}
+	for (uint32_t label = 0; label < count; label++) {
+		mismatches += table.area(label) == 0;
+	}
+	return mismatches;
+}
+
+//----------------------------------------------------------------------------
+// checkMerges()
+// Postcondition: Random images have been segmented and merged with random
+//				  area and colour limits, then checked for regions left
+//				  that should have been joined, for a count that does not
+//				  add up and for statistics that differ from the label
+//				  map. Prints and returns the number of problems found.
+int checkMerges() {
+	uint32_t state = 7;
+	int invariantMismatches = 0;
+	int countMismatches = 0;
+	int statisticsMismatches = 0;
+	segmentationResult result;
+
+	for (int image = 0; image < 120; image++) {
+		imageClass input(1 + nextRandom(state) % 100,
+			1 + nextRandom(state) % 100);
+		fillRandom(input, 1 + nextRandom(state) % 5, state);
+		segmentImage(input, result, (segmentMode)(image % 2 == 0 ?
+			SEGMENT_SEEDED : SEGMENT_COMPONENTS));
+		const int before = result.regionCount();
+		mergeOptions options = { nextRandom(state) % 20,
+			(int)(nextRandom(state) % 80) };
+		const int merges = mergeRegions(input, result, options);
+
+		countMismatches += result.regionCount() != before - merges;
+		invariantMismatches += mergeMismatches(input, result, options);
+		statisticsMismatches += statisticMismatches(input, result);
+	}
+
+	cout << "pairs left to join or misnumbered: " << invariantMismatches
+		<< endl;
+	cout << "region counts that do not add up: " << countMismatches << endl;
+	cout << "regions with wrong statistics: " << statisticsMismatches << endl;
+	const int total = invariantMismatches + countMismatches +
+		statisticsMismatches;
+	cout << "Merge mismatches: " << total << endl;
+	return total;
+}
+
+#if PROGRAM4_METRICS
+
+//----------------------------------------------------------------------------
+// countFromThreads()
+// Postcondition: Metrics are reset and threads threads have each added
+//				  1000 pixels one at a time, running at once in groups of
+//				  group. Returns the metrics report.
+string countFromThreads(int threads, int group) {
+	resetMetrics();
+	for (int first = 0; first < threads; first += group) {
+		const int running = min(group, threads - first);
+		atomic<int> started(0);
+		atomic<int> counted(0);
+		vector<thread> workers;
+		for (int worker = 0; worker < running; worker++) {
+			workers.emplace_back([&started, &counted, running]() {
+				// start together, so threads sharing a slot add at once
+				started++;
+				while (started.load() < running) {
+					this_thread::yield();
+				}
+				for (int pixel = 0; pixel < 1000; pixel++) {
+					metricAdd(COUNTER_PIXELS, 1);
+				}
+				// no thread of the group exits, giving its slot back,
+				// before every one has taken a slot
+				counted++;
+				while (counted.load() < running) {
+					this_thread::yield();
+				}
+			});
+		}
+		for (thread &worker : workers) {
+			worker.join();
+		}
+	}
+	ostringstream report;
+	writeMetricsJSON(report);
+	return report.str();
+}
+
+//----------------------------------------------------------------------------
+// metricMismatches()
+// Postcondition: Returns 1 if report does not count 1000 pixels for each
+//				  of threads threads or does not say whether the slots
+//				  overflowed as expected, and 0 otherwise
+int metricMismatches(const string &report, int threads, bool overflowed) {
+	const string pixels = "\"pixels\": " + to_string(1000 * threads) + ",";
+	const string overflow = string("\"overflowed\": ") +
+		(overflowed ? "true" : "false");
+	return report.find(pixels) == string::npos ||
+		report.find(overflow) == string::npos;
+}
+
+//----------------------------------------------------------------------------
+// checkMetrics()
+// Postcondition: Counts have been made from more threads than there are
+//				  metric slots, first in groups that fit the slots and
+//				  then all at once, and the reports checked for lost
+//				  counts. Prints and returns the number of problems found.
+int checkMetrics() {
+	const int reused = metricMismatches(countFromThreads(600, 100), 600,
+		false);
+	const int shared = metricMismatches(countFromThreads(300, 300), 300,
+		true);
+	resetMetrics();
+
+	cout << "slots given back and reused: " << reused << " lost" << endl;
+	cout << "slots shared at once: " << shared << " lost" << endl;
+	cout << "Metric mismatches: " << reused + shared << endl;
+	return reused + shared;
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+// parseOptions()
+// Postcondition: Returns the options given on the command line
+options parseOptions(int argc, char *argv[]) {
+	options opts;
+	opts.sizes = { 256, 1024, 2048, 4096, 8192 };
+	opts.maxSize = 4096;
+	opts.minTime = 0.5;
+	opts.csv = false;
+	for (int arg = 1; arg < argc; arg++) {
+		string option = argv[arg];
+		if (option == "--sizes" && arg + 1 < argc) {
+			opts.sizes.clear();
+			stringstream list(argv[++arg]);
+			string size;
+			while (getline(list, size, ',')) {
+				opts.sizes.push_back(atoi(size.c_str()));
+			}
+			opts.maxSize = 1 << 30;
+		} else if (option == "--max-size" && arg + 1 < argc) {
+			opts.maxSize = atoi(argv[++arg]);
+		} else if (option == "--filter" && arg + 1 < argc) {
+			opts.filter = argv[++arg];
+		} else if (option == "--min-time" && arg + 1 < argc) {
+			opts.minTime = atof(argv[++arg]);
+		} else if (option == "--csv") {
+			opts.csv = true;
+		} else if (option == "--check" && arg + 1 < argc) {
+			opts.check = argv[++arg];
+		} else if (option == "--kernel" && arg + 1 < argc) {
+			string level = argv[++arg];
+			setKernelLevel(level == "scalar" ? KERNEL_SCALAR :
+				level == "sse2" ? KERNEL_SSE2 : KERNEL_AVX2);
+		} else {
+			cerr << "unknown option " << option << endl;
+		}
+	}
+	return opts;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	options opts = parseOptions(argc, argv);
+	if (opts.check == "kernels") {
+		return checkKernels() == 0 ? 0 : 1;
+	} else if (opts.check == "stats") {
+		return checkStatistics() == 0 ? 0 : 1;
+	} else if (opts.check == "merge") {
+		return checkMerges() == 0 ? 0 : 1;
+#if PROGRAM4_METRICS
+	} else if (opts.check == "metrics") {
+		return checkMetrics() == 0 ? 0 : 1;
+#endif
+	} else if (!opts.check.empty()) {
+		cerr << "unknown check " << opts.check << endl;
+		return 1;
+	}
+	threadPool pool;
+
+	if (opts.csv) {
+		cout << "benchmark,ms_per_iter,iterations,mpixels_per_sec,"
+			<< "allocs_per_iter,kb_per_iter" << endl;
+	} else {
+		cout << "threads: " << pool.getThreads() << " kernels: "
+			<< kernelLevelName(activeKernelLevel()) << endl;
+		cout << left << setw(34) << "Benchmark" << right << setw(12) << "Time(ms)"
+			<< setw(12) << "Iterations" << setw(12) << "Mpixels/s"
+			<< setw(12) << "Allocs" << setw(12) << "KB alloc" << endl;
+		cout << string(94, '-') << endl;
+	}
+	for (int size : opts.sizes) {
+		if (size > 0 && size <= opts.maxSize) {
+			runSize(opts, size, pool);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,81 @@
+// boundedQueue.h
+// Author: Terence Ho
+//
+// This file describes a blocking first-in first-out queue with a fixed
+// capacity, used to pass work between the stages of the batch pipeline.
+// A producer that finds the queue full waits until a consumer makes room,
+// so a fast stage can never run more than capacity items ahead of a slow
+// one and the number of images held in memory stays bounded.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "metrics.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+template <typename T>
+class boundedQueue {
+public:
+	// boundedQueue()
+	// Precondition: capacity is greater than 0
+	// Postcondition: Creates an open, empty queue
+	explicit boundedQueue(size_t capacity)
+		: capacity(capacity == 0 ? 1 : capacity), closed(false) {
+	}
+
+	boundedQueue(const boundedQueue &) = delete;
+	boundedQueue& operator=(const boundedQueue &) = delete;
+
+	// push()
+	// Postcondition: item is added once there is room for it.
+	//				  Returns false and drops item if the queue is closed.
+	bool push(T item) {
+		unique_lock<mutex> guard(lock);
+		notFull.wait(guard, [this] { return closed || items.size() < capacity; });
+		if (closed) {
+			return false;
+		}
+		items.push_back(move(item));
+		metricPeakAt(PEAK_QUEUE, items.size());
+		notEmpty.notify_one();
+		return true;
+	}
+
+	// pop()
+	// Postcondition: Waits for an item and moves the oldest into item.
+	//				  Returns false once the queue is closed and empty.
+	bool pop(T &item) {
+		unique_lock<mutex> guard(lock);
+		notEmpty.wait(guard, [this] { return closed || !items.empty(); });
+		if (items.empty()) {
+			return false;
+		}
+		item = move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	// close()
+	// Postcondition: No more items are accepted, waiting consumers drain
+	//				  what is left and then stop
+	void close() {
+		lock_guard<mutex> guard(lock);
+		closed = true;
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+
+private:
+	size_t capacity;
+	bool closed;
+	deque<T> items;
+	mutex lock;
+	condition_variable notFull;
+	condition_variable notEmpty;
+};
@@ -0,0 +1,81 @@
+// colorSpace.cpp
+// Author: Terence Ho
+//
+// Colour space conversion, a row at a time with the pixel kernels. YCbCr
+// is a linear map of RGB, so it goes through the fixed point transform
+// kernel. Lab is not linear: each byte is turned into linear light by a
+// 256 entry table, mixed into XYZ, and put through the cube root by a
+// second table read with linear interpolation, so no pixel calls pow()
+// or cbrt(). Both convert 32 pixels a step with AVX2.
+//---------------------------------------------------------------------------
+#include "colorSpace.h"
+#include "metrics.h"
+#include "pixelKernels.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// BT.601 full range weights, scaled by 2^COLOR_MATRIX_SHIFT, with half of
+// the last step added to every channel for rounding
+const colorMatrix YCBCR_MATRIX = {
+	{
+		{ 4899, 9617, 1868 },		// Y
+		{ -2765, -5427, 8192 },		// Cb
+		{ 8192, -6860, -1332 }		// Cr
+	},
+	{ 1 << 13, (128 << 14) + (1 << 13), (128 << 14) + (1 << 13) }
+};
+
+}
+
+//----------------------------------------------------------------------------
+// convertImage()
+// Precondition: input is a valid image
+// Postcondition: converted has the size of input, its pixels reused if it
+//				  already had that size, and holds every pixel of input in
+//				  space
+void convertImage(const imageClass &input, imageClass &converted,
+	colorSpace space) {
+	stageTimer timer(STAGE_CONVERT);
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	if (converted.getRow() != rows || converted.getCol() != cols) {
+		converted = imageClass(rows, cols);
+	}
+	for (int row = 0; row < rows; row++) {
+		const pixel *source = input.rowSpan(row);
+		pixel *target = converted.rowSpan(row);
+		switch (space) {
+		case SPACE_YCBCR:
+			transformPixels(source, target, cols, YCBCR_MATRIX);
+			break;
+		case SPACE_LAB:
+			labPixels(source, target, cols);
+			break;
+		case SPACE_RGB:
+		default:
+			copy(source, source + cols, target);
+			break;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// recolorRegions()
+// Precondition: result was labelled from a converted copy of input
+// Postcondition: The runs of every region are unchanged, their seed
+//				  colours and statistics are those of input
+void recolorRegions(const imageClass &input, segmentationResult &result) {
+	stageTimer timer(STAGE_CONVERT);
+	vector<const pixel *> rows(input.getRow());
+	for (int row = 0; row < input.getRow(); row++) {
+		rows[row] = input.rowSpan(row);
+	}
+	regionStore &regions = result.getRegions();
+	for (int label = 0; label < regions.regionCount(); label++) {
+		regions.recolor(label, rows.data());
+	}
+}
@@ -0,0 +1,33 @@
+// colorSpace.h
+// Author: Terence Ho
+//
+// This file describes the colour space conversion done before labelling.
+// Sums of RGB differences do not follow how far apart two colours look,
+// so a threshold that splits dark shades merges bright ones. The image is
+// converted once into YCbCr or CIE Lab, still 3 bytes per pixel, and the
+// labelling runs on the converted copy: every similarity test, the vector
+// kernels included, costs the same as on RGB. Afterwards the statistics
+// of every region are counted again from the RGB pixels, so averages,
+// rendering and the region table stay in RGB.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "segmentation.h"
+
+//----------------------------------------------------------------------------
+// convertImage()
+// Precondition: input is a valid image
+// Postcondition: converted has the size of input, its pixels reused if it
+//				  already had that size, and holds every pixel of input in
+//				  space. YCbCr is BT.601 full range, as JPEG uses. Lab
+//				  is L scaled to 0 to 255 and a and b offset by 128.
+void convertImage(const imageClass &input, imageClass &converted,
+	colorSpace space);
+
+//----------------------------------------------------------------------------
+// recolorRegions()
+// Precondition: result was labelled from a converted copy of input
+// Postcondition: The runs of every region are unchanged, their seed
+//				  colours and statistics are those of input
+void recolorRegions(const imageClass &input, segmentationResult &result);
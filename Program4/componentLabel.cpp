@@ -0,0 +1,138 @@
+// componentLabel.cpp
+// Author: Terence Ho
+//
+// Two-pass connected-component labelling with a union-find forest.
+//---------------------------------------------------------------------------
+#include "componentLabel.h"
+#include "metrics.h"
+
+using namespace std;
+
+namespace {
+
+//----------------------------------------------------------------------------
+// addRun()
+// Precondition: labelAbove is the final labels of the row above, or null
+//				 on the first row
+// Postcondition: The run is added to its region and the edges it shares
+//				  with the region on the row above are taken off the
+//				  region perimeter. Runs on one row never touch their own
+//				  region, since a run ends where the label changes.
+void addRun(regionStore &regions, uint32_t label, int row, int left,
+	int right, const pixel *in, const uint32_t *labelAbove) {
+	regions.addRun(label, row, left, right, in);
+	if (labelAbove != nullptr) {
+		int joined = countLabel(labelAbove, left, right, label);
+		if (joined > 0) {
+			regions.joinEdges(label, joined);
+		}
+	}
+}
+
+}
+
+//----------------------------------------------------------------------------
+// segmentComponents()
+// Precondition: input is a valid image
+// Postcondition: result holds one region per 4-connected group of pixels
+//				  whose neighbouring colours differ by less than threshold.
+//				  Regions are numbered in the scan order of their first
+//				  pixel, which is also recorded as the region seed.
+void segmentComponents(const imageClass &input, segmentationResult &result,
+	int threshold) {
+	stageTimer timer(STAGE_SEGMENT);
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	result.reset(rows, cols);
+	if (rows == 0 || cols == 0) {
+		return;
+	}
+
+	unionFind sets;
+	sets.reserve((size_t)rows * cols / 4 + 1);
+	labelRect(input, result.getLabels(), 0, 0, rows - 1, cols - 1,
+		threshold, sets);
+	resolveComponents(input, sets, result);
+	metricAdd(COUNTER_REGIONS, result.regionCount());
+}
+
+//----------------------------------------------------------------------------
+// labelRect()
+// Precondition: top <= bottom and left <= right lie inside input and labels
+// Postcondition: First pass over the rectangle only. Every pixel in it has
+//				  a provisional label made by sets, joined with its left and
+//				  upper neighbours inside the rectangle when similar.
+void labelRect(const imageClass &input, labelMap &labels, int top, int left,
+	int bottom, int right, int threshold, unionFind &sets) {
+	for (int row = top; row <= bottom; row++) {
+		const pixel *in = input.rowSpan(row);
+		const pixel *above = row > top ? input.rowSpan(row - 1) : nullptr;
+		uint32_t *labelRow = labels.rowSpan(row);
+		const uint32_t *labelAbove = row > top ? labels.rowSpan(row - 1) : nullptr;
+		for (int col = left; col <= right; col++) {
+			uint32_t label = NO_LABEL;
+			if (col > left && colorDistance(in[col], in[col - 1]) < threshold) {
+				label = labelRow[col - 1];
+			}
+			if (above != nullptr &&
+				colorDistance(in[col], above[col]) < threshold) {
+				if (label == NO_LABEL) {
+					label = labelAbove[col];
+				} else if (label != labelAbove[col]) {
+					sets.unite(label, labelAbove[col]);
+				}
+			}
+			if (label == NO_LABEL) {
+				label = sets.makeSet();
+			}
+			labelRow[col] = label;
+		}
+	}
+	metricAdd(COUNTER_PIXELS, (uint64_t)(bottom - top + 1) * (right - left + 1));
+}
+
+//----------------------------------------------------------------------------
+// resolveComponents()
+// Precondition: every label of result is an id made by sets
+// Postcondition: Second pass. Labels are replaced by final region labels
+//				  numbered in scan order and the runs and statistics of
+//				  every region are added to result.
+void resolveComponents(const imageClass &input, unionFind &sets,
+	segmentationResult &result) {
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	labelMap &labels = result.getLabels();
+	regionStore &regions = result.getRegions();
+	vector<uint32_t> finalLabel(sets.size(), NO_LABEL);
+
+	for (int row = 0; row < rows; row++) {
+		const pixel *in = input.rowSpan(row);
+		uint32_t *labelRow = labels.rowSpan(row);
+		const uint32_t *labelAbove = row > 0 ? labels.rowSpan(row - 1) : nullptr;
+		int runStart = 0;
+		// neighbours mostly share an id, which is then looked up once
+		uint32_t lastId = NO_LABEL;
+		uint32_t label = NO_LABEL;
+		for (int col = 0; col < cols; col++) {
+			if (labelRow[col] != lastId) {
+				lastId = labelRow[col];
+				uint32_t root = sets.find(lastId);
+				label = finalLabel[root];
+				if (label == NO_LABEL) {
+					label = regions.addRegion(row, col, in[col]);
+					finalLabel[root] = label;
+				}
+			}
+			labelRow[col] = label;
+			if (col > 0 && labelRow[col - 1] != label) {
+				addRun(regions, labelRow[col - 1], row, runStart, col - 1, in,
+					labelAbove);
+				runStart = col;
+			}
+		}
+		if (cols > 0) {
+			addRun(regions, labelRow[cols - 1], row, runStart, cols - 1, in,
+				labelAbove);
+		}
+	}
+}
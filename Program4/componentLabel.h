@@ -0,0 +1,44 @@
+// componentLabel.h
+// Author: Terence Ho
+//
+// This file describes the two-pass connected-component labelling mode.
+// The first pass gives every pixel a provisional label and joins it with
+// its left and upper neighbours in a union-find forest when their colours
+// are within the threshold. The second pass replaces each provisional
+// label with the final label of its set. Unlike seed flooding, the result
+// does not depend on the order the pixels are visited in.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "labelMap.h"
+#include "segmentation.h"
+#include "unionFind.h"
+
+//----------------------------------------------------------------------------
+// segmentComponents()
+// Precondition: input is a valid image
+// Postcondition: result holds one region per 4-connected group of pixels
+//				  whose neighbouring colours differ by less than threshold.
+//				  Regions are numbered in the scan order of their first
+//				  pixel, which is also recorded as the region seed.
+void segmentComponents(const imageClass &input, segmentationResult &result,
+	int threshold = SEED_THRESHOLD);
+
+//----------------------------------------------------------------------------
+// labelRect()
+// Precondition: top <= bottom and left <= right lie inside input and labels
+// Postcondition: First pass over the rectangle only. Every pixel in it has
+//				  a provisional label made by sets, joined with its left and
+//				  upper neighbours inside the rectangle when similar.
+void labelRect(const imageClass &input, labelMap &labels, int top, int left,
+	int bottom, int right, int threshold, unionFind &sets);
+
+//----------------------------------------------------------------------------
+// resolveComponents()
+// Precondition: every label of result is an id made by sets
+// Postcondition: Second pass. Labels are replaced by final region labels
+//				  numbered in scan order and the runs and statistics of
+//				  every region are added to result.
+void resolveComponents(const imageClass &input, unionFind &sets,
+	segmentationResult &result);
@@ -0,0 +1,410 @@
+// floodFill.cpp
+// Author: Terence Ho
+//
+// Scanline flood fill used to find connected groups of similar pixels.
+// Each step claims the widest run of matching pixels on one row, then
+// pushes one entry per matching run found on the rows directly above and
+// below it, and with 8-connectivity on the pixels diagonally past its ends.
+// The result is the same 4-connected group the old recursive pixelCheck
+// found, without one stack frame per pixel. Pixels are tested up to 64 at
+// a time: the similarity policy gives a mask of the pixels that may join,
+// and the visited bits are cleared out of it, so runs are read straight
+// off the mask. The engine is a template over the connectivity and the
+// policy, and one instance is picked per call from the growOptions.
+//---------------------------------------------------------------------------
+#include "floodFill.h"
+#include "growPolicies.h"
+#include "metrics.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Span {
+	int row;
+	int col;
+};
+
+// blocks this short are cheaper to test inline than through the kernel
+const int SHORT_RUN = 8;
+
+//----------------------------------------------------------------------------
+// similarBlock()
+// Precondition: candidates and neighbours hold length pixels, length is
+//				 from 1 to 64
+// Postcondition: Returns a mask with bit i set if candidates[i] may join
+//				  the region from neighbours[i]
+template <class Policy>
+inline uint64_t similarBlock(const pixel *candidates, const pixel *neighbours,
+	int length, const Policy &policy) {
+	if (length > SHORT_RUN) {
+		return policy.similarMask(candidates, neighbours, length);
+	}
+	uint64_t similar = 0;
+	for (int i = 0; i < length; i++) {
+		similar |= (uint64_t)policy.isSimilar(candidates[i], neighbours[i]) << i;
+	}
+	return similar;
+}
+
+//----------------------------------------------------------------------------
+// isOpen()
+// Precondition: in is the row span of row, col is a column of row
+// Postcondition: Returns true if the pixel is unvisited and may join the
+//				  region from neighbour
+template <class Policy>
+inline bool isOpen(int row, int col, const pixel *in, const pixel &neighbour,
+	const visitedSet &visited, const Policy &policy) {
+	return !visited.isVisited(row, col) && policy.isSimilar(in[col], neighbour);
+}
+
+//----------------------------------------------------------------------------
+// openMask()
+// Precondition: in is the row span of row, col + length - 1 is a column of
+//				 row, length is from 1 to 64 and neighbours holds length
+//				 pixels
+// Postcondition: Returns a mask with bit i set if pixel col + i is
+//				  unvisited and may join the region from neighbours[i]
+template <class Policy>
+inline uint64_t openMask(int row, int col, int length, const pixel *in,
+	const pixel *neighbours, const visitedSet &visited, const Policy &policy) {
+	return similarBlock(in + col, neighbours, length, policy) &
+		~visited.bitsFrom(row, col);
+}
+
+//----------------------------------------------------------------------------
+// linkMask()
+// Precondition: in is a row span, col + length - 1 is a column of it and
+//				 length is from 1 to 64
+// Postcondition: Returns a mask with bit i set if pixel col + i can be
+//				  reached from pixel col + i - 1, so a run of open pixels
+//				  needs only its first one pushed. Policies that do not look
+//				  at the neighbour link every pixel.
+template <class Policy>
+inline uint64_t linkMask(const pixel *in, int col, int length,
+	const Policy &policy) {
+	if (!Policy::RELATIVE) {
+		return ~0ull;
+	}
+	if (col > 0) {
+		return similarBlock(in + col, in + col - 1, length, policy);
+	}
+	return length > 1 ? similarBlock(in + 1, in, length - 1, policy) << 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+// offsetMask()
+// Precondition: in and from are row spans, col + length - 1 is a column
+//				 and length is from 1 to 64, first + offset and
+//				 last + offset are columns
+// Postcondition: Returns a mask with bit i set if pixel col + i lies from
+//				  first to last and may join the region from pixel
+//				  col + i + offset of from
+template <class Policy>
+inline uint64_t offsetMask(const pixel *in, const pixel *from, int col,
+	int length, int first, int last, int offset, const Policy &policy) {
+	int start = max(col, first);
+	int end = min(col + length - 1, last);
+	if (start > end) {
+		return 0;
+	}
+	return similarBlock(in + start, from + start + offset, end - start + 1,
+		policy) << (start - col);
+}
+
+//----------------------------------------------------------------------------
+// reachMask()
+// Precondition: in is the row span of row, from the span of the row next
+//				 to it where left to right was just claimed, col + length - 1
+//				 is a column and length is from 1 to 64
+// Postcondition: Returns a mask with bit i set if pixel col + i is
+//				  unvisited and may join the region from a pixel of the
+//				  claimed run it touches
+template <connectivity Connect, class Policy>
+inline uint64_t reachMask(int row, int col, int length, int left, int right,
+	const pixel *in, const pixel *from, const visitedSet &visited,
+	const Policy &policy) {
+	uint64_t similar;
+	if (Connect == CONNECT_8 && Policy::RELATIVE) {
+		// straight across, then from the claimed pixel to either side
+		similar = offsetMask(in, from, col, length, left, right, 0, policy) |
+			offsetMask(in, from, col, length, left + 1, right + 1, -1, policy) |
+			offsetMask(in, from, col, length, left - 1, right - 1, 1, policy);
+	} else {
+		similar = similarBlock(in + col, from + col, length, policy);
+	}
+	return similar & ~visited.bitsFrom(row, col);
+}
+
+//----------------------------------------------------------------------------
+// pushRuns()
+// Precondition: in is the row span of row, from the span of the row next
+//				 to it where left <= right was just claimed
+// Postcondition: Pushes the first column of every run of pixels of row
+//				  that are unvisited and reachable from the claimed run
+template <connectivity Connect, class Policy>
+void pushRuns(int row, int left, int right, int cols, const pixel *in,
+	const pixel *from, const visitedSet &visited, const Policy &policy,
+	vector<Span> &stack) {
+	int low = left;
+	int high = right;
+	if (Connect == CONNECT_8) {
+		low = max(left - 1, 0);
+		high = min(right + 1, cols - 1);
+	}
+	uint64_t carry = 0;		// last pixel of the previous block was open
+	for (int col = low; col <= high; col += 64) {
+		int length = high - col + 1 < 64 ? high - col + 1 : 64;
+		uint64_t open = reachMask<Connect>(row, col, length, left, right, in,
+			from, visited, policy);
+		uint64_t starts = open & ~((open << 1 | carry) &
+			linkMask(in, col, length, policy));
+		while (starts != 0) {
+			stack.push_back({ row, col + trailingZeros(starts) });
+			starts &= starts - 1;
+		}
+		carry = open >> 63;
+	}
+}
+
+//----------------------------------------------------------------------------
+// growRegion()
+// Precondition: (row, col) is an unvisited pixel of inputIM, label is a
+//				 region of result seeded there
+// Postcondition: Every unvisited pixel connected to (row, col) through
+//				  pixels the policy accepts is labelled, added to the
+//				  region and marked visited. stack is left empty.
+template <connectivity Connect, class Policy>
+void growRegion(int row, int col, uint32_t label, Policy &policy,
+	const imageClass &inputIM, visitedSet &visited,
+	segmentationResult &result, vector<Span> &stack) {
+	const int rows = inputIM.getRow();
+	const int cols = inputIM.getCol();
+	labelMap &labels = result.getLabels();
+	regionStore &regions = result.getRegions();
+
+	stack.clear();
+	stack.push_back({ row, col });
+	// kept locally and recorded once per region
+	uint64_t spans = 0;
+	uint64_t pixels = 0;
+	size_t deepest = 1;
+	while (!stack.empty()) {
+		Span span = stack.back();
+		stack.pop_back();
+		spans++;
+		const pixel *in = inputIM.rowSpan(span.row);
+
+		// an earlier span may already have claimed this pixel
+		if (visited.isVisited(span.row, span.col)) {
+			continue;
+		}
+
+		// widest run of unvisited, similar pixels on this row, the next
+		// pixel alone is checked first and then a short block, since most
+		// runs end quickly
+		int left = span.col;
+		int block = SHORT_RUN;
+		while (left > 0 &&
+			isOpen(span.row, left - 1, in, in[left], visited, policy)) {
+			int length = left < block ? left : block;
+			uint64_t open = openMask(span.row, left - length, length, in,
+				in + left - length + 1, visited, policy);
+			// open pixels counted down from the top of the block
+			uint64_t closed = ~(open << (64 - length));
+			int run = closed == 0 ? 64 : leadingZeros(closed);
+			left -= run;
+			if (run < length) {
+				break;
+			}
+			block = 64;
+		}
+		int right = span.col;
+		block = SHORT_RUN;
+		while (right < cols - 1 &&
+			isOpen(span.row, right + 1, in, in[right], visited, policy)) {
+			int length = cols - 1 - right < block ? cols - 1 - right : block;
+			uint64_t closed = ~openMask(span.row, right + 1, length, in,
+				in + right, visited, policy);
+			int run = closed == 0 ? 64 : trailingZeros(closed);
+			right += run;
+			if (run < length) {
+				break;
+			}
+			block = 64;
+		}
+
+		// claim the run
+		visited.markRange(span.row, left, right);
+		uint32_t *labelRow = labels.rowSpan(span.row);
+		for (int c = left; c <= right; c++) {
+			labelRow[c] = label;
+		}
+		regions.addRun(label, span.row, left, right, in);
+		policy.claim(in, left, right);
+		pixels += right - left + 1;
+
+		// edges shared with pixels of the region claimed earlier
+		int joined = 0;
+		if (left > 0 && labelRow[left - 1] == label) {
+			joined++;
+		}
+		if (right < cols - 1 && labelRow[right + 1] == label) {
+			joined++;
+		}
+		if (span.row > 0) {
+			joined += countLabel(labels.rowSpan(span.row - 1), left, right,
+				label);
+		}
+		if (span.row < rows - 1) {
+			joined += countLabel(labels.rowSpan(span.row + 1), left, right,
+				label);
+		}
+		if (joined > 0) {
+			regions.joinEdges(label, joined);
+		}
+
+		// runs touching this one on the neighbouring rows
+		int above = span.row - 1;
+		if (above >= 0) {
+			pushRuns<Connect>(above, left, right, cols, inputIM.rowSpan(above),
+				in, visited, policy, stack);
+		}
+		int below = span.row + 1;
+		if (below < rows) {
+			pushRuns<Connect>(below, left, right, cols, inputIM.rowSpan(below),
+				in, visited, policy, stack);
+		}
+		if (stack.size() > deepest) {
+			deepest = stack.size();
+		}
+	}
+	metricAdd(COUNTER_SPANS, spans);
+	metricAdd(COUNTER_PIXELS, pixels);
+	metricPeakAt(PEAK_STACK, deepest);
+}
+
+//----------------------------------------------------------------------------
+// fillRegion()
+// Precondition: (row, col) is an unvisited pixel of inputIM
+// Postcondition: Adds a region seeded at (row, col) to result, grows it
+//				  with a Policy made from the seed colour and threshold,
+//				  and returns its label. stack is scratch space.
+template <connectivity Connect, class Policy>
+uint32_t fillRegion(int row, int col, const imageClass &inputIM,
+	visitedSet &visited, segmentationResult &result, int threshold,
+	vector<Span> &stack) {
+	const pixel colour = inputIM.rowSpan(row)[col];
+	const uint32_t label = result.addRegion(row, col, colour);
+	Policy policy(colour, threshold);
+	growRegion<Connect>(row, col, label, policy, inputIM, visited, result,
+		stack);
+	return label;
+}
+
+// one instance of fillRegion
+typedef uint32_t (*regionFiller)(int, int, const imageClass &, visitedSet &,
+	segmentationResult &, int, vector<Span> &);
+
+template <connectivity Connect, colorMetric Metric>
+regionFiller fillerFor(similarityRule similarity) {
+	switch (similarity) {
+	case SIMILAR_NEIGHBOUR:
+		return fillRegion<Connect, neighbourPolicy<Metric>>;
+	case SIMILAR_MEAN:
+		return fillRegion<Connect, meanPolicy<Metric>>;
+	case SIMILAR_LUMA:
+		return fillRegion<Connect, lumaPolicy>;
+	case SIMILAR_SEED:
+	default:
+		return fillRegion<Connect, seedPolicy<Metric>>;
+	}
+}
+
+template <connectivity Connect>
+regionFiller fillerFor(similarityRule similarity, colorMetric metric) {
+	switch (metric) {
+	case METRIC_L2:
+		return fillerFor<Connect, METRIC_L2>(similarity);
+	case METRIC_MAX:
+		return fillerFor<Connect, METRIC_MAX>(similarity);
+	case METRIC_L1:
+	default:
+		return fillerFor<Connect, METRIC_L1>(similarity);
+	}
+}
+
+//----------------------------------------------------------------------------
+// pickFiller()
+// Postcondition: Returns the fillRegion instance that grows regions the
+//				  way growing asks
+regionFiller pickFiller(const growOptions &growing) {
+	if (growing.connect == CONNECT_8) {
+		return fillerFor<CONNECT_8>(growing.similarity, growing.metric);
+	}
+	return fillerFor<CONNECT_4>(growing.similarity, growing.metric);
+}
+
+}
+
+//----------------------------------------------------------------------------
+// floodFill()
+// Precondition: row and col are within the bounds of inputIM and not yet
+//				 visited, visited and result cover the same size as inputIM
+// Postcondition: Adds a region seeded with the pixel at (row, col) to
+//				  result. Every unvisited pixel 4-connected to the seed whose
+//				  colour is within threshold of it by metric is labelled,
+//				  counted in the region statistics and marked visited.
+//				  Returns the label of the new region.
+uint32_t floodFill(int row, int col, const imageClass &inputIM,
+	visitedSet &visited, segmentationResult &result, int threshold,
+	colorMetric metric) {
+	const growOptions growing = { CONNECT_4, SIMILAR_SEED, threshold, metric };
+	return floodFill(row, col, inputIM, visited, result, growing);
+}
+
+//----------------------------------------------------------------------------
+// floodFill()
+// Precondition: row and col are within the bounds of inputIM and not yet
+//				 visited, visited and result cover the same size as inputIM
+// Postcondition: Adds a region seeded with the pixel at (row, col) to
+//				  result and grows it the way growing asks. Returns the
+//				  label of the new region.
+uint32_t floodFill(int row, int col, const imageClass &inputIM,
+	visitedSet &visited, segmentationResult &result,
+	const growOptions &growing) {
+	if (row < 0 || col < 0 || row >= inputIM.getRow() ||
+		col >= inputIM.getCol()) {
+		return NO_LABEL;
+	}
+	vector<Span> stack;
+	return pickFiller(growing)(row, col, inputIM, visited, result,
+		growing.threshold, stack);
+}
+
+//----------------------------------------------------------------------------
+// floodFillAll()
+// Precondition: result covers the same size as inputIM
+// Postcondition: Every pixel of inputIM belongs to a region grown the way
+//				  growing asks, seeded in scan order at the first pixel no
+//				  earlier region took
+void floodFillAll(const imageClass &inputIM, segmentationResult &result,
+	const growOptions &growing) {
+	const int rows = inputIM.getRow();
+	const int cols = inputIM.getCol();
+	visitedSet visited;
+	visited.reset(rows, cols);
+	// picked once, so the loops below run one instance of the engine
+	regionFiller filler = pickFiller(growing);
+	vector<Span> stack;
+	stack.reserve(rows);
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < cols; j++) {
+			if (!visited.isVisited(i, j)) {
+				filler(i, j, inputIM, visited, result, growing.threshold, stack);
+			}
+		}
+	}
+}
@@ -0,0 +1,50 @@
+// floodFill.h
+// Author: Terence Ho
+//
+// This file describes the iterative region-growing engine that replaces the
+// recursive pixelCheck method. Pixels are claimed a horizontal span at a time
+// and the spans above and below are pushed on an explicit stack, so memory
+// use is bounded by the number of open spans instead of the region area.
+// Regions can grow through 4 or 8 neighbours and compare candidates with
+// the seed, with the pixel they were reached from, with the region average
+// or with the seed brightness, see growPolicies.h.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "labelMap.h"
+#include "pixelKernels.h"
+#include "segmentation.h"
+
+//----------------------------------------------------------------------------
+// floodFill()
+// Precondition: row and col are within the bounds of inputIM and not yet
+//				 visited, visited and result cover the same size as inputIM
+// Postcondition: Adds a region seeded with the pixel at (row, col) to
+//				  result. Every unvisited pixel 4-connected to the seed whose
+//				  colour is within threshold of it by metric is labelled,
+//				  counted in the region statistics and marked visited.
+//				  Returns the label of the new region.
+uint32_t floodFill(int row, int col, const imageClass &inputIM,
+	visitedSet &visited, segmentationResult &result,
+	int threshold = SEED_THRESHOLD, colorMetric metric = METRIC_L1);
+
+//----------------------------------------------------------------------------
+// floodFill()
+// Precondition: row and col are within the bounds of inputIM and not yet
+//				 visited, visited and result cover the same size as inputIM
+// Postcondition: Adds a region seeded with the pixel at (row, col) to
+//				  result and grows it the way growing asks. Returns the
+//				  label of the new region.
+uint32_t floodFill(int row, int col, const imageClass &inputIM,
+	visitedSet &visited, segmentationResult &result,
+	const growOptions &growing);
+
+//----------------------------------------------------------------------------
+// floodFillAll()
+// Precondition: result covers the same size as inputIM
+// Postcondition: Every pixel of inputIM belongs to a region grown the way
+//				  growing asks, seeded in scan order at the first pixel no
+//				  earlier region took
+void floodFillAll(const imageClass &inputIM, segmentationResult &result,
+	const growOptions &growing = DEFAULT_GROW);
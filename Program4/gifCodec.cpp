@@ -0,0 +1,669 @@
+// gifCodec.cpp
+// Author: Terence Ho
+//
+// GIF decoding and encoding. Only the first image of a file is read, and
+// images are written as a single GIF87a frame with a global palette.
+//---------------------------------------------------------------------------
+#include "gifCodec.h"
+#include "metrics.h"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int MAX_CODES = 4096;		// LZW codes are at most 12 bits
+
+// Rows of each interlace pass start here and skip this many rows
+const int PASS_START[4] = { 0, 4, 2, 1 };
+const int PASS_STEP[4] = { 8, 8, 4, 2 };
+
+//----------------------------------------------------------------------------
+// Colour to palette index table with open addressing, sized for the
+// 256 colours a GIF palette can hold.
+class paletteMap {
+public:
+	paletteMap() : count(0) {
+		memset(keys, 0, sizeof(keys));
+	}
+
+	// Returns the index of colour, adding it if there is room, or -1 when
+	// the palette is already full
+	int lookup(const pixel &colour) {
+		uint32_t key = ((uint32_t)colour.red << 16 |
+			(uint32_t)colour.green << 8 | colour.blue) + 1;
+		uint32_t slot = (key * 2654435761u) >> (32 - TABLE_BITS);
+		while (keys[slot] != 0) {
+			if (keys[slot] == key) {
+				return values[slot];
+			}
+			slot = (slot + 1) & (TABLE_SIZE - 1);
+		}
+		if (count == 256) {
+			return -1;
+		}
+		keys[slot] = key;
+		values[slot] = (uint8_t)count;
+		colours[count] = colour;
+		return count++;
+	}
+
+	int size() const {
+		return count;
+	}
+
+	const pixel &colour(int index) const {
+		return colours[index];
+	}
+
+private:
+	static const int TABLE_BITS = 10;
+	static const int TABLE_SIZE = 1 << TABLE_BITS;
+	uint32_t keys[TABLE_SIZE];		// colour + 1, 0 marks an empty slot
+	uint8_t values[TABLE_SIZE];
+	pixel colours[256];
+	int count;
+};
+
+//----------------------------------------------------------------------------
+// cubeIndex()
+// Postcondition: Returns the entry of the 6x7x6 colour cube nearest colour
+inline uint8_t cubeIndex(const pixel &colour) {
+	return (uint8_t)((colour.red * 6 >> 8) * 42 + (colour.green * 7 >> 8) * 6 +
+		(colour.blue * 6 >> 8));
+}
+
+//----------------------------------------------------------------------------
+// Writes LZW codes packed into data sub-blocks of at most 255 bytes
+class codeWriter {
+public:
+	explicit codeWriter(vector<unsigned char> &out)
+		: out(out), bits(0), bitCount(0), blockLen(0) {
+	}
+
+	void write(int code, int codeSize) {
+		bits |= (uint32_t)code << bitCount;
+		bitCount += codeSize;
+		while (bitCount >= 8) {
+			putByte((unsigned char)(bits & 0xFF));
+			bits >>= 8;
+			bitCount -= 8;
+		}
+	}
+
+	// Writes the bits left over and the block terminator
+	void finish() {
+		if (bitCount > 0) {
+			putByte((unsigned char)(bits & 0xFF));
+			bits = 0;
+			bitCount = 0;
+		}
+		flushBlock();
+		out.push_back(0);
+	}
+
+private:
+	vector<unsigned char> &out;
+	uint32_t bits;
+	int bitCount;
+	unsigned char block[255];
+	int blockLen;
+
+	void putByte(unsigned char value) {
+		block[blockLen++] = value;
+		if (blockLen == 255) {
+			flushBlock();
+		}
+	}
+
+	void flushBlock() {
+		if (blockLen > 0) {
+			out.push_back((unsigned char)blockLen);
+			out.insert(out.end(), block, block + blockLen);
+			blockLen = 0;
+		}
+	}
+};
+
+//----------------------------------------------------------------------------
+// LZW compressor with the string table kept in an open addressing hash
+// keyed by (prefix code, next index)
+class lzwEncoder {
+public:
+	lzwEncoder(int minCodeSize, codeWriter &writer)
+		: writer(writer), minCodeSize(minCodeSize), current(-1) {
+		clearCode = 1 << minCodeSize;
+		resetTable();
+		output(clearCode);
+	}
+
+	void add(uint8_t index) {
+		if (current < 0) {
+			current = index;
+			return;
+		}
+		uint32_t key = (uint32_t)current << 8 | index;
+		uint32_t slot = (key * 2654435761u) >> (32 - TABLE_BITS);
+		while (keys[slot] != EMPTY) {
+			if (keys[slot] == key) {
+				current = codes[slot];
+				return;
+			}
+			slot = (slot + 1) & (TABLE_SIZE - 1);
+		}
+		output(current);
+		current = index;
+		if (nextCode >= MAX_CODES - 1) {
+			output(clearCode);
+			resetTable();
+		} else {
+			keys[slot] = key;
+			codes[slot] = (uint16_t)nextCode++;
+		}
+	}
+
+	void finish() {
+		if (current >= 0) {
+			output(current);
+		}
+		output(clearCode + 1);
+		writer.finish();
+	}
+
+private:
+	static const int TABLE_BITS = 13;
+	static const int TABLE_SIZE = 1 << TABLE_BITS;
+	static const uint32_t EMPTY = 0xFFFFFFFFu;
+
+	codeWriter &writer;
+	int minCodeSize;
+	int clearCode;
+	int codeSize;
+	int nextCode;
+	int current;		// code of the string matched so far, -1 if none
+	uint32_t keys[TABLE_SIZE];
+	uint16_t codes[TABLE_SIZE];
+
+	void resetTable() {
+		memset(keys, 0xFF, sizeof(keys));
+		codeSize = minCodeSize + 1;
+		nextCode = clearCode + 2;
+	}
+
+	// Codes grow a bit once the next free code no longer fits
+	void output(int code) {
+		writer.write(code, codeSize);
+		if (nextCode >= (1 << codeSize) && codeSize < 12) {
+			codeSize++;
+		}
+	}
+};
+
+void putWord(vector<unsigned char> &out, int value) {
+	out.push_back((unsigned char)(value & 0xFF));
+	out.push_back((unsigned char)((value >> 8) & 0xFF));
+}
+
+}
+
+//---------------------------------------------------------------------------
+// gifDecoder()
+// Creates a decoder with no file open
+gifDecoder::gifDecoder() : file(nullptr) {
+	close();
+}
+
+//---------------------------------------------------------------------------
+// ~gifDecoder()
+// Postcondition: Closes the file if one is open
+gifDecoder::~gifDecoder() {
+	close();
+}
+
+//---------------------------------------------------------------------------
+// open()
+// Precondition: filename refers to a file that stores a GIF image
+// Postcondition: Reads everything up to the pixel data of the first
+//				  image. Returns false if the file can not be read or
+//				  holds no image.
+bool gifDecoder::open(const string &filename) {
+	close();
+	file = fopen(filename.c_str(), "rb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	char signature[6];
+	for (int i = 0; i < 6; i++) {
+		signature[i] = (char)readByte();
+	}
+	if (memcmp(signature, "GIF87a", 6) != 0 &&
+		memcmp(signature, "GIF89a", 6) != 0) {
+		close();
+		return false;
+	}
+
+	// logical screen descriptor and global palette
+	readWord();
+	readWord();
+	int flags = readByte();
+	readByte();
+	readByte();
+	if ((flags & 0x80) != 0 && !readPalette(2 << (flags & 7))) {
+		close();
+		return false;
+	}
+
+	for (;;) {
+		int block = readByte();
+		if (block == 0x21) {
+			// extension: label then sub-blocks
+			readByte();
+			int length;
+			while ((length = readByte()) > 0) {
+				for (int i = 0; i < length; i++) {
+					readByte();
+				}
+			}
+			if (length < 0) {
+				break;
+			}
+		} else if (block == 0x2C) {
+			readWord();
+			readWord();
+			int width = readWord();
+			int height = readWord();
+			int imageFlags = readByte();
+			if ((imageFlags & 0x80) != 0 && !readPalette(2 << (imageFlags & 7))) {
+				break;
+			}
+			minCodeSize = readByte();
+			if (width <= 0 || height <= 0 || minCodeSize < 1 || minCodeSize > 11) {
+				break;
+			}
+			rows = height;
+			cols = width;
+			interlaced = (imageFlags & 0x40) != 0;
+			clearCode = 1 << minCodeSize;
+			for (int code = 0; code < clearCode; code++) {
+				suffix[code] = (uint8_t)code;
+				firstChar[code] = (uint8_t)code;
+			}
+			resetCodes();
+			return true;
+		} else {
+			// trailer, end of file or an unknown block
+			break;
+		}
+	}
+	close();
+	return false;
+}
+
+//---------------------------------------------------------------------------
+// close()
+// Postcondition: Closes the file, getRow() and getCol() return 0
+void gifDecoder::close() {
+	if (file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+	bufferPos = 0;
+	bufferLen = 0;
+	rows = 0;
+	cols = 0;
+	interlaced = false;
+	rowsRead = 0;
+	pass = 0;
+	nextRow = 0;
+	memset(palette, 0, sizeof(palette));
+	minCodeSize = 0;
+	codeSize = 0;
+	clearCode = 0;
+	nextCode = 0;
+	prevCode = -1;
+	finished = false;
+	stackLen = 0;
+	bitBuffer = 0;
+	bitCount = 0;
+	blockLeft = 0;
+}
+
+int gifDecoder::getRow() const {
+	return rows;
+}
+
+int gifDecoder::getCol() const {
+	return cols;
+}
+
+//---------------------------------------------------------------------------
+// isInterlaced()
+// Postcondition: Returns true if rows are stored in interlaced order
+bool gifDecoder::isInterlaced() const {
+	return interlaced;
+}
+
+//---------------------------------------------------------------------------
+// hasRows()
+// Postcondition: Returns true while rows are left to read
+bool gifDecoder::hasRows() const {
+	return rowsRead < rows;
+}
+
+//---------------------------------------------------------------------------
+// nextRowIndex()
+// Precondition: hasRows() is true
+// Postcondition: Returns the image row readRow() fills next, rows come
+//				  in order unless the image is interlaced
+int gifDecoder::nextRowIndex() const {
+	return nextRow;
+}
+
+//---------------------------------------------------------------------------
+// readRow()
+// Precondition: hasRows() is true, target holds getCol() pixels
+// Postcondition: target holds the row nextRowIndex() named. Pixels
+//				  past the end of damaged data are black.
+//				  Returns false if the data ended early.
+bool gifDecoder::readRow(pixel *target) {
+	int col = 0;
+	while (col < cols) {
+		if (stackLen == 0 && !fillStack()) {
+			break;
+		}
+		// copy as much of the decoded string as fits in the row
+		int count = min(stackLen, cols - col);
+		for (int i = 0; i < count; i++) {
+			target[col++] = palette[stack[--stackLen]];
+		}
+	}
+	bool complete = col == cols;
+	if (!complete) {
+		memset(target + col, 0, (cols - col) * sizeof(pixel));
+	}
+
+	rowsRead++;
+	if (interlaced) {
+		nextRow += PASS_STEP[pass];
+		while (nextRow >= rows && pass < 3) {
+			pass++;
+			nextRow = PASS_START[pass];
+		}
+	} else {
+		nextRow++;
+	}
+	return complete;
+}
+
+//---------------------------------------------------------------------------
+// readByte()
+// Postcondition: Returns the next byte of the file, or -1 at the end
+int gifDecoder::readByte() {
+	if (bufferPos == bufferLen) {
+		if (file == nullptr) {
+			return -1;
+		}
+		bufferLen = fread(buffer, 1, sizeof(buffer), file);
+		bufferPos = 0;
+		if (bufferLen == 0) {
+			return -1;
+		}
+	}
+	return buffer[bufferPos++];
+}
+
+//---------------------------------------------------------------------------
+// readWord()
+// Postcondition: Returns the next little endian 16-bit value
+int gifDecoder::readWord() {
+	int low = readByte();
+	int high = readByte();
+	if (low < 0 || high < 0) {
+		return -1;
+	}
+	return low | high << 8;
+}
+
+//---------------------------------------------------------------------------
+// readDataByte()
+// Postcondition: Returns the next byte of the image data sub-blocks,
+//				  or -1 once the terminating empty block is reached
+int gifDecoder::readDataByte() {
+	if (blockLeft == 0) {
+		blockLeft = readByte();
+		if (blockLeft <= 0) {
+			blockLeft = 0;
+			finished = true;
+			return -1;
+		}
+	}
+	blockLeft--;
+	return readByte();
+}
+
+//---------------------------------------------------------------------------
+// readCode()
+// Postcondition: Returns the next codeSize bit code, or -1 if the data
+//				  ran out
+int gifDecoder::readCode() {
+	while (bitCount < codeSize) {
+		int value = readDataByte();
+		if (value < 0) {
+			return -1;
+		}
+		bitBuffer |= (uint32_t)value << bitCount;
+		bitCount += 8;
+	}
+	int code = (int)(bitBuffer & ((1u << codeSize) - 1));
+	bitBuffer >>= codeSize;
+	bitCount -= codeSize;
+	return code;
+}
+
+//---------------------------------------------------------------------------
+// readPalette()
+// Precondition: entries is the size of the colour table that follows
+// Postcondition: palette holds the colour table, returns false if the
+//				  file ended
+bool gifDecoder::readPalette(int entries) {
+	memset(palette, 0, sizeof(palette));
+	for (int i = 0; i < entries; i++) {
+		int red = readByte();
+		int green = readByte();
+		int blue = readByte();
+		if (blue < 0) {
+			return false;
+		}
+		palette[i].red = (byte)red;
+		palette[i].green = (byte)green;
+		palette[i].blue = (byte)blue;
+	}
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// resetCodes()
+// Postcondition: String table holds only the single index codes
+void gifDecoder::resetCodes() {
+	codeSize = minCodeSize + 1;
+	nextCode = clearCode + 2;
+	prevCode = -1;
+}
+
+//---------------------------------------------------------------------------
+// fillStack()
+// Precondition: stack is empty
+// Postcondition: stack holds the string of the next data code, last
+//				  index first. Returns false at the end of the data.
+bool gifDecoder::fillStack() {
+	while (!finished) {
+		int code = readCode();
+		if (code < 0 || code == clearCode + 1) {
+			finished = true;
+			return false;
+		}
+		if (code == clearCode) {
+			resetCodes();
+			continue;
+		}
+		if (prevCode < 0) {
+			if (code > clearCode) {
+				finished = true;
+				return false;
+			}
+			stack[stackLen++] = (uint8_t)code;
+			prevCode = code;
+			return true;
+		}
+
+		int first;
+		int walk;
+		if (code < nextCode) {
+			first = firstChar[code];
+			walk = code;
+		} else if (code == nextCode) {
+			// string is the previous string plus its own first index
+			first = firstChar[prevCode];
+			stack[stackLen++] = (uint8_t)first;
+			walk = prevCode;
+		} else {
+			finished = true;
+			return false;
+		}
+		while (walk > clearCode) {
+			stack[stackLen++] = suffix[walk];
+			walk = prefix[walk];
+		}
+		stack[stackLen++] = (uint8_t)walk;
+
+		if (nextCode < MAX_CODES) {
+			prefix[nextCode] = (uint16_t)prevCode;
+			suffix[nextCode] = (uint8_t)first;
+			firstChar[nextCode] = firstChar[prevCode];
+			nextCode++;
+			if (nextCode == (1 << codeSize) && codeSize < 12) {
+				codeSize++;
+			}
+		}
+		prevCode = code;
+		return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+// writeGIFRows()
+// Precondition: filename is a valid filename, rows and cols are greater
+//				 than 0 and rowAt(row) returns the cols pixels of each row
+// Postcondition: The pixels are saved as a GIF image. Images with at most
+//				  256 colours keep their exact colours, others are mapped
+//				  to a fixed 6x7x6 colour cube. Returns false if the file
+//				  can not be written.
+bool writeGIFRows(const string &filename, int rows, int cols,
+	const function<const pixel *(int)> &rowAt) {
+	stageTimer timer(STAGE_WRITE);
+	if (rows <= 0 || cols <= 0 || rows > 0xFFFF || cols > 0xFFFF) {
+		return false;
+	}
+
+	// exact palette while the image has few enough colours, which is
+	// always the case for average colour renders with up to 256 regions
+	paletteMap exact;
+	bool quantise = false;
+	for (int row = 0; row < rows && !quantise; row++) {
+		const pixel *source = rowAt(row);
+		pixel last = source[0];
+		if (exact.lookup(last) < 0) {
+			quantise = true;
+		}
+		for (int col = 1; col < cols && !quantise; col++) {
+			if (source[col].red != last.red || source[col].green != last.green ||
+				source[col].blue != last.blue) {
+				last = source[col];
+				quantise = exact.lookup(last) < 0;
+			}
+		}
+	}
+
+	pixel palette[256];
+	memset(palette, 0, sizeof(palette));
+	int colours;
+	if (quantise) {
+		colours = 6 * 7 * 6;
+		for (int index = 0; index < colours; index++) {
+			palette[index].red = (byte)(index / 42 * 255 / 5);
+			palette[index].green = (byte)(index / 6 % 7 * 255 / 6);
+			palette[index].blue = (byte)(index % 6 * 255 / 5);
+		}
+	} else {
+		colours = exact.size();
+		for (int index = 0; index < colours; index++) {
+			palette[index] = exact.colour(index);
+		}
+	}
+	int paletteBits = 1;
+	while ((1 << paletteBits) < colours) {
+		paletteBits++;
+	}
+	int minCodeSize = paletteBits < 2 ? 2 : paletteBits;
+
+	vector<unsigned char> out;
+	out.reserve((size_t)rows * cols / 2 + 1024);
+	const char *signature = "GIF87a";
+	out.insert(out.end(), signature, signature + 6);
+	putWord(out, cols);
+	putWord(out, rows);
+	out.push_back((unsigned char)(0x80 | (paletteBits - 1) << 4 |
+		(paletteBits - 1)));
+	out.push_back(0);
+	out.push_back(0);
+	for (int index = 0; index < (1 << paletteBits); index++) {
+		out.push_back(palette[index].red);
+		out.push_back(palette[index].green);
+		out.push_back(palette[index].blue);
+	}
+
+	// image descriptor covering the whole screen, no local palette
+	out.push_back(0x2C);
+	putWord(out, 0);
+	putWord(out, 0);
+	putWord(out, cols);
+	putWord(out, rows);
+	out.push_back(0);
+	out.push_back((unsigned char)minCodeSize);
+
+	codeWriter writer(out);
+	lzwEncoder *encoder = new lzwEncoder(minCodeSize, writer);
+	for (int row = 0; row < rows; row++) {
+		const pixel *source = rowAt(row);
+		if (quantise) {
+			for (int col = 0; col < cols; col++) {
+				encoder->add(cubeIndex(source[col]));
+			}
+		} else {
+			pixel last = source[0];
+			uint8_t index = (uint8_t)exact.lookup(last);
+			for (int col = 0; col < cols; col++) {
+				if (source[col].red != last.red ||
+					source[col].green != last.green ||
+					source[col].blue != last.blue) {
+					last = source[col];
+					index = (uint8_t)exact.lookup(last);
+				}
+				encoder->add(index);
+			}
+		}
+	}
+	encoder->finish();
+	delete encoder;
+	out.push_back(0x3B);
+
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+	return fclose(file) == 0 && written;
+}
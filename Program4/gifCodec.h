@@ -0,0 +1,119 @@
+// gifCodec.h
+// Author: Terence Ho
+//
+// This file describes the GIF reader and writer behind the ImageLib
+// functions. gifDecoder hands out the first image of a file one row at a
+// time, decoding the LZW stream straight into the row the caller provides,
+// so an image can be read into any buffer without an intermediate copy.
+// writeGIFRows() builds a palette from the pixels it is given and
+// compresses them with a hashed LZW dictionary.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+class gifDecoder {
+public:
+	// gifDecoder()
+	// Creates a decoder with no file open
+	gifDecoder();
+
+	// ~gifDecoder()
+	// Postcondition: Closes the file if one is open
+	~gifDecoder();
+
+	gifDecoder(const gifDecoder &) = delete;
+	gifDecoder& operator=(const gifDecoder &) = delete;
+
+	// open()
+	// Precondition: filename refers to a file that stores a GIF image
+	// Postcondition: Reads everything up to the pixel data of the first
+	//				  image. Returns false if the file can not be read or
+	//				  holds no image.
+	bool open(const string &filename);
+
+	// close()
+	// Postcondition: Closes the file, getRow() and getCol() return 0
+	void close();
+
+	int getRow() const;
+	int getCol() const;
+
+	// isInterlaced()
+	// Postcondition: Returns true if rows are stored in interlaced order
+	bool isInterlaced() const;
+
+	// hasRows()
+	// Postcondition: Returns true while rows are left to read
+	bool hasRows() const;
+
+	// nextRowIndex()
+	// Precondition: hasRows() is true
+	// Postcondition: Returns the image row readRow() fills next, rows come
+	//				  in order unless the image is interlaced
+	int nextRowIndex() const;
+
+	// readRow()
+	// Precondition: hasRows() is true, target holds getCol() pixels
+	// Postcondition: target holds the row nextRowIndex() named. Pixels
+	//				  past the end of damaged data are black.
+	//				  Returns false if the data ended early.
+	bool readRow(pixel *target);
+
+private:
+	FILE *file;
+	unsigned char buffer[1 << 16];	// bytes read from file but not used
+	size_t bufferPos;
+	size_t bufferLen;
+
+	int rows;
+	int cols;
+	bool interlaced;
+	int rowsRead;
+	int pass;				// interlace pass of the next row
+	int nextRow;
+	pixel palette[256];
+
+	// LZW state
+	int minCodeSize;
+	int codeSize;
+	int clearCode;
+	int nextCode;
+	int prevCode;			// -1 right after a clear code
+	bool finished;
+	uint16_t prefix[4096];
+	uint8_t suffix[4096];
+	uint8_t firstChar[4096];
+	uint8_t stack[4097];	// decoded string, last character first
+	int stackLen;
+
+	// bit reader over the data sub-blocks
+	uint32_t bitBuffer;
+	int bitCount;
+	int blockLeft;
+
+	int readByte();
+	int readWord();
+	int readDataByte();
+	int readCode();
+	bool readPalette(int entries);
+	void resetCodes();
+	bool fillStack();
+};
+
+//----------------------------------------------------------------------------
+// writeGIFRows()
+// Precondition: filename is a valid filename, rows and cols are greater
+//				 than 0 and rowAt(row) returns the cols pixels of each row
+// Postcondition: The pixels are saved as a GIF image. Images with at most
+//				  256 colours keep their exact colours, others are mapped
+//				  to a fixed 6x7x6 colour cube. Returns false if the file
+//				  can not be written.
+bool writeGIFRows(const string &filename, int rows, int cols,
+	const function<const pixel *(int)> &rowAt);
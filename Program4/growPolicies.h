@@ -0,0 +1,177 @@
+// growPolicies.h
+// Author: Terence Ho
+//
+// This file describes the similarity policies the region growing engine is
+// built with. A policy decides whether a candidate pixel joins the region,
+// given the region pixel it was reached from. Every policy has the same
+// members, and the engine takes the policy as a template argument, so the
+// test is inlined into the fill loop with no virtual call and no switch on
+// the rule per pixel:
+//
+//	RELATIVE		true if the answer depends on the neighbour, so two
+//					candidates side by side are not always in one run
+//	isSimilar()		tests one candidate against its neighbour
+//	similarMask()	tests a block of up to 64 candidates, bit i for
+//					candidates[i] against neighbours[i]
+//	claim()			called with every run added to the region
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include "pixelKernels.h"
+#include <cstdint>
+
+// Candidates are compared with the colour of the seed pixel
+template <colorMetric Metric>
+struct seedPolicy {
+	static const bool RELATIVE = false;
+	pixel colour;
+	int threshold;
+
+	seedPolicy(const pixel &seed, int limit) : colour(seed), threshold(limit) {}
+
+	bool isSimilar(const pixel &candidate, const pixel &) const {
+		return withinDistance(candidate, colour, threshold, Metric);
+	}
+
+	uint64_t similarMask(const pixel *candidates, const pixel *, int length) const {
+		uint64_t bits = 0;
+		similarPixels(candidates, length, colour, threshold, Metric, &bits);
+		return bits;
+	}
+
+	void claim(const pixel *, int, int) {}
+};
+
+// Candidates are compared with the region pixel next to them, so the
+// region follows gradual changes of colour the way connected-component
+// labelling does
+template <colorMetric Metric>
+struct neighbourPolicy {
+	static const bool RELATIVE = true;
+	int threshold;
+
+	neighbourPolicy(const pixel &, int limit) : threshold(limit) {}
+
+	bool isSimilar(const pixel &candidate, const pixel &neighbour) const {
+		return withinDistance(candidate, neighbour, threshold, Metric);
+	}
+
+	uint64_t similarMask(const pixel *candidates, const pixel *neighbours,
+		int length) const {
+		uint64_t bits = 0;
+		if (Metric == METRIC_L1) {
+			similarPairs(candidates, neighbours, length, threshold, &bits);
+		} else {
+			for (int i = 0; i < length; i++) {
+				bits |= (uint64_t)isSimilar(candidates[i], neighbours[i]) << i;
+			}
+		}
+		return bits;
+	}
+
+	void claim(const pixel *, int, int) {}
+};
+
+//----------------------------------------------------------------------------
+// stepAverage()
+// Precondition: average was the rounded value of an earlier sum and count
+// Postcondition: Returns sum / count rounded to the nearest, found by
+//				  stepping from average, which after one more pixel is at
+//				  most a few steps for any region past its first pixels
+inline byte stepAverage(byte average, uint64_t sum, uint64_t count) {
+	const uint64_t target = sum + count / 2;
+	uint64_t value = average;
+	while ((value + 1) * count <= target) {
+		value++;
+	}
+	while (value * count > target) {
+		value--;
+	}
+	return (byte)value;
+}
+
+// Candidates are compared with the average colour of the region as of the
+// last run it claimed. The sums are integers and the average is updated
+// once per run, or without a division when pixels join one at a time.
+template <colorMetric Metric>
+struct meanPolicy {
+	static const bool RELATIVE = false;
+	pixel colour;
+	int threshold;
+	uint64_t count;
+	uint64_t redSum;
+	uint64_t greenSum;
+	uint64_t blueSum;
+
+	meanPolicy(const pixel &seed, int limit) : colour(seed), threshold(limit),
+		count(0), redSum(0), greenSum(0), blueSum(0) {}
+
+	bool isSimilar(const pixel &candidate, const pixel &) const {
+		return withinDistance(candidate, colour, threshold, Metric);
+	}
+
+	uint64_t similarMask(const pixel *candidates, const pixel *, int length) const {
+		uint64_t bits = 0;
+		similarPixels(candidates, length, colour, threshold, Metric, &bits);
+		return bits;
+	}
+
+	void claim(const pixel *in, int left, int right) {
+		for (int col = left; col <= right; col++) {
+			redSum += in[col].red;
+			greenSum += in[col].green;
+			blueSum += in[col].blue;
+		}
+		count += right - left + 1;
+		colour.red = (byte)((redSum + count / 2) / count);
+		colour.green = (byte)((greenSum + count / 2) / count);
+		colour.blue = (byte)((blueSum + count / 2) / count);
+	}
+
+	void add(const pixel &in) {
+		redSum += in.red;
+		greenSum += in.green;
+		blueSum += in.blue;
+		count++;
+		colour.red = stepAverage(colour.red, redSum, count);
+		colour.green = stepAverage(colour.green, greenSum, count);
+		colour.blue = stepAverage(colour.blue, blueSum, count);
+	}
+};
+
+//----------------------------------------------------------------------------
+// lumaOf()
+// Postcondition: Returns the brightness of in from 0 to 255, with the
+//				  BT.601 weights in 8-bit fixed point
+inline int lumaOf(const pixel &in) {
+	return (77 * in.red + 150 * in.green + 29 * in.blue + 128) >> 8;
+}
+
+// Candidates are compared with the brightness of the seed pixel only, so
+// shading of one surface stays together whatever its hue. The difference
+// is counted three times, which gives a grey change the same distance as
+// the sum of channel differences.
+struct lumaPolicy {
+	static const bool RELATIVE = false;
+	int luma;
+	int threshold;
+
+	lumaPolicy(const pixel &seed, int limit) : luma(lumaOf(seed)),
+		threshold(limit) {}
+
+	bool isSimilar(const pixel &candidate, const pixel &) const {
+		int difference = lumaOf(candidate) - luma;
+		return 3 * (difference < 0 ? -difference : difference) < threshold;
+	}
+
+	uint64_t similarMask(const pixel *candidates, const pixel *, int length) const {
+		uint64_t bits = 0;
+		for (int i = 0; i < length; i++) {
+			bits |= (uint64_t)isSimilar(candidates[i], candidates[i]) << i;
+		}
+		return bits;
+	}
+
+	void claim(const pixel *, int, int) {}
+};
@@ -0,0 +1,140 @@
+// labelMap.cpp
+// Author: Terence Ho
+//
+// Label map and visited bitset used by the segmentation engines.
+//---------------------------------------------------------------------------
+#include "labelMap.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// labelMap()
+// Creates an empty 0 x 0 map
+labelMap::labelMap() : rows(0), cols(0) {
+}
+
+//---------------------------------------------------------------------------
+// reset()
+// Precondition: rows and cols are greater than or equal to 0
+// Postcondition: Map is rows x cols with every label set to NO_LABEL
+void labelMap::reset(int rows, int cols) {
+	if (rows < 0 || cols < 0) {
+		rows = 0;
+		cols = 0;
+	}
+	this->rows = rows;
+	this->cols = cols;
+	labels.assign((size_t)rows * cols, NO_LABEL);
+}
+
+//---------------------------------------------------------------------------
+// getLabel()
+// Precondition: row and col are within the map
+// Postcondition: Returns the label of the pixel
+uint32_t labelMap::getLabel(int row, int col) const {
+	return labels[(size_t)row * cols + col];
+}
+
+//---------------------------------------------------------------------------
+// setLabel()
+// Precondition: row and col are within the map
+// Postcondition: Pixel is labelled with label
+void labelMap::setLabel(int row, int col, uint32_t label) {
+	labels[(size_t)row * cols + col] = label;
+}
+
+//---------------------------------------------------------------------------
+// rowSpan()
+// Precondition: row is within the map
+// Postcondition: Returns the first of getCol() contiguous labels of row
+uint32_t *labelMap::rowSpan(int row) {
+	return labels.data() + (size_t)row * cols;
+}
+
+const uint32_t *labelMap::rowSpan(int row) const {
+	return labels.data() + (size_t)row * cols;
+}
+
+int labelMap::getRow() const {
+	return rows;
+}
+
+int labelMap::getCol() const {
+	return cols;
+}
+
+//---------------------------------------------------------------------------
+// visitedSet()
+// Creates an empty 0 x 0 set
+visitedSet::visitedSet() : rows(0), cols(0), wordsPerRow(0) {
+}
+
+//---------------------------------------------------------------------------
+// reset()
+// Precondition: rows and cols are greater than or equal to 0
+// Postcondition: Set covers rows x cols pixels, none of them visited
+void visitedSet::reset(int rows, int cols) {
+	if (rows < 0 || cols < 0) {
+		rows = 0;
+		cols = 0;
+	}
+	this->rows = rows;
+	this->cols = cols;
+	wordsPerRow = (cols + 63) / 64;
+	bits.assign((size_t)rows * wordsPerRow, 0);
+}
+
+//---------------------------------------------------------------------------
+// isVisited()
+// Precondition: row and col are within the set
+// Postcondition: Returns true if the pixel has been marked
+bool visitedSet::isVisited(int row, int col) const {
+	uint64_t word = bits[(size_t)row * wordsPerRow + (col >> 6)];
+	return ((word >> (col & 63)) & 1) != 0;
+}
+
+//---------------------------------------------------------------------------
+// markVisited()
+// Precondition: row and col are within the set
+// Postcondition: Pixel is marked as visited
+void visitedSet::markVisited(int row, int col) {
+	bits[(size_t)row * wordsPerRow + (col >> 6)] |= (uint64_t)1 << (col & 63);
+}
+
+//---------------------------------------------------------------------------
+// markRange()
+// Precondition: left <= right are columns of row
+// Postcondition: Pixels left to right of row are marked, whole
+//				  64-bit words are written at once
+void visitedSet::markRange(int row, int left, int right) {
+	uint64_t *words = bits.data() + (size_t)row * wordsPerRow;
+	int first = left >> 6;
+	int last = right >> 6;
+	uint64_t firstMask = ~(uint64_t)0 << (left & 63);
+	uint64_t lastMask = ~(uint64_t)0 >> (63 - (right & 63));
+	if (first == last) {
+		words[first] |= firstMask & lastMask;
+		return;
+	}
+	words[first] |= firstMask;
+	for (int word = first + 1; word < last; word++) {
+		words[word] = ~(uint64_t)0;
+	}
+	words[last] |= lastMask;
+}
+
+//---------------------------------------------------------------------------
+// bitsFrom()
+// Precondition: col is a column of row
+// Postcondition: Returns the marks of the 64 pixels starting at col,
+//				  bit i for column col + i, columns past the row are 0
+uint64_t visitedSet::bitsFrom(int row, int col) const {
+	const uint64_t *words = bits.data() + (size_t)row * wordsPerRow;
+	int word = col >> 6;
+	int shift = col & 63;
+	uint64_t marks = words[word] >> shift;
+	if (shift != 0 && word + 1 < wordsPerRow) {
+		marks |= words[word + 1] << (64 - shift);
+	}
+	return marks;
+}
@@ -0,0 +1,106 @@
+// labelMap.h
+// Author: Terence Ho
+//
+// This file describes the per-pixel bookkeeping used while segmenting.
+// A labelMap stores the region label of every pixel, and a visitedSet keeps
+// one bit per pixel so the region growing loop can check membership
+// without touching the much larger label or image buffers.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Label of a pixel that has not been assigned to a region
+const uint32_t NO_LABEL = 0xFFFFFFFFu;
+
+//----------------------------------------------------------------------------
+// countLabel()
+// Precondition: labels is a row of a label map, left and right are columns
+// Postcondition: Returns how many of labels[left..right] equal label
+inline int countLabel(const uint32_t *labels, int left, int right,
+	uint32_t label) {
+	int count = 0;
+	for (int col = left; col <= right; col++) {
+		count += labels[col] == label;
+	}
+	return count;
+}
+
+class labelMap {
+public:
+	// labelMap()
+	// Creates an empty 0 x 0 map
+	labelMap();
+
+	// reset()
+	// Precondition: rows and cols are greater than or equal to 0
+	// Postcondition: Map is rows x cols with every label set to NO_LABEL
+	void reset(int rows, int cols);
+
+	// getLabel()
+	// Precondition: row and col are within the map
+	// Postcondition: Returns the label of the pixel
+	uint32_t getLabel(int row, int col) const;
+
+	// setLabel()
+	// Precondition: row and col are within the map
+	// Postcondition: Pixel is labelled with label
+	void setLabel(int row, int col, uint32_t label);
+
+	// rowSpan()
+	// Precondition: row is within the map
+	// Postcondition: Returns the first of getCol() contiguous labels of row
+	uint32_t *rowSpan(int row);
+	const uint32_t *rowSpan(int row) const;
+
+	int getRow() const;
+	int getCol() const;
+
+private:
+	int rows;
+	int cols;
+	vector<uint32_t> labels;	// rows * cols labels, row by row
+};
+
+class visitedSet {
+public:
+	// visitedSet()
+	// Creates an empty 0 x 0 set
+	visitedSet();
+
+	// reset()
+	// Precondition: rows and cols are greater than or equal to 0
+	// Postcondition: Set covers rows x cols pixels, none of them visited
+	void reset(int rows, int cols);
+
+	// isVisited()
+	// Precondition: row and col are within the set
+	// Postcondition: Returns true if the pixel has been marked
+	bool isVisited(int row, int col) const;
+
+	// markVisited()
+	// Precondition: row and col are within the set
+	// Postcondition: Pixel is marked as visited
+	void markVisited(int row, int col);
+
+	// markRange()
+	// Precondition: left <= right are columns of row
+	// Postcondition: Pixels left to right of row are marked, whole
+	//				  64-bit words are written at once
+	void markRange(int row, int left, int right);
+
+	// bitsFrom()
+	// Precondition: col is a column of row
+	// Postcondition: Returns the marks of the 64 pixels starting at col,
+	//				  bit i for column col + i, columns past the row are 0
+	uint64_t bitsFrom(int row, int col) const;
+
+private:
+	int rows;
+	int cols;
+	int wordsPerRow;		// rows start on a fresh 64-bit word
+	vector<uint64_t> bits;
+};
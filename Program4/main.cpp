@@ -1,135 +1,503 @@
 // main.cpp
 // Author: Terence Ho
 //
-// This is the driver of a linkedList that is used to find the image's 
-// similar pixels and groups them together in linked lists.
+// This is the driver that is used to find the image's similar pixels and
+// groups them together in labelled regions. Each region is painted with
+// its average color in the output image.
+//
+// Usage: Program4 [--components | --tiles | --runs | --priority]
+//				   [--threads N] [--scaling]
+//				   [--stream] [--cache] [--stats FILE]
+//				   [--min-area N] [--merge-color T]
+//				   [--render average | palette | boundary] [--sweep]
+//				   [--metrics FILE] [--connect 4 | 8]
+//				   [--similar seed | neighbour | mean | luma]
+//				   [--space rgb | ycbcr | lab] [--preview MS]
+//		  Program4 --batch --out DIR [--threads N] [--queue N]
+//				   [--components | --tiles | --runs | --priority]
+//				   [--connect 4 | 8] [--similar seed | neighbour | mean | luma]
+//				   [--space rgb | ycbcr | lab] inputs...
+// Batch inputs are image files, directories of images, or @list files
+// naming one image per line. --stats saves the statistics of every region,
+// as CSV if FILE ends in .csv and as a binary column file otherwise.
+// --min-area and --merge-color join regions smaller than N pixels, or
+// neighbours whose average colours differ by less than T, after labelling.
+// --render picks the output colours: region averages, a colour per region,
+// or the region boundaries drawn over the input image, and prints how many
+// colours the output has and how many of its pixels are boundaries.
+// --sweep prints the component count at every even threshold up to 200
+// from one sorted edge list. --metrics saves the time and allocations of
+// every stage and the labelling counters as JSON, to standard output if
+// FILE is -.
+// --connect and --similar change how seed flooding grows a region: through
+// diagonal neighbours too, and comparing pixels with the pixel they were
+// reached from, the region average or the seed brightness. --priority
+// grows each region closest pixel to its average first, through the
+// neighbours --connect picks. --space compares the pixels in YCbCr or CIE
+// Lab instead of RGB, --scaling included, the averages and output stay in
+// RGB. --preview
+// segments the smallest level of an image pyramid, and finer levels while
+// they fit in MS milliseconds, prints that preview and then carries its
+// labels down to full resolution, settling only the region boundaries,
+// with pixels compared in the --space colours throughout.
 //---------------------------------------------------------------------------
-#include "linkedList.h"
 #include "ImageClass.h"
+#include "batchSegment.h"
+#include "metrics.h"
+#include "pyramidSegment.h"
+#include "rawImage.h"
+#include "regionGraph.h"
+#include "segmentation.h"
+#include "streamSegment.h"
+#include "threadPool.h"
+#include "thresholdSweep.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <new>
+#include <string>
+#include <vector>
 using namespace std;
 
-void pixelCheck(int row, int col, imageClass &inputIM, imageClass &outputIM, pixel &seed, linkedList &seedNode);
-void colorOutputPixels(int row, int col, imageClass &inputIM, imageClass &outputIM, pixel &avgPix);
-int main() {
-	// Read file
-	// Create input image object
-	imageClass input = imageClass("test.gif");
-	// Create output image object
-	imageClass output = imageClass(input.getRow(),input.getCol());
-/*
-	for (int i = 0; i < input.getRow() - 1; i++) {
-		for (int j = 0; j < input.getCol() - 1; j++) {
-			output.setPixel(i, j, 255, 255, 255);
-		}
+#if PROGRAM4_METRICS
+//----------------------------------------------------------------------------
+// Every heap allocation of the process goes through these, so --metrics
+// can report how many allocations each stage makes.
+void *operator new(size_t size) {
+	metricAllocation(size);
+	void *block = malloc(size == 0 ? 1 : size);
+	if (block == nullptr) {
+		throw bad_alloc();
 	}
-*/
+	return block;
+}
 
-	// Create linked list for merge
-	linkedList merged = linkedList();
-	// Create linked list for current
-	linkedList current = linkedList();
-	int segments = 0;
+void *operator new(size_t size, const nothrow_t &) noexcept {
+	metricAllocation(size);
+	return malloc(size == 0 ? 1 : size);
+}
 
-	// Loop through image
-	for (int i = 0; i < input.getRow()-1; i++) {
-		for (int j = 0; j < input.getCol() - 1; j++) {
-			if (output.getPixel(i, j).red == 0 &&
-				output.getPixel(i, j).green == 0 &&
-				output.getPixel(i, j).blue == 0) {
-				// make a seed pixel
-				pixel seedPixel = input.getPixel(i, j);
+void operator delete(void *block) noexcept {
+	free(block);
+}
 
-				// if it's not part of a seed
-				current.addPixel(i,j,seedPixel);
+void operator delete(void *block, const nothrow_t &) noexcept {
+	free(block);
+}
 
-				// call recursion method for forming a connected group
-				pixelCheck(i, j, input, output, seedPixel, current);
+void operator delete(void *block, size_t) noexcept {
+	free(block);
+}
+#endif
 
+void reportScaling(const imageClass &input, colorSpace space);
+void reportSweep(const imageClass &input);
+void reportRender(const segmentationResult &result, const imageClass &output);
+int streamRegions(const string &filename);
+int segmentBatch(batchOptions &options, const vector<string> &paths,
+	int threads);
+int saveMetrics(int status, const string &filename);
 
-				// find the average color of connected group
-				pixel averagePixel = current.averageColor();
+int main(int argc, char *argv[]) {
+	// Seed flooding unless another mode is asked for
+	segmentMode mode = SEGMENT_SEEDED;
+	int threads = 0;
+	bool scaling = false;
+	bool sweeping = false;
+	bool streaming = false;
+	bool cached = false;
+	bool batch = false;
+	string statsName;
+	string metricsName;
+	mergeOptions merging = { 0, 0 };
+	renderMode rendering = RENDER_AVERAGE;
+	bool renderChosen = false;
+	growOptions growing = DEFAULT_GROW;
+	colorSpace space = SPACE_RGB;
+	double previewMs = -1;
+	batchOptions batchSettings;
+	batchSettings.queueDepth = 4;
+	vector<string> batchPaths;
+	for (int arg = 1; arg < argc; arg++) {
+		string option = argv[arg];
+		if (option == "--components") {
+			mode = SEGMENT_COMPONENTS;
+		} else if (option == "--tiles") {
+			mode = SEGMENT_TILES;
+		} else if (option == "--runs") {
+			mode = SEGMENT_RUNS;
+		} else if (option == "--priority") {
+			mode = SEGMENT_PRIORITY;
+		} else if (option == "--threads" && arg + 1 < argc) {
+			threads = atoi(argv[++arg]);
+		} else if (option == "--scaling") {
+			scaling = true;
+		} else if (option == "--sweep") {
+			sweeping = true;
+		} else if (option == "--stream") {
+			streaming = true;
+		} else if (option == "--cache") {
+			cached = true;
+		} else if (option == "--stats" && arg + 1 < argc) {
+			statsName = argv[++arg];
+		} else if (option == "--metrics" && arg + 1 < argc) {
+			metricsName = argv[++arg];
+		} else if (option == "--min-area" && arg + 1 < argc) {
+			merging.minArea = (uint64_t)atoll(argv[++arg]);
+		} else if (option == "--merge-color" && arg + 1 < argc) {
+			merging.colorThreshold = atoi(argv[++arg]);
+		} else if (option == "--render" && arg + 1 < argc) {
+			renderChosen = true;
+			string name = argv[++arg];
+			if (name == "palette") {
+				rendering = RENDER_PALETTE;
+			} else if (name == "boundary") {
+				rendering = RENDER_BOUNDARY;
+			} else {
+				rendering = RENDER_AVERAGE;
+			}
+		} else if (option == "--connect" && arg + 1 < argc) {
+			growing.connect = atoi(argv[++arg]) == 8 ? CONNECT_8 : CONNECT_4;
+		} else if (option == "--similar" && arg + 1 < argc) {
+			string name = argv[++arg];
+			if (name == "neighbour") {
+				growing.similarity = SIMILAR_NEIGHBOUR;
+			} else if (name == "mean") {
+				growing.similarity = SIMILAR_MEAN;
+			} else if (name == "luma") {
+				growing.similarity = SIMILAR_LUMA;
+			} else {
+				growing.similarity = SIMILAR_SEED;
+			}
+		} else if (option == "--space" && arg + 1 < argc) {
+			string name = argv[++arg];
+			if (name == "ycbcr") {
+				space = SPACE_YCBCR;
+			} else if (name == "lab") {
+				space = SPACE_LAB;
+			} else {
+				space = SPACE_RGB;
+			}
+		} else if (option == "--preview" && arg + 1 < argc) {
+			previewMs = atof(argv[++arg]);
+		} else if (option == "--batch") {
+			batch = true;
+		} else if (option == "--out" && arg + 1 < argc) {
+			batchSettings.outputDir = argv[++arg];
+		} else if (option == "--queue" && arg + 1 < argc) {
+			batchSettings.queueDepth = atoi(argv[++arg]);
+		} else if (!option.empty() && option[0] != '-') {
+			batchPaths.push_back(option);
+		}
+	}
 
-				// merge the connected group to the merged object
-				merged.merge(current);
+	// Many images in one process, written to the --out directory
+	if (batch) {
+		batchSettings.mode = mode;
+		batchSettings.growing = growing;
+		batchSettings.space = space;
+		return saveMetrics(segmentBatch(batchSettings, batchPaths, threads),
+			metricsName);
+	}
 
-				// color output image with pixels
-				colorOutputPixels(i, j, input, output, averagePixel);
+	// Segment row by row without holding the image, no output image
+	if (streaming) {
+		return saveMetrics(streamRegions("test.gif"), metricsName);
+	}
 
-				segments++;
-				current.makeEmpty();
-			}
+	// Read file, or map the raw copy kept next to it so later runs skip
+	// decoding
+	string inputName = "test.gif";
+	if (cached && refreshRawCache(inputName, "test.raw")) {
+		inputName = "test.raw";
+	}
+	// Create input image object
+	imageClass input = imageClass(inputName);
+	if (input.getRow() == 0 || input.getCol() == 0) {
+		cout << "Can not read " << inputName << endl;
+		return saveMetrics(1, metricsName);
+	}
+	// Create output image object
+	imageClass output = imageClass(input.getRow(),input.getCol());
+
+	if (scaling) {
+		reportScaling(input, space);
+	}
+	if (sweeping) {
+		reportSweep(input);
+	}
+
+	// Label every pixel with its region
+	segmentationResult result;
+	if (previewMs >= 0) {
+		// Coarse regions first, then the same regions at full resolution
+		pyramidOptions pyramid = { mode, threads, growing, previewMs,
+			space };
+		pyramidSegmenter segmenter;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		const segmentationResult &coarse = segmenter.preview(input, pyramid);
+		chrono::duration<double, milli> elapsed =
+			chrono::steady_clock::now() - start;
+		const imageClass &level = segmenter.level(segmenter.previewLevel());
+		cout << "Preview: level " << segmenter.previewLevel() << " "
+			<< level.getRow() << "x" << level.getCol() << " regions: "
+			<< coarse.regionCount() << " ms: " << elapsed.count() << endl;
+		segmenter.refine(result);
+	} else {
+		segmentImage(input, result, mode, threads, growing, space);
+	}
+	// Fold small or similar neighbours together
+	if (merging.minArea > 0 || merging.colorThreshold > 0) {
+		int merges = mergeRegions(input, result, merging);
+		cout << "Merges: " << merges << endl;
+	}
+
+	// Total size and average color over every region
+	uint64_t mergedSize = 0;
+	uint64_t redSum = 0;
+	uint64_t greenSum = 0;
+	uint64_t blueSum = 0;
+	for (int label = 0; label < result.regionCount(); label++) {
+		const regionStats &region = result.getRegion(label);
+		mergedSize += region.count;
+		redSum += region.redSum;
+		greenSum += region.greenSum;
+		blueSum += region.blueSum;
+	}
+	if (mergedSize == 0) {
+		mergedSize = 1;
+	}
+
+	cout << "Segements: " << result.regionCount() << " Merged size:" << mergedSize << endl;
+	cout << " Average color (red): " << (int) (redSum / mergedSize) << endl;
+	cout << " Average color (green): " << (int) (greenSum / mergedSize) << endl;
+	cout << " Average color (blue): " << (int) (blueSum / mergedSize) << endl;
+
+	// Area, bounding box, centroid, colour spread and perimeter per region
+	if (!statsName.empty()) {
+		const regionTable &table = result.getTable();
+		bool csv = statsName.size() >= 4 &&
+			statsName.compare(statsName.size() - 4, 4, ".csv") == 0;
+		if (!(csv ? table.writeCSV(statsName) : table.writeBinary(statsName))) {
+			cout << "Can not write " << statsName << endl;
+			return 1;
 		}
+		cout << "Region table: " << table.size() << " regions" << endl;
+	}
+
+	// color output image with the average color of each region, or as
+	// --render asks
+	result.render(output, rendering, &input);
+	if (renderChosen) {
+		reportRender(result, output);
 	}
-	cout << "Segements: " << segments << " Merged size:" << merged.size() << endl;
-	cout << " Average color (red): " << (int) merged.averageColor().red << endl;
-	cout << " Average color (green): " << (int) merged.averageColor().green << endl;
-	cout << " Average color (blue): " << (int) merged.averageColor().blue << endl;
 
 	// create output image file
 	output.createGIF("output.gif");
 
 	// Clean up memory automatically
-	// Wait for user input before exiting
-	system("PAUSE");
+	return saveMetrics(0, metricsName);
+}
+
+//----------------------------------------------------------------------------
+// Time the tile-parallel mode with 1, 2, 4, ... threads up to the number
+// of cores
+// precondition: input is a valid image
+// postcondition: prints the throughput in megapixels per second and per
+//				  core for each thread count, pixels compared in space
+void reportScaling(const imageClass &input, colorSpace space) {
+	const double megapixels = (double)input.getRow() * input.getCol() / 1e6;
+	const int cores = threadPool::hardwareThreads();
+	// one conversion buffer for every run, so only the first allocates it
+	imageClass converted;
+	for (int threads = 1; ; threads *= 2) {
+		if (threads > cores) {
+			threads = cores;
+		}
+		threadPool pool(threads);
+		segmentationResult result;
+		segmentImage(input, result, SEGMENT_TILES, pool, DEFAULT_GROW, space,
+			&converted);	// warm up
+
+		const int repeats = 5;
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < repeats; i++) {
+			segmentImage(input, result, SEGMENT_TILES, pool, DEFAULT_GROW,
+				space, &converted);
+		}
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		double rate = megapixels * repeats / elapsed.count();
+		cout << "threads: " << threads << " regions: " << result.regionCount()
+			<< " Mpixels/s: " << rate << " per core: " << rate / threads << endl;
+		if (threads == cores) {
+			break;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Summarise the rendered image, so the output can be checked without
+// comparing files
+// precondition: output was rendered from result
+// postcondition: prints the number of distinct colours in output, the
+//				  pixels in BOUNDARY_COLOR and the pixels the label map
+//				  puts on a region boundary
+void reportRender(const segmentationResult &result, const imageClass &output) {
+	const labelMap &labels = result.getLabels();
+	const int rows = output.getRow();
+	const int cols = output.getCol();
+	// one bit for every 24-bit colour
+	vector<uint64_t> seen((1 << 24) / 64, 0);
+	uint64_t colours = 0;
+	uint64_t boundaryColoured = 0;
+	uint64_t onBoundary = 0;
+	for (int row = 0; row < rows; row++) {
+		const pixel *out = output.rowSpan(row);
+		const uint32_t *line = labels.rowSpan(row);
+		for (int col = 0; col < cols; col++) {
+			uint32_t colour = (uint32_t)out[col].red << 16 |
+				(uint32_t)out[col].green << 8 | out[col].blue;
+			uint64_t bit = (uint64_t)1 << (colour % 64);
+			colours += (seen[colour / 64] & bit) == 0;
+			seen[colour / 64] |= bit;
+			boundaryColoured += out[col].red == BOUNDARY_COLOR.red &&
+				out[col].green == BOUNDARY_COLOR.green &&
+				out[col].blue == BOUNDARY_COLOR.blue;
+			onBoundary += (row > 0 && labels.rowSpan(row - 1)[col] != line[col]) ||
+				(row + 1 < rows && labels.rowSpan(row + 1)[col] != line[col]) ||
+				(col > 0 && line[col - 1] != line[col]) ||
+				(col + 1 < cols && line[col + 1] != line[col]);
+		}
+	}
+	cout << "Rendered colours: " << colours << " boundary coloured: "
+		<< boundaryColoured << " on a boundary: " << onBoundary << endl;
+}
+
+//----------------------------------------------------------------------------
+// Count the connected components at 100 thresholds from one sorted edge
+// list, each one only adding the edges above the last
+// precondition: input is a valid image
+// postcondition: prints the region count at every even threshold up to
+//				  200 and the time the whole sweep took
+void reportSweep(const imageClass &input) {
+	auto start = chrono::steady_clock::now();
+	thresholdSweep sweep;
+	sweep.build(input);
+	for (int threshold = 2; threshold <= 200; threshold += 2) {
+		sweep.setThreshold(threshold);
+		cout << "threshold: " << threshold << " regions: "
+			<< sweep.regionCount() << endl;
+	}
+	chrono::duration<double, milli> elapsed =
+		chrono::steady_clock::now() - start;
+	cout << "Sweep ms: " << elapsed.count() << endl;
+}
+
+//----------------------------------------------------------------------------
+// Segment a file with the streaming mode, which never holds the whole image
+// precondition: filename refers to a GIF image
+// postcondition: prints the region count and average colour like the other
+//				  modes, returns 1 if the file can not be read
+int streamRegions(const string &filename) {
+	uint64_t regions = 0;
+	uint64_t mergedSize = 0;
+	uint64_t redSum = 0;
+	uint64_t greenSum = 0;
+	uint64_t blueSum = 0;
+	bool read = segmentStream(filename, [&](const regionStats &region) {
+		regions++;
+		mergedSize += region.count;
+		redSum += region.redSum;
+		greenSum += region.greenSum;
+		blueSum += region.blueSum;
+	});
+	if (!read) {
+		cout << "Can not read " << filename << endl;
+		return 1;
+	}
+	if (mergedSize == 0) {
+		mergedSize = 1;
+	}
+
+	cout << "Segements: " << regions << " Merged size:" << mergedSize << endl;
+	cout << " Average color (red): " << (int) (redSum / mergedSize) << endl;
+	cout << " Average color (green): " << (int) (greenSum / mergedSize) << endl;
+	cout << " Average color (blue): " << (int) (blueSum / mergedSize) << endl;
 	return 0;
 }
 
 //----------------------------------------------------------------------------
-// Precondition: Takes in a head node, inputImage, rows and columns.
-//              Head node will be created if list is size 0.
-//              inputImage must be valid, rows and columns must be
-//              greater than and equal to 0.
-// Postcondition: Recursively loop through the image pixels
-//                Compare the pixel values to add to linked list.
-//                Takes O(n^2) time
-void pixelCheck(int row, int col, imageClass &inputIM, imageClass &outputIM, pixel &seed, linkedList &seedNode) {
-	// Check if pixel is within input image bounds
-    if (inputIM.getCol() <= col ||
-		inputIM.getRow() <= row ||
-		col < 0 || row < 0) {
-		return;
-	}
-
-	// Check if pixel is already in linkedList
-	if (outputIM.getPixel(row, col).red == 255 &&
-		outputIM.getPixel(row, col).green == 255 &&
-		outputIM.getPixel(row, col).blue == 255) {
-		return;
-	}
-
-    // Check if pixel is close enough by color
-    if (abs(seed.red - inputIM.getPixel(row,col).red) +
-        abs(seed.green - inputIM.getPixel(row,col).green) +
-        abs(seed.blue - inputIM.getPixel(row,col).blue) >= 100) {
-		return;
-	}
-
-	// add pixels in the connected group
-	seedNode.addPixel(row, col, inputIM.getPixel(row, col));
-	// marks pixel as added into output image
-	outputIM.setPixel(row, col, 255, 255, 255);
-
-	// recursively call method on four directions
-	pixelCheck(row, col + 1, inputIM, outputIM, seed, seedNode);
-	pixelCheck(row, col - 1, inputIM, outputIM, seed, seedNode);
-	pixelCheck(row-1, col, inputIM, outputIM, seed, seedNode);
-	pixelCheck(row+1, col, inputIM, outputIM, seed, seedNode);
+// Segment every image named by paths with the batch pipeline
+// precondition: options.outputDir is an existing directory, threads is the
+//				 number of workers, 0 uses one per core
+// postcondition: prints the throughput and the latency of each stage,
+//				  returns 1 if any image could not be segmented
+int segmentBatch(batchOptions &options, const vector<string> &paths,
+	int threads) {
+	for (const string &path : paths) {
+		if (!listInputs(path, options.inputs)) {
+			cout << "Can not read " << path << endl;
+			return 1;
+		}
+	}
+	if (threads <= 0) {
+		threads = threadPool::hardwareThreads();
+	}
+	// segmentation is the slow stage, so it gets most of the workers
+	options.decodeWorkers = threads / 4 > 1 ? threads / 4 : 1;
+	options.encodeWorkers = threads / 4 > 1 ? threads / 4 : 1;
+	options.segmentWorkers = threads - options.decodeWorkers -
+		options.encodeWorkers;
+	if (options.segmentWorkers < 1) {
+		options.segmentWorkers = 1;
+	}
+	if (options.queueDepth < 1) {
+		options.queueDepth = 1;
+	}
+
+	batchReport report = runBatch(options);
+	double seconds = report.seconds > 0 ? report.seconds : 1e-9;
+	cout << "Images: " << report.images << " failed: " << report.failed.size()
+		<< " regions: " << report.regions << endl;
+	for (const string &name : report.failed) {
+		cout << " failed: " << name << endl;
+	}
+	cout << "Throughput: " << report.images / seconds << " images/s "
+		<< report.inputBytes / seconds / 1e6 << " MB/s "
+		<< report.pixels / seconds / 1e6 << " Mpixels/s" << endl;
+	cout << "Latency ms (p50 / p90 / p99 / max):" << endl;
+	const char *names[] = { "decode", "segment", "encode", "total" };
+	const stageLatency *stages[] = { &report.decode, &report.segment,
+		&report.encode, &report.total };
+	for (int stage = 0; stage < 4; stage++) {
+		cout << " " << names[stage] << ": " << stages[stage]->p50 << " / "
+			<< stages[stage]->p90 << " / " << stages[stage]->p99 << " / "
+			<< stages[stage]->max << endl;
+	}
+	return report.failed.empty() ? 0 : 1;
 }
 
 //----------------------------------------------------------------------------
-// Color the pixels in the output image using the average pixel colors
-// precondition: rows and columns must be valid/within bounds of input image
-//				 input and output images are valid and can be accessed through the imageClass
-// postcondition: void method, sets output image pixels with predetermined set colors
-//					to the average color pixel
-//			
-void colorOutputPixels(int row, int col, imageClass &inputIM, imageClass &outputIM, pixel &avgPix) {
-	// finds the marked pixels
-	if(outputIM.getPixel(row,col).red == 255 &&
-		outputIM.getPixel(row, col).green == 255 &&
-		outputIM.getPixel(row, col).blue == 255) {
-		// sets the pixel from the output image that has been marked into the average pixel values
-		outputIM.setPixel(row, col, avgPix.red, avgPix.green, avgPix.blue);
+// Save the metrics report once the run is over
+// precondition: status is the exit status of the run, filename is empty
+//				 for no report or - for standard output
+// postcondition: the report is written, returns status, or 1 if the file
+//				  can not be written
+int saveMetrics(int status, const string &filename) {
+	if (filename.empty()) {
+		return status;
+	}
+	if (filename == "-") {
+		writeMetricsJSON(cout);
+		return status;
+	}
+	ofstream file(filename);
+	writeMetricsJSON(file);
+	if (!file) {
+		cout << "Can not write " << filename << endl;
+		return 1;
 	}
+	cout << "Metrics: " << filename << endl;
+	return status;
 }
@@ -0,0 +1,283 @@
+// metrics.cpp
+// Author: Terence Ho
+//
+// Per-thread metric slots and the JSON report that sums them.
+//---------------------------------------------------------------------------
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+namespace {
+
+#if PROGRAM4_METRICS
+
+const char *STAGE_NAMES[STAGE_COUNT] = {
+	"read", "convert", "segment", "pyramid", "merge", "render", "write", "stats"
+};
+const char *COUNTER_NAMES[COUNTER_COUNT] = {
+	"pixels", "spans", "regions", "merges"
+};
+const char *PEAK_NAMES[PEAK_COUNT] = { "stack", "queue" };
+
+// Threads running at once beyond this share one more slot
+const unsigned METRIC_SLOTS = 256;
+
+// Everything one thread records. Only that thread writes it, so an update
+// is a load and a store, and the atomics only keep a report made while
+// other threads run from reading torn values. The shared slot is the
+// exception and is added to with read-modify-writes.
+struct alignas(64) metricSlot {
+	atomic<uint64_t> stageNs[STAGE_COUNT];
+	atomic<uint64_t> stageCalls[STAGE_COUNT];
+	atomic<uint64_t> stageAllocations[STAGE_COUNT];
+	atomic<uint64_t> stageBytes[STAGE_COUNT];
+	atomic<uint64_t> counters[COUNTER_COUNT];
+	atomic<uint64_t> peaks[PEAK_COUNT];
+	atomic<uint64_t> allocations;
+	atomic<uint64_t> bytes;
+	atomic<bool> owned;		// a running thread records into the slot
+};
+
+// zero before any code runs, so operator new can record into them during
+// static initialisation
+metricSlot slots[METRIC_SLOTS];
+metricSlot sharedSlot;
+atomic<unsigned> slotsTaken(0);
+atomic<bool> slotsOverflowed(false);	// some thread found no free slot
+
+// The slot a thread records into. Its destructor gives the slot back when
+// the thread exits, so a later thread can own it, and sends whatever the
+// thread records after that to the shared slot.
+struct slotOwner {
+	metricSlot *slot;
+
+	~slotOwner() {
+		if (slot != nullptr && slot != &sharedSlot) {
+			slot->owned.store(false, memory_order_release);
+		}
+		slot = &sharedSlot;
+	}
+};
+thread_local slotOwner threadOwner = { nullptr };
+
+//----------------------------------------------------------------------------
+// currentSlot()
+// Postcondition: Returns the slot of this thread, taking a free one on
+//				  first use, or the shared slot if every one is owned
+metricSlot &currentSlot() {
+	if (threadOwner.slot == nullptr) {
+		const unsigned start = slotsTaken++;
+		for (unsigned tried = 0; tried < METRIC_SLOTS; tried++) {
+			metricSlot &slot = slots[(start + tried) % METRIC_SLOTS];
+			// acquire pairs with the release of the last owner, so its
+			// totals are seen before this thread adds to them
+			if (!slot.owned.load(memory_order_relaxed) &&
+				!slot.owned.exchange(true, memory_order_acquire)) {
+				threadOwner.slot = &slot;
+				return slot;
+			}
+		}
+		slotsOverflowed.store(true, memory_order_relaxed);
+		threadOwner.slot = &sharedSlot;
+	}
+	return *threadOwner.slot;
+}
+
+//----------------------------------------------------------------------------
+// bump()
+// Precondition: value belongs to slot, the slot of this thread
+// Postcondition: amount is added to value
+inline void bump(metricSlot &slot, atomic<uint64_t> &value,
+	uint64_t amount) {
+	if (&slot == &sharedSlot) {
+		value.fetch_add(amount, memory_order_relaxed);
+	} else {
+		value.store(value.load(memory_order_relaxed) + amount,
+			memory_order_relaxed);
+	}
+}
+
+//----------------------------------------------------------------------------
+// nowNs()
+// Postcondition: Returns a steady clock reading in nanoseconds
+uint64_t nowNs() {
+	return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sums of every slot, as the report shows them
+struct metricTotals {
+	uint64_t stageNs[STAGE_COUNT];
+	uint64_t stageCalls[STAGE_COUNT];
+	uint64_t stageAllocations[STAGE_COUNT];
+	uint64_t stageBytes[STAGE_COUNT];
+	uint64_t counters[COUNTER_COUNT];
+	uint64_t peaks[PEAK_COUNT];		// the largest, not the sum
+	uint64_t allocations;
+	uint64_t bytes;
+};
+
+//----------------------------------------------------------------------------
+// sumSlots()
+// Postcondition: Returns the totals over every slot
+metricTotals sumSlots() {
+	metricTotals totals = {};
+	for (unsigned index = 0; index <= METRIC_SLOTS; index++) {
+		const metricSlot &slot =
+			index < METRIC_SLOTS ? slots[index] : sharedSlot;
+		for (int stage = 0; stage < STAGE_COUNT; stage++) {
+			totals.stageNs[stage] +=
+				slot.stageNs[stage].load(memory_order_relaxed);
+			totals.stageCalls[stage] +=
+				slot.stageCalls[stage].load(memory_order_relaxed);
+			totals.stageAllocations[stage] +=
+				slot.stageAllocations[stage].load(memory_order_relaxed);
+			totals.stageBytes[stage] +=
+				slot.stageBytes[stage].load(memory_order_relaxed);
+		}
+		for (int counter = 0; counter < COUNTER_COUNT; counter++) {
+			totals.counters[counter] +=
+				slot.counters[counter].load(memory_order_relaxed);
+		}
+		for (int peak = 0; peak < PEAK_COUNT; peak++) {
+			uint64_t value = slot.peaks[peak].load(memory_order_relaxed);
+			if (value > totals.peaks[peak]) {
+				totals.peaks[peak] = value;
+			}
+		}
+		totals.allocations += slot.allocations.load(memory_order_relaxed);
+		totals.bytes += slot.bytes.load(memory_order_relaxed);
+	}
+	return totals;
+}
+
+#endif
+
+}
+
+#if PROGRAM4_METRICS
+
+//----------------------------------------------------------------------------
+// metricAdd()
+// Postcondition: amount is added to counter on this thread
+void metricAdd(metricCounter counter, uint64_t amount) {
+	metricSlot &slot = currentSlot();
+	bump(slot, slot.counters[counter], amount);
+}
+
+//----------------------------------------------------------------------------
+// metricPeakAt()
+// Postcondition: peak on this thread is raised to value if it was lower
+void metricPeakAt(metricPeak peak, uint64_t value) {
+	atomic<uint64_t> &current = currentSlot().peaks[peak];
+	uint64_t seen = current.load(memory_order_relaxed);
+	// another thread may raise the shared slot in between, so retry
+	while (seen < value && !current.compare_exchange_weak(seen, value,
+		memory_order_relaxed)) {
+	}
+}
+
+//----------------------------------------------------------------------------
+// metricAllocation()
+// Postcondition: One heap allocation of bytes is recorded on this thread.
+//				  Only an executable that replaces operator new can call
+//				  this, the library makes no calls of its own.
+void metricAllocation(size_t bytes) {
+	metricSlot &slot = currentSlot();
+	bump(slot, slot.allocations, 1);
+	bump(slot, slot.bytes, bytes);
+}
+
+//----------------------------------------------------------------------------
+// stageTimer()
+// Postcondition: Starts timing stage on this thread
+stageTimer::stageTimer(metricStage stage) : stage(stage) {
+	metricSlot &slot = currentSlot();
+	startAllocations = slot.allocations.load(memory_order_relaxed);
+	startBytes = slot.bytes.load(memory_order_relaxed);
+	startNs = nowNs();
+}
+
+//----------------------------------------------------------------------------
+// ~stageTimer()
+// Postcondition: The time since construction, and the allocations
+//				  this thread made meanwhile, are added to the stage
+stageTimer::~stageTimer() {
+	uint64_t elapsed = nowNs() - startNs;
+	metricSlot &slot = currentSlot();
+	bump(slot, slot.stageNs[stage], elapsed);
+	bump(slot, slot.stageCalls[stage], 1);
+	bump(slot, slot.stageAllocations[stage],
+		slot.allocations.load(memory_order_relaxed) - startAllocations);
+	bump(slot, slot.stageBytes[stage],
+		slot.bytes.load(memory_order_relaxed) - startBytes);
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+// resetMetrics()
+// Precondition: no other thread is recording metrics
+// Postcondition: Every stage, counter and peak is back to 0
+void resetMetrics() {
+#if PROGRAM4_METRICS
+	for (unsigned index = 0; index <= METRIC_SLOTS; index++) {
+		metricSlot &slot = index < METRIC_SLOTS ? slots[index] : sharedSlot;
+		for (int stage = 0; stage < STAGE_COUNT; stage++) {
+			slot.stageNs[stage] = 0;
+			slot.stageCalls[stage] = 0;
+			slot.stageAllocations[stage] = 0;
+			slot.stageBytes[stage] = 0;
+		}
+		for (int counter = 0; counter < COUNTER_COUNT; counter++) {
+			slot.counters[counter] = 0;
+		}
+		for (int peak = 0; peak < PEAK_COUNT; peak++) {
+			slot.peaks[peak] = 0;
+		}
+		slot.allocations = 0;
+		slot.bytes = 0;
+	}
+	slotsOverflowed = false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// writeMetricsJSON()
+// Postcondition: The totals of every stage, counter and peak are written
+//				  to out as one JSON object, with "overflowed" true if
+//				  more threads ran at once than there are slots. A build
+//				  without metrics writes only "enabled": false.
+void writeMetricsJSON(ostream &out) {
+#if PROGRAM4_METRICS
+	const metricTotals totals = sumSlots();
+	out << "{\n  \"enabled\": true,\n  \"stages\": {\n";
+	for (int stage = 0; stage < STAGE_COUNT; stage++) {
+		out << "    \"" << STAGE_NAMES[stage] << "\": { \"calls\": "
+			<< totals.stageCalls[stage] << ", \"ms\": "
+			<< totals.stageNs[stage] / 1e6 << ", \"allocations\": "
+			<< totals.stageAllocations[stage] << ", \"bytes\": "
+			<< totals.stageBytes[stage] << " }"
+			<< (stage + 1 < STAGE_COUNT ? ",\n" : "\n");
+	}
+	out << "  },\n  \"counters\": {\n";
+	for (int counter = 0; counter < COUNTER_COUNT; counter++) {
+		out << "    \"" << COUNTER_NAMES[counter] << "\": "
+			<< totals.counters[counter]
+			<< (counter + 1 < COUNTER_COUNT ? ",\n" : "\n");
+	}
+	out << "  },\n  \"peaks\": {\n";
+	for (int peak = 0; peak < PEAK_COUNT; peak++) {
+		out << "    \"" << PEAK_NAMES[peak] << "\": " << totals.peaks[peak]
+			<< (peak + 1 < PEAK_COUNT ? ",\n" : "\n");
+	}
+	out << "  },\n  \"allocations\": " << totals.allocations
+		<< ",\n  \"bytes\": " << totals.bytes << ",\n  \"overflowed\": "
+		<< (slotsOverflowed.load(memory_order_relaxed) ? "true" : "false")
+		<< "\n}\n";
+#else
+	out << "{\n  \"enabled\": false\n}\n";
+#endif
+}
@@ -0,0 +1,126 @@
+// metrics.h
+// Author: Terence Ho
+//
+// This file describes the run metrics: how long each pipeline stage took,
+// how much it allocated, and counters from the labelling loops such as
+// pixels labelled and the deepest flood fill stack. Every thread writes
+// its own slot, so recording a metric is a plain add with no lock or
+// shared cache line, and the report sums the slots. A thread gives its
+// slot back when it exits. Building with PROGRAM4_METRICS set to 0 turns
+// every call into an empty inline function, which compiles to nothing.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+using namespace std;
+
+#ifndef PROGRAM4_METRICS
+#define PROGRAM4_METRICS 1
+#endif
+
+// Pipeline stages that are timed
+enum metricStage {
+	STAGE_READ,		// decoding or mapping an input image
+	STAGE_CONVERT,	// converting pixels to another colour space, and
+					// recounting region statistics in RGB
+	STAGE_SEGMENT,	// labelling the regions
+	STAGE_PYRAMID,	// halving the image into levels and carrying labels
+					// back down to full resolution
+	STAGE_MERGE,	// joining small or similar regions
+	STAGE_RENDER,	// colouring the output image
+	STAGE_WRITE,	// encoding an output image
+	STAGE_STATS,	// saving the region table
+	STAGE_COUNT
+};
+
+// Counters added up over every thread
+enum metricCounter {
+	COUNTER_PIXELS,		// pixels labelled
+	COUNTER_SPANS,		// flood fill spans taken from the stack
+	COUNTER_REGIONS,	// regions made by labelling
+	COUNTER_MERGES,		// regions joined by the merge pass
+	COUNTER_COUNT
+};
+
+// Counters that keep the largest value seen on any thread
+enum metricPeak {
+	PEAK_STACK,		// flood fill span stack
+	PEAK_QUEUE,		// batch pipeline queue
+	PEAK_COUNT
+};
+
+#if PROGRAM4_METRICS
+
+//----------------------------------------------------------------------------
+// metricAdd()
+// Postcondition: amount is added to counter on this thread
+void metricAdd(metricCounter counter, uint64_t amount);
+
+//----------------------------------------------------------------------------
+// metricPeakAt()
+// Postcondition: peak on this thread is raised to value if it was lower
+void metricPeakAt(metricPeak peak, uint64_t value);
+
+//----------------------------------------------------------------------------
+// metricAllocation()
+// Postcondition: One heap allocation of bytes is recorded on this thread.
+//				  Only an executable that replaces operator new can call
+//				  this, the library makes no calls of its own.
+void metricAllocation(size_t bytes);
+
+class stageTimer {
+public:
+	// stageTimer()
+	// Postcondition: Starts timing stage on this thread
+	explicit stageTimer(metricStage stage);
+
+	// ~stageTimer()
+	// Postcondition: The time since construction, and the allocations
+	//				  this thread made meanwhile, are added to the stage
+	~stageTimer();
+
+	stageTimer(const stageTimer &) = delete;
+	stageTimer& operator=(const stageTimer &) = delete;
+
+private:
+	metricStage stage;
+	uint64_t startNs;
+	uint64_t startAllocations;
+	uint64_t startBytes;
+};
+
+#else
+
+inline void metricAdd(metricCounter, uint64_t) {
+}
+
+inline void metricPeakAt(metricPeak, uint64_t) {
+}
+
+inline void metricAllocation(size_t) {
+}
+
+class stageTimer {
+public:
+	explicit stageTimer(metricStage) {
+	}
+};
+
+#endif
+
+//----------------------------------------------------------------------------
+// resetMetrics()
+// Precondition: no other thread is recording metrics
+// Postcondition: Every stage, counter and peak is back to 0
+void resetMetrics();
+
+//----------------------------------------------------------------------------
+// writeMetricsJSON()
+// Postcondition: The totals of every stage, counter and peak are written
+//				  to out as one JSON object, with "overflowed" true if
+//				  more threads ran at once than there are slots. A build
+//				  without metrics writes only "enabled": false.
+void writeMetricsJSON(ostream &out);
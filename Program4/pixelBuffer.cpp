@@ -0,0 +1,130 @@
+// pixelBuffer.cpp
+// Author: Terence Ho
+//
+// Aligned allocation and the planar red/green/blue image buffer.
+//---------------------------------------------------------------------------
+#include "pixelBuffer.h"
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+//---------------------------------------------------------------------------
+// alignedAlloc()
+// Precondition: bytes is the size of the block wanted
+// Postcondition: Returns a zero filled block aligned to BUFFER_ALIGNMENT,
+//				  or nullptr if the memory is not available
+//				  The address handed out by operator new is kept just
+//				  before the aligned block so alignedFree can release it.
+void *alignedAlloc(size_t bytes) {
+	void *raw = ::operator new(bytes + BUFFER_ALIGNMENT + sizeof(void *),
+		nothrow);
+	if (raw == nullptr) {
+		return nullptr;
+	}
+	uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void *);
+	uintptr_t aligned = (start + BUFFER_ALIGNMENT - 1) &
+		~(uintptr_t)(BUFFER_ALIGNMENT - 1);
+	void *block = reinterpret_cast<void *>(aligned);
+	reinterpret_cast<void **>(block)[-1] = raw;
+	memset(block, 0, bytes);
+	return block;
+}
+
+//---------------------------------------------------------------------------
+// alignedFree()
+// Precondition: block was returned by alignedAlloc or is nullptr
+// Postcondition: Releases the block
+void alignedFree(void *block) {
+	if (block != nullptr) {
+		::operator delete(reinterpret_cast<void **>(block)[-1]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// rowStride()
+// Precondition: cols is the width of the image, elementSize the bytes
+//				 used by one element of a row
+// Postcondition: Returns the number of elements per row so that each row
+//				  starts on a BUFFER_ALIGNMENT boundary
+int rowStride(int cols, size_t elementSize) {
+	// smallest element count whose size is a multiple of the alignment
+	size_t step = BUFFER_ALIGNMENT;
+	while (step % elementSize != 0) {
+		step += BUFFER_ALIGNMENT;
+	}
+	step /= elementSize;
+	return (int)((cols + step - 1) / step * step);
+}
+
+//---------------------------------------------------------------------------
+// planarImage()
+// Creates an empty set of planes
+planarImage::planarImage() : rows(0), cols(0), stride(0), planes(nullptr) {
+}
+
+//---------------------------------------------------------------------------
+// planarImage(rows & columns)
+// Precondition: rows and columns are greater than 0
+// Postcondition: Allocates three zero filled planes of that size
+planarImage::planarImage(int rows, int columns)
+	: rows(0), cols(0), stride(0), planes(nullptr) {
+	resize(rows, columns);
+}
+
+//---------------------------------------------------------------------------
+// ~planarImage()
+// Postcondition: Deallocates the planes
+planarImage::~planarImage() {
+	alignedFree(planes);
+}
+
+//---------------------------------------------------------------------------
+// resize()
+// Precondition: rows and columns are greater than or equal to 0
+// Postcondition: Planes hold rows x columns bytes each, contents are
+//				  zero if the size changed
+void planarImage::resize(int rows, int columns) {
+	if (rows == this->rows && columns == cols) {
+		return;
+	}
+	alignedFree(planes);
+	planes = nullptr;
+	this->rows = 0;
+	cols = 0;
+	stride = 0;
+	if (rows <= 0 || columns <= 0) {
+		return;
+	}
+	int newStride = rowStride(columns, 1);
+	planes = static_cast<byte *>(
+		alignedAlloc((size_t)newStride * rows * 3));
+	if (planes != nullptr) {
+		this->rows = rows;
+		cols = columns;
+		stride = newStride;
+	}
+}
+
+//---------------------------------------------------------------------------
+// row()
+// Precondition: channel is 0 (red), 1 (green) or 2 (blue), row is valid
+// Postcondition: Returns the first byte of that row of the channel
+byte *planarImage::row(int channel, int row) {
+	return planes + ((size_t)channel * rows + row) * stride;
+}
+
+const byte *planarImage::row(int channel, int row) const {
+	return planes + ((size_t)channel * rows + row) * stride;
+}
+
+int planarImage::getRow() const {
+	return rows;
+}
+
+int planarImage::getCol() const {
+	return cols;
+}
+
+int planarImage::getStride() const {
+	return stride;
+}
@@ -0,0 +1,78 @@
+// pixelBuffer.h
+// Author: Terence Ho
+//
+// This file describes the memory layout helpers shared by the image classes.
+// Pixel data lives in one contiguous block aligned to a cache line, with
+// every row padded to a stride that keeps the next row aligned as well.
+// A planar copy with separate red, green and blue planes is available for
+// kernels that work on one channel at a time.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include <cstddef>
+
+// Alignment of every pixel buffer and of the start of every row
+const size_t BUFFER_ALIGNMENT = 64;
+
+//----------------------------------------------------------------------------
+// alignedAlloc()
+// Precondition: bytes is the size of the block wanted
+// Postcondition: Returns a zero filled block aligned to BUFFER_ALIGNMENT,
+//				  or nullptr if the memory is not available
+void *alignedAlloc(size_t bytes);
+
+//----------------------------------------------------------------------------
+// alignedFree()
+// Precondition: block was returned by alignedAlloc or is nullptr
+// Postcondition: Releases the block
+void alignedFree(void *block);
+
+//----------------------------------------------------------------------------
+// rowStride()
+// Precondition: cols is the width of the image, elementSize the bytes
+//				 used by one element of a row
+// Postcondition: Returns the number of elements per row so that each row
+//				  starts on a BUFFER_ALIGNMENT boundary
+int rowStride(int cols, size_t elementSize);
+
+class planarImage {
+public:
+	// planarImage()
+	// Creates an empty set of planes
+	planarImage();
+
+	// planarImage(rows & columns)
+	// Precondition: rows and columns are greater than 0
+	// Postcondition: Allocates three zero filled planes of that size
+	planarImage(int rows, int columns);
+
+	// ~planarImage()
+	// Postcondition: Deallocates the planes
+	~planarImage();
+
+	planarImage(const planarImage &) = delete;
+	planarImage& operator=(const planarImage &) = delete;
+
+	// resize()
+	// Precondition: rows and columns are greater than or equal to 0
+	// Postcondition: Planes hold rows x columns bytes each, contents are
+	//				  zero if the size changed
+	void resize(int rows, int columns);
+
+	// row()
+	// Precondition: channel is 0 (red), 1 (green) or 2 (blue), row is valid
+	// Postcondition: Returns the first byte of that row of the channel
+	byte *row(int channel, int row);
+	const byte *row(int channel, int row) const;
+
+	int getRow() const;
+	int getCol() const;
+	int getStride() const;
+
+private:
+	int rows;
+	int cols;
+	int stride;		// bytes from one row of a plane to the next
+	byte *planes;	// red, green and blue planes back to back
+};
@@ -0,0 +1,1107 @@
+// pixelKernels.cpp
+// Author: Terence Ho
+//
+// Scalar, SSE2 and AVX2 versions of the bulk pixel kernels and the
+// dispatch between them. Pixels are 3 bytes, so the vector versions work
+// on whole groups of 16 (SSE2) or 32 (AVX2) pixels and leave the rest to
+// the scalar version. Differences are found per byte, and a pixel
+// differs if any of its 3 bytes do. The colour distance and conversion
+// kernels shuffle the red, green and blue bytes of 32 pixels into one
+// register each before working on them, and the conversions shuffle their
+// results back into 3 byte pixels. The Lab conversion reads its curves
+// from tables, with gathers in the AVX2 version.
+//---------------------------------------------------------------------------
+#include "pixelKernels.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define PIXEL_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace std;
+
+namespace {
+
+typedef void (*negateKernel)(const pixel *, pixel *, size_t);
+typedef size_t (*countKernel)(const pixel *, const pixel *, size_t);
+typedef bool (*equalKernel)(const pixel *, const pixel *, size_t);
+typedef void (*similarKernel)(const pixel *, size_t, const pixel &, int,
+	colorMetric, uint64_t *);
+typedef void (*pairsKernel)(const pixel *, const pixel *, size_t, int,
+	uint64_t *);
+typedef void (*transformKernel)(const pixel *, pixel *, size_t,
+	const colorMatrix &);
+typedef void (*labKernel)(const pixel *, pixel *, size_t);
+typedef void (*downsampleKernel)(const pixel *, const pixel *, pixel *,
+	size_t);
+
+// linear sRGB to XYZ, every row divided by the D65 white of that row so
+// white is 1 in each
+const float XYZ_WEIGHTS[3][3] = {
+	{ 0.4124564f / 0.95047f, 0.3575761f / 0.95047f, 0.1804375f / 0.95047f },
+	{ 0.2126729f, 0.7151522f, 0.0721750f },
+	{ 0.0193339f / 1.08883f, 0.1191920f / 1.08883f, 0.9503041f / 1.08883f }
+};
+
+// steps of the cube root table from 0 to 1
+const int CUBE_STEPS = 1024;
+
+// curves of the Lab conversion, so no pixel calls pow() or cbrt()
+struct labTables {
+	float linear[256];					// sRGB byte to linear light
+	float cubeRoot[CUBE_STEPS + 2];		// Lab f() at every step, one spare
+										// so interpolating at 1 stays inside
+
+	labTables() {
+		for (int value = 0; value < 256; value++) {
+			double c = value / 255.0;
+			linear[value] = (float)(c <= 0.04045 ? c / 12.92 :
+				pow((c + 0.055) / 1.055, 2.4));
+		}
+		for (int step = 0; step < CUBE_STEPS + 2; step++) {
+			double t = (double)step / CUBE_STEPS;
+			cubeRoot[step] = (float)(t > 216.0 / 24389.0 ? cbrt(t) :
+				(24389.0 / 27.0 * t + 16.0) / 116.0);
+		}
+	}
+};
+
+const labTables &labLookup() {
+	static const labTables tables;
+	return tables;
+}
+
+//----------------------------------------------------------------------------
+// differingPixels()
+// Precondition: mask has bit i set if byte i of 16 pixels differs
+// Postcondition: Returns the number of pixels with a differing byte
+inline size_t differingPixels(uint64_t mask) {
+	// fold the 3 bits of each pixel onto its lowest bit
+	uint64_t folded = (mask | mask >> 1 | mask >> 2) & 0x249249249249ull;
+	size_t count = 0;
+	while (folded != 0) {
+		folded &= folded - 1;
+		count++;
+	}
+	return count;
+}
+
+void negateScalar(const pixel *source, pixel *target, size_t count) {
+	const byte *in = reinterpret_cast<const byte *>(source);
+	byte *out = reinterpret_cast<byte *>(target);
+	for (size_t i = 0; i < count * 3; i++) {
+		out[i] = (byte)(255 - in[i]);
+	}
+}
+
+size_t countScalar(const pixel *first, const pixel *second, size_t count) {
+	size_t differences = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (first[i].red != second[i].red || first[i].green != second[i].green ||
+			first[i].blue != second[i].blue) {
+			differences++;
+		}
+	}
+	return differences;
+}
+
+bool equalScalar(const pixel *first, const pixel *second, size_t count) {
+	const byte *a = reinterpret_cast<const byte *>(first);
+	const byte *b = reinterpret_cast<const byte *>(second);
+	for (size_t i = 0; i < count * 3; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// similarBits()
+// Precondition: source holds count pixels, count is at most 64
+// Postcondition: Returns a mask with bit i set if pixel i is within
+//				  threshold of seed by Metric
+template <colorMetric Metric>
+uint64_t similarBits(const pixel *source, size_t count, const pixel &seed,
+	int threshold) {
+	uint64_t bits = 0;
+	for (size_t i = 0; i < count; i++) {
+		bits |= (uint64_t)withinDistance(source[i], seed, threshold, Metric) << i;
+	}
+	return bits;
+}
+
+uint64_t similarBits(const pixel *source, size_t count, const pixel &seed,
+	int threshold, colorMetric metric) {
+	switch (metric) {
+	case METRIC_L2:
+		return similarBits<METRIC_L2>(source, count, seed, threshold);
+	case METRIC_MAX:
+		return similarBits<METRIC_MAX>(source, count, seed, threshold);
+	case METRIC_L1:
+	default:
+		return similarBits<METRIC_L1>(source, count, seed, threshold);
+	}
+}
+
+void similarScalar(const pixel *source, size_t count, const pixel &seed,
+	int threshold, colorMetric metric, uint64_t *mask) {
+	for (size_t first = 0; first < count; first += 64) {
+		size_t length = count - first < 64 ? count - first : 64;
+		mask[first / 64] = similarBits(source + first, length, seed, threshold,
+			metric);
+	}
+}
+
+//----------------------------------------------------------------------------
+// pairBits()
+// Precondition: first and second hold count pixels, count is at most 64
+// Postcondition: Returns a mask with bit i set if first[i] is within
+//				  threshold of second[i] by the sum of channel differences
+uint64_t pairBits(const pixel *first, const pixel *second, size_t count,
+	int threshold) {
+	uint64_t bits = 0;
+	for (size_t i = 0; i < count; i++) {
+		bits |= (uint64_t)withinDistance(first[i], second[i], threshold,
+			METRIC_L1) << i;
+	}
+	return bits;
+}
+
+void pairsScalar(const pixel *first, const pixel *second, size_t count,
+	int threshold, uint64_t *mask) {
+	for (size_t start = 0; start < count; start += 64) {
+		size_t length = count - start < 64 ? count - start : 64;
+		mask[start / 64] = pairBits(first + start, second + start, length,
+			threshold);
+	}
+}
+
+void transformScalar(const pixel *source, pixel *target, size_t count,
+	const colorMatrix &matrix) {
+	for (size_t i = 0; i < count; i++) {
+		const int channel[3] = { source[i].red, source[i].green, source[i].blue };
+		int result[3];
+		for (int c = 0; c < 3; c++) {
+			int sum = matrix.weight[c][0] * channel[0] +
+				matrix.weight[c][1] * channel[1] +
+				matrix.weight[c][2] * channel[2] + matrix.offset[c];
+			sum = sum < 0 ? 0 : sum >> COLOR_MATRIX_SHIFT;
+			result[c] = sum > 255 ? 255 : sum;
+		}
+		target[i].red = (byte)result[0];
+		target[i].green = (byte)result[1];
+		target[i].blue = (byte)result[2];
+	}
+}
+
+//----------------------------------------------------------------------------
+// toByte()
+// Postcondition: Returns value rounded to the nearest and clamped to 0-255
+inline byte toByte(float value) {
+	value += 0.5f;
+	return (byte)(value <= 0.0f ? 0 : value >= 255.0f ? 255 : (int)value);
+}
+
+//----------------------------------------------------------------------------
+// labPixel()
+// Postcondition: Returns in as L scaled to 0-255 and a and b plus 128.
+//				  f() is read from the cube root table with linear
+//				  interpolation, in the order the vector version uses.
+pixel labPixel(const pixel &in, const labTables &tables) {
+	const float channel[3] = { tables.linear[in.red],
+		tables.linear[in.green], tables.linear[in.blue] };
+	float f[3];
+	for (int k = 0; k < 3; k++) {
+		float t = XYZ_WEIGHTS[k][0] * channel[0] +
+			XYZ_WEIGHTS[k][1] * channel[1] + XYZ_WEIGHTS[k][2] * channel[2];
+		float position = t <= 0.0f ? 0.0f : t >= 1.0f ? (float)CUBE_STEPS :
+			t * CUBE_STEPS;
+		int step = (int)position;
+		float fraction = position - (float)step;
+		f[k] = tables.cubeRoot[step] + fraction *
+			(tables.cubeRoot[step + 1] - tables.cubeRoot[step]);
+	}
+	pixel out;
+	out.red = toByte((116.0f * f[1] - 16.0f) * (255.0f / 100.0f));
+	out.green = toByte(500.0f * (f[0] - f[1]) + 128.0f);
+	out.blue = toByte(200.0f * (f[1] - f[2]) + 128.0f);
+	return out;
+}
+
+// pixels of one colour side by side are converted once
+void labScalar(const pixel *source, pixel *target, size_t count) {
+	const labTables &tables = labLookup();
+	pixel last = {};
+	pixel lastLab = labPixel(last, tables);
+	for (size_t i = 0; i < count; i++) {
+		const pixel in = source[i];
+		if (in.red != last.red || in.green != last.green ||
+			in.blue != last.blue) {
+			last = in;
+			lastLab = labPixel(in, tables);
+		}
+		target[i] = lastLab;
+	}
+}
+
+void downsampleScalar(const pixel *upper, const pixel *lower, pixel *target,
+	size_t count) {
+	const byte *top = reinterpret_cast<const byte *>(upper);
+	const byte *bottom = reinterpret_cast<const byte *>(lower);
+	byte *out = reinterpret_cast<byte *>(target);
+	for (size_t i = 0; i < count * 3; i += 3) {
+		for (int c = 0; c < 3; c++) {
+			out[i + c] = (byte)((top[2 * i + c] + top[2 * i + 3 + c] +
+				bottom[2 * i + c] + bottom[2 * i + 3 + c] + 2) >> 2);
+		}
+	}
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+void negateSSE2(const pixel *source, pixel *target, size_t count) {
+	const byte *in = reinterpret_cast<const byte *>(source);
+	byte *out = reinterpret_cast<byte *>(target);
+	const size_t bytes = count * 3;
+	const __m128i ones = _mm_set1_epi8((char)0xFF);
+	size_t i = 0;
+	for (; i + 16 <= bytes; i += 16) {
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+			_mm_xor_si128(value, ones));
+	}
+	// the blocks do not end on a pixel, so the rest goes byte by byte
+	for (; i < bytes; i++) {
+		out[i] = (byte)(255 - in[i]);
+	}
+}
+
+size_t countSSE2(const pixel *first, const pixel *second, size_t count) {
+	const byte *a = reinterpret_cast<const byte *>(first);
+	const byte *b = reinterpret_cast<const byte *>(second);
+	size_t differences = 0;
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const byte *pa = a + i * 3;
+		const byte *pb = b + i * 3;
+		uint64_t mask = 0;
+		for (int part = 0; part < 3; part++) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + part * 16));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + part * 16));
+			uint32_t same = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+			mask |= (uint64_t)(~same & 0xFFFF) << (part * 16);
+		}
+		differences += differingPixels(mask);
+	}
+	return differences + countScalar(first + i, second + i, count - i);
+}
+
+bool equalSSE2(const pixel *first, const pixel *second, size_t count) {
+	const byte *a = reinterpret_cast<const byte *>(first);
+	const byte *b = reinterpret_cast<const byte *>(second);
+	const size_t bytes = count * 3;
+	size_t i = 0;
+	for (; i + 64 <= bytes; i += 64) {
+		__m128i diff = _mm_setzero_si128();
+		for (int part = 0; part < 64; part += 16) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + part));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + part));
+			diff = _mm_or_si128(diff, _mm_xor_si128(x, y));
+		}
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF) {
+			return false;
+		}
+	}
+	for (; i < bytes; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TARGET_AVX2
+inline size_t popcount64(uint64_t value) {
+#if defined(_M_X64) || defined(__x86_64__)
+	return (size_t)_mm_popcnt_u64(value);
+#else
+	return (size_t)_mm_popcnt_u32((uint32_t)value) +
+		(size_t)_mm_popcnt_u32((uint32_t)(value >> 32));
+#endif
+}
+
+TARGET_AVX2
+void negateAVX2(const pixel *source, pixel *target, size_t count) {
+	const byte *in = reinterpret_cast<const byte *>(source);
+	byte *out = reinterpret_cast<byte *>(target);
+	const size_t bytes = count * 3;
+	const __m256i ones = _mm256_set1_epi8((char)0xFF);
+	size_t i = 0;
+	for (; i + 64 <= bytes; i += 64) {
+		__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+		__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i + 32));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+			_mm256_xor_si256(low, ones));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 32),
+			_mm256_xor_si256(high, ones));
+	}
+	for (; i < bytes; i++) {
+		out[i] = (byte)(255 - in[i]);
+	}
+}
+
+TARGET_AVX2
+size_t countAVX2(const pixel *first, const pixel *second, size_t count) {
+	const byte *a = reinterpret_cast<const byte *>(first);
+	const byte *b = reinterpret_cast<const byte *>(second);
+	size_t differences = 0;
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		const byte *pa = a + i * 3;
+		const byte *pb = b + i * 3;
+		uint32_t diff[3];
+		for (int part = 0; part < 3; part++) {
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa + part * 32));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb + part * 32));
+			diff[part] = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		}
+		// 96 byte mask split into two halves of 16 whole pixels
+		uint64_t low = ((uint64_t)diff[0] | (uint64_t)diff[1] << 32) & 0xFFFFFFFFFFFFull;
+		uint64_t high = (uint64_t)(diff[1] >> 16) | (uint64_t)diff[2] << 16;
+		uint64_t foldedLow = (low | low >> 1 | low >> 2) & 0x249249249249ull;
+		uint64_t foldedHigh = (high | high >> 1 | high >> 2) & 0x249249249249ull;
+		differences += popcount64(foldedLow) + popcount64(foldedHigh);
+	}
+	return differences + countScalar(first + i, second + i, count - i);
+}
+
+TARGET_AVX2
+bool equalAVX2(const pixel *first, const pixel *second, size_t count) {
+	const byte *a = reinterpret_cast<const byte *>(first);
+	const byte *b = reinterpret_cast<const byte *>(second);
+	const size_t bytes = count * 3;
+	size_t i = 0;
+	for (; i + 128 <= bytes; i += 128) {
+		__m256i diff = _mm256_setzero_si256();
+		for (int part = 0; part < 128; part += 32) {
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + part));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + part));
+			diff = _mm256_or_si256(diff, _mm256_xor_si256(x, y));
+		}
+		if (!_mm256_testz_si256(diff, diff)) {
+			return false;
+		}
+	}
+	for (; i < bytes; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// shuffles gathering one channel of 16 pixels from each of the 3 registers
+// holding their 48 bytes, -1 leaves a byte zero
+const int8_t CHANNEL_SHUFFLE[3][3][16] = {
+	{
+		{ 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 },
+	},
+	{
+		{ 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 },
+	},
+	{
+		{ 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 },
+		{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 },
+	},
+};
+
+// shuffles placing one channel of 16 pixels into each of the 3 registers
+// of their 48 bytes, the reverse of CHANNEL_SHUFFLE
+const int8_t PIXEL_SHUFFLE[3][3][16] = {
+	{
+		{ 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+		{ -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+		{ -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 },
+	},
+	{
+		{ -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+		{ 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+		{ -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 },
+	},
+	{
+		{ -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+		{ -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+		{ 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 },
+	},
+};
+
+//----------------------------------------------------------------------------
+// loadShuffles()
+// Precondition: table is CHANNEL_SHUFFLE or PIXEL_SHUFFLE
+// Postcondition: shuffle holds table in both 128-bit lanes
+TARGET_AVX2
+inline void loadShuffles(__m256i shuffle[3][3],
+	const int8_t table[3][3][16] = CHANNEL_SHUFFLE) {
+	for (int outer = 0; outer < 3; outer++) {
+		for (int inner = 0; inner < 3; inner++) {
+			shuffle[outer][inner] = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+				reinterpret_cast<const __m128i *>(table[outer][inner])));
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// loadChannels()
+// Precondition: block holds 32 pixels, shuffle was set by loadShuffles
+// Postcondition: value[c] holds channel c of the 32 pixels, the first 16
+//				  in the low lane and the rest in the high lane
+TARGET_AVX2
+inline void loadChannels(const byte *block, const __m256i shuffle[3][3],
+	__m256i value[3]) {
+	__m256i part[3];
+	for (int k = 0; k < 3; k++) {
+		part[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + k * 16))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 48 + k * 16)), 1);
+	}
+	for (int channel = 0; channel < 3; channel++) {
+		value[channel] = _mm256_or_si256(_mm256_or_si256(
+			_mm256_shuffle_epi8(part[0], shuffle[channel][0]),
+			_mm256_shuffle_epi8(part[1], shuffle[channel][1])),
+			_mm256_shuffle_epi8(part[2], shuffle[channel][2]));
+	}
+}
+
+//----------------------------------------------------------------------------
+// storeChannels()
+// Precondition: block has room for 32 pixels, shuffle was set by
+//				 loadShuffles from PIXEL_SHUFFLE, value is laid out as
+//				 loadChannels leaves it
+// Postcondition: The 32 pixels are written to block as 3 byte pixels
+TARGET_AVX2
+inline void storeChannels(byte *block, const __m256i shuffle[3][3],
+	const __m256i value[3]) {
+	for (int k = 0; k < 3; k++) {
+		__m256i part = _mm256_or_si256(_mm256_or_si256(
+			_mm256_shuffle_epi8(value[0], shuffle[k][0]),
+			_mm256_shuffle_epi8(value[1], shuffle[k][1])),
+			_mm256_shuffle_epi8(value[2], shuffle[k][2]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(block + k * 16),
+			_mm256_castsi256_si128(part));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(block + 48 + k * 16),
+			_mm256_extracti128_si256(part, 1));
+	}
+}
+
+//----------------------------------------------------------------------------
+// similarAVX2()
+// Precondition: threshold is greater than 0
+// Postcondition: Same as similarScalar. Each step measures 32 pixels, 16
+//				  in each 128-bit lane, and yields 32 bits of the mask.
+template <colorMetric Metric>
+TARGET_AVX2
+void similarAVX2(const pixel *source, size_t count, const pixel &seed,
+	int threshold, uint64_t *mask) {
+	const byte *in = reinterpret_cast<const byte *>(source);
+	__m256i shuffle[3][3];
+	loadShuffles(shuffle);
+	const __m256i seedChannel[3] = {
+		_mm256_set1_epi8((char)seed.red),
+		_mm256_set1_epi8((char)seed.green),
+		_mm256_set1_epi8((char)seed.blue)
+	};
+	const __m256i zero = _mm256_setzero_si256();
+
+	// limits clamped to what the lane widths can hold, the largest
+	// distances are 255, 765 and just under 442 squared
+	const __m256i byteLimit = _mm256_set1_epi8(
+		(char)(threshold > 256 ? 255 : threshold - 1));
+	const __m256i sumLimit = _mm256_set1_epi16(
+		(short)(threshold > 766 ? 766 : threshold));
+	const int clamped = threshold > 443 ? 443 : threshold;
+	const __m256i squareLimit = _mm256_set1_epi32(clamped * clamped);
+
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i value[3];
+		loadChannels(in + i * 3, shuffle, value);
+		__m256i diff[3];
+		for (int channel = 0; channel < 3; channel++) {
+			diff[channel] = _mm256_or_si256(
+				_mm256_subs_epu8(value[channel], seedChannel[channel]),
+				_mm256_subs_epu8(seedChannel[channel], value[channel]));
+		}
+
+		__m256i close;
+		if (Metric == METRIC_MAX) {
+			__m256i most = _mm256_max_epu8(_mm256_max_epu8(diff[0], diff[1]), diff[2]);
+			close = _mm256_cmpeq_epi8(_mm256_min_epu8(most, byteLimit), most);
+		} else {
+			// widen to 16 bits, pixels 0-7 of each lane in low, 8-15 in high
+			__m256i low[3];
+			__m256i high[3];
+			for (int channel = 0; channel < 3; channel++) {
+				low[channel] = _mm256_unpacklo_epi8(diff[channel], zero);
+				high[channel] = _mm256_unpackhi_epi8(diff[channel], zero);
+			}
+			__m256i closeLow;
+			__m256i closeHigh;
+			if (Metric == METRIC_L1) {
+				closeLow = _mm256_cmpgt_epi16(sumLimit, _mm256_add_epi16(
+					_mm256_add_epi16(low[0], low[1]), low[2]));
+				closeHigh = _mm256_cmpgt_epi16(sumLimit, _mm256_add_epi16(
+					_mm256_add_epi16(high[0], high[1]), high[2]));
+			} else {
+				// red and green squared and added in one multiply-add,
+				// blue paired with zero, 4 pixels per lane at a time
+				__m256i *half[2] = { low, high };
+				__m256i closeHalf[2];
+				for (int h = 0; h < 2; h++) {
+					__m256i *d = half[h];
+					__m256i rgFirst = _mm256_unpacklo_epi16(d[0], d[1]);
+					__m256i rgSecond = _mm256_unpackhi_epi16(d[0], d[1]);
+					__m256i bFirst = _mm256_unpacklo_epi16(d[2], zero);
+					__m256i bSecond = _mm256_unpackhi_epi16(d[2], zero);
+					__m256i first = _mm256_add_epi32(_mm256_madd_epi16(rgFirst, rgFirst),
+						_mm256_madd_epi16(bFirst, bFirst));
+					__m256i second = _mm256_add_epi32(_mm256_madd_epi16(rgSecond, rgSecond),
+						_mm256_madd_epi16(bSecond, bSecond));
+					closeHalf[h] = _mm256_packs_epi32(
+						_mm256_cmpgt_epi32(squareLimit, first),
+						_mm256_cmpgt_epi32(squareLimit, second));
+				}
+				closeLow = closeHalf[0];
+				closeHigh = closeHalf[1];
+			}
+			close = _mm256_packs_epi16(closeLow, closeHigh);
+		}
+
+		uint64_t bits = (uint32_t)_mm256_movemask_epi8(close);
+		if ((i & 63) == 0) {
+			mask[i / 64] = bits;
+		} else {
+			mask[i / 64] |= bits << 32;
+		}
+	}
+	if (i < count) {
+		uint64_t bits = similarBits<Metric>(source + i, count - i, seed, threshold);
+		if ((i & 63) == 0) {
+			mask[i / 64] = bits;
+		} else {
+			mask[i / 64] |= bits << 32;
+		}
+	}
+}
+
+void similarAVX2(const pixel *source, size_t count, const pixel &seed,
+	int threshold, colorMetric metric, uint64_t *mask) {
+	switch (metric) {
+	case METRIC_L2:
+		similarAVX2<METRIC_L2>(source, count, seed, threshold, mask);
+		break;
+	case METRIC_MAX:
+		similarAVX2<METRIC_MAX>(source, count, seed, threshold, mask);
+		break;
+	case METRIC_L1:
+	default:
+		similarAVX2<METRIC_L1>(source, count, seed, threshold, mask);
+		break;
+	}
+}
+
+//----------------------------------------------------------------------------
+// pairsAVX2()
+// Precondition: threshold is greater than 0
+// Postcondition: Same as pairsScalar, 32 pairs a step
+TARGET_AVX2
+void pairsAVX2(const pixel *first, const pixel *second, size_t count,
+	int threshold, uint64_t *mask) {
+	const byte *a = reinterpret_cast<const byte *>(first);
+	const byte *b = reinterpret_cast<const byte *>(second);
+	__m256i shuffle[3][3];
+	loadShuffles(shuffle);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i sumLimit = _mm256_set1_epi16(
+		(short)(threshold > 766 ? 766 : threshold));
+
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i x[3];
+		__m256i y[3];
+		loadChannels(a + i * 3, shuffle, x);
+		loadChannels(b + i * 3, shuffle, y);
+		// widen to 16 bits, pixels 0-7 of each lane in low, 8-15 in high
+		__m256i sumLow = zero;
+		__m256i sumHigh = zero;
+		for (int channel = 0; channel < 3; channel++) {
+			__m256i diff = _mm256_or_si256(_mm256_subs_epu8(x[channel], y[channel]),
+				_mm256_subs_epu8(y[channel], x[channel]));
+			sumLow = _mm256_add_epi16(sumLow, _mm256_unpacklo_epi8(diff, zero));
+			sumHigh = _mm256_add_epi16(sumHigh, _mm256_unpackhi_epi8(diff, zero));
+		}
+		__m256i close = _mm256_packs_epi16(_mm256_cmpgt_epi16(sumLimit, sumLow),
+			_mm256_cmpgt_epi16(sumLimit, sumHigh));
+
+		uint64_t bits = (uint32_t)_mm256_movemask_epi8(close);
+		if ((i & 63) == 0) {
+			mask[i / 64] = bits;
+		} else {
+			mask[i / 64] |= bits << 32;
+		}
+	}
+	if (i < count) {
+		uint64_t bits = pairBits(first + i, second + i, count - i, threshold);
+		if ((i & 63) == 0) {
+			mask[i / 64] = bits;
+		} else {
+			mask[i / 64] |= bits << 32;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// transformAVX2()
+// Postcondition: Same as transformScalar, 32 pixels a step. Red and green
+//				  are weighted in one multiply-add and blue in another,
+//				  4 pixels per lane at a time, and the 32-bit sums are
+//				  packed back to bytes with the clamp done by saturation.
+TARGET_AVX2
+void transformAVX2(const pixel *source, pixel *target, size_t count,
+	const colorMatrix &matrix) {
+	const byte *in = reinterpret_cast<const byte *>(source);
+	byte *out = reinterpret_cast<byte *>(target);
+	__m256i shuffle[3][3];
+	__m256i unshuffle[3][3];
+	loadShuffles(shuffle);
+	loadShuffles(unshuffle, PIXEL_SHUFFLE);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i redGreenWeight[3];
+	__m256i blueWeight[3];
+	__m256i offset[3];
+	for (int c = 0; c < 3; c++) {
+		redGreenWeight[c] = _mm256_set1_epi32((int)(
+			(uint32_t)(uint16_t)matrix.weight[c][0] |
+			(uint32_t)(uint16_t)matrix.weight[c][1] << 16));
+		blueWeight[c] = _mm256_set1_epi32((int)(uint16_t)matrix.weight[c][2]);
+		offset[c] = _mm256_set1_epi32(matrix.offset[c]);
+	}
+
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i value[3];
+		loadChannels(in + i * 3, shuffle, value);
+		// red with green and blue with zero in 16-bit pairs, pixels 0-3,
+		// 4-7, 8-11 and 12-15 of each lane
+		__m256i pairs[4][2];
+		for (int half = 0; half < 2; half++) {
+			__m256i red = half == 0 ? _mm256_unpacklo_epi8(value[0], zero) :
+				_mm256_unpackhi_epi8(value[0], zero);
+			__m256i green = half == 0 ? _mm256_unpacklo_epi8(value[1], zero) :
+				_mm256_unpackhi_epi8(value[1], zero);
+			__m256i blue = half == 0 ? _mm256_unpacklo_epi8(value[2], zero) :
+				_mm256_unpackhi_epi8(value[2], zero);
+			pairs[half * 2][0] = _mm256_unpacklo_epi16(red, green);
+			pairs[half * 2][1] = _mm256_unpacklo_epi16(blue, zero);
+			pairs[half * 2 + 1][0] = _mm256_unpackhi_epi16(red, green);
+			pairs[half * 2 + 1][1] = _mm256_unpackhi_epi16(blue, zero);
+		}
+		__m256i result[3];
+		for (int c = 0; c < 3; c++) {
+			__m256i sum[4];
+			for (int q = 0; q < 4; q++) {
+				sum[q] = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(
+					_mm256_madd_epi16(pairs[q][0], redGreenWeight[c]),
+					_mm256_madd_epi16(pairs[q][1], blueWeight[c])), offset[c]),
+					COLOR_MATRIX_SHIFT);
+			}
+			result[c] = _mm256_packus_epi16(_mm256_packs_epi32(sum[0], sum[1]),
+				_mm256_packs_epi32(sum[2], sum[3]));
+		}
+		storeChannels(out + i * 3, unshuffle, result);
+	}
+	transformScalar(source + i, target + i, count - i, matrix);
+}
+
+//----------------------------------------------------------------------------
+// labAVX2()
+// Postcondition: Same as labScalar, 32 pixels a step in 4 groups of 8
+//				  floats. The tables are read with gathers. A step with
+//				  the same 96 bytes as the one before reuses its result.
+TARGET_AVX2
+void labAVX2(const pixel *source, pixel *target, size_t count) {
+	const labTables &tables = labLookup();
+	const byte *in = reinterpret_cast<const byte *>(source);
+	byte *out = reinterpret_cast<byte *>(target);
+	__m256i shuffle[3][3];
+	__m256i unshuffle[3][3];
+	loadShuffles(shuffle);
+	loadShuffles(unshuffle, PIXEL_SHUFFLE);
+	__m256 weight[3][3];
+	for (int k = 0; k < 3; k++) {
+		for (int c = 0; c < 3; c++) {
+			weight[k][c] = _mm256_set1_ps(XYZ_WEIGHTS[k][c]);
+		}
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 steps = _mm256_set1_ps((float)CUBE_STEPS);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 middle = _mm256_set1_ps(128.0f);
+	// packing 4 groups of 8 leaves 4 pixel dwords in lane order
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m256i last[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(),
+		_mm256_setzero_si256() };
+	__m256i result[3];
+	bool converted = false;
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i raw[3];
+		__m256i changed = _mm256_setzero_si256();
+		for (int k = 0; k < 3; k++) {
+			raw[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i * 3 + k * 32));
+			changed = _mm256_or_si256(changed, _mm256_xor_si256(raw[k], last[k]));
+			last[k] = raw[k];
+		}
+		if (converted && _mm256_testz_si256(changed, changed)) {
+			storeChannels(out + i * 3, unshuffle, result);
+			continue;
+		}
+		converted = true;
+
+		__m256i value[3];
+		loadChannels(in + i * 3, shuffle, value);
+		byte bytes[3][32];
+		for (int c = 0; c < 3; c++) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(bytes[c]), value[c]);
+		}
+		__m256i lab[3][4];
+		for (int group = 0; group < 4; group++) {
+			__m256 linear[3];
+			for (int c = 0; c < 3; c++) {
+				__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+					reinterpret_cast<const __m128i *>(bytes[c] + group * 8)));
+				linear[c] = _mm256_i32gather_ps(tables.linear, index, 4);
+			}
+			__m256 f[3];
+			for (int k = 0; k < 3; k++) {
+				__m256 t = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(weight[k][0], linear[0]),
+					_mm256_mul_ps(weight[k][1], linear[1])),
+					_mm256_mul_ps(weight[k][2], linear[2]));
+				__m256 position = _mm256_mul_ps(
+					_mm256_min_ps(_mm256_max_ps(t, zero), one), steps);
+				__m256i step = _mm256_cvttps_epi32(position);
+				__m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(step));
+				__m256 low = _mm256_i32gather_ps(tables.cubeRoot, step, 4);
+				__m256 high = _mm256_i32gather_ps(tables.cubeRoot + 1, step, 4);
+				f[k] = _mm256_add_ps(low, _mm256_mul_ps(fraction,
+					_mm256_sub_ps(high, low)));
+			}
+			__m256 lightness = _mm256_mul_ps(_mm256_sub_ps(
+				_mm256_mul_ps(_mm256_set1_ps(116.0f), f[1]), _mm256_set1_ps(16.0f)),
+				_mm256_set1_ps(255.0f / 100.0f));
+			__m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(500.0f),
+				_mm256_sub_ps(f[0], f[1])), middle);
+			__m256 b = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(200.0f),
+				_mm256_sub_ps(f[1], f[2])), middle);
+			// truncated after adding a half, negatives are clamped when
+			// packed
+			lab[0][group] = _mm256_cvttps_epi32(_mm256_add_ps(lightness, half));
+			lab[1][group] = _mm256_cvttps_epi32(_mm256_add_ps(a, half));
+			lab[2][group] = _mm256_cvttps_epi32(_mm256_add_ps(b, half));
+		}
+		for (int c = 0; c < 3; c++) {
+			result[c] = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(
+				_mm256_packs_epi32(lab[c][0], lab[c][1]),
+				_mm256_packs_epi32(lab[c][2], lab[c][3])), order);
+		}
+		storeChannels(out + i * 3, unshuffle, result);
+	}
+	labScalar(source + i, target + i, count - i);
+}
+
+//----------------------------------------------------------------------------
+// downsampleAVX2()
+// Postcondition: Same as downsampleScalar, 32 pixels a step from 64 of
+//				  each row. Neighbouring bytes of a channel are added in
+//				  pairs by one multiply-add with ones.
+TARGET_AVX2
+void downsampleAVX2(const pixel *upper, const pixel *lower, pixel *target,
+	size_t count) {
+	const byte *top = reinterpret_cast<const byte *>(upper);
+	const byte *bottom = reinterpret_cast<const byte *>(lower);
+	byte *out = reinterpret_cast<byte *>(target);
+	__m256i shuffle[3][3];
+	__m256i unshuffle[3][3];
+	loadShuffles(shuffle);
+	loadShuffles(unshuffle, PIXEL_SHUFFLE);
+	const __m256i ones = _mm256_set1_epi8(1);
+	const __m256i two = _mm256_set1_epi16(2);
+
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		// 16-bit sums of 2x2 blocks, pixels 0-15 of the step from the first
+		// 32 of each row and 16-31 from the rest, 8 per lane
+		__m256i sum[2][3];
+		for (int block = 0; block < 2; block++) {
+			__m256i a[3];
+			__m256i b[3];
+			loadChannels(top + (2 * i + block * 32) * 3, shuffle, a);
+			loadChannels(bottom + (2 * i + block * 32) * 3, shuffle, b);
+			for (int c = 0; c < 3; c++) {
+				sum[block][c] = _mm256_add_epi16(_mm256_add_epi16(
+					_mm256_maddubs_epi16(a[c], ones),
+					_mm256_maddubs_epi16(b[c], ones)), two);
+			}
+		}
+		__m256i result[3];
+		for (int c = 0; c < 3; c++) {
+			// packing leaves 8 pixel qwords in lane order
+			result[c] = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+				_mm256_srli_epi16(sum[0][c], 2), _mm256_srli_epi16(sum[1][c], 2)),
+				_MM_SHUFFLE(3, 1, 2, 0));
+		}
+		storeChannels(out + i * 3, unshuffle, result);
+	}
+	downsampleScalar(upper + 2 * i, lower + 2 * i, target + i, count - i);
+}
+
+//----------------------------------------------------------------------------
+// supportsAVX2()
+// Postcondition: Returns true if the processor and operating system
+//				  support AVX2 and POPCNT
+bool supportsAVX2() {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osSaves = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+		(_xgetbv(0) & 6) == 6;
+	bool popcnt = (info[2] & (1 << 23)) != 0;
+	__cpuidex(info, 7, 0);
+	return osSaves && popcnt && (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif
+
+// kernels in use, set by setKernelLevel
+struct kernelTable {
+	kernelLevel level;
+	negateKernel negate;
+	countKernel count;
+	equalKernel equal;
+	similarKernel similar;
+	pairsKernel pairs;
+	transformKernel transform;
+	labKernel lab;
+	downsampleKernel downsample;
+};
+
+//----------------------------------------------------------------------------
+// bestLevel()
+// Postcondition: Returns the highest level the processor supports
+kernelLevel bestLevel() {
+#ifdef PIXEL_KERNELS_X86
+	static const kernelLevel best = supportsAVX2() ? KERNEL_AVX2 : KERNEL_SSE2;
+	return best;
+#else
+	return KERNEL_SCALAR;
+#endif
+}
+
+kernelTable makeTable(kernelLevel level) {
+	if (level > bestLevel()) {
+		level = bestLevel();
+	}
+	kernelTable table = { KERNEL_SCALAR, negateScalar, countScalar, equalScalar,
+		similarScalar, pairsScalar, transformScalar, labScalar,
+		downsampleScalar };
+#ifdef PIXEL_KERNELS_X86
+	if (level == KERNEL_AVX2) {
+		table = { KERNEL_AVX2, negateAVX2, countAVX2, equalAVX2, similarAVX2,
+			pairsAVX2, transformAVX2, labAVX2, downsampleAVX2 };
+	} else if (level == KERNEL_SSE2) {
+		table = { KERNEL_SSE2, negateSSE2, countSSE2, equalSSE2, similarScalar,
+			pairsScalar, transformScalar, labScalar, downsampleScalar };
+	}
+#endif
+	return table;
+}
+
+//----------------------------------------------------------------------------
+// tableFor()
+// Postcondition: Returns the table of level, or of the best supported
+//				  level below it. The tables are made once and never
+//				  change, so any thread may read them.
+const kernelTable *tableFor(kernelLevel level) {
+	static const kernelTable tables[] = { makeTable(KERNEL_SCALAR),
+		makeTable(KERNEL_SSE2), makeTable(KERNEL_AVX2) };
+	return &tables[level];
+}
+
+//----------------------------------------------------------------------------
+// activeTable()
+// Postcondition: Returns the table every kernel call goes through, the
+//				  best level until setKernelLevel picks another
+atomic<const kernelTable *> &activeTable() {
+	static atomic<const kernelTable *> active(tableFor(KERNEL_AVX2));
+	return active;
+}
+
+const kernelTable &kernels() {
+	return *activeTable().load(memory_order_acquire);
+}
+
+}
+
+//----------------------------------------------------------------------------
+// activeKernelLevel()
+// Postcondition: Returns the instruction set the kernels currently use
+kernelLevel activeKernelLevel() {
+	return kernels().level;
+}
+
+//----------------------------------------------------------------------------
+// setKernelLevel()
+// Precondition: level is the highest instruction set wanted
+// Postcondition: Kernels use level, or the best supported level below it
+//				  if the processor does not support level.
+//				  Returns the level now in use.
+kernelLevel setKernelLevel(kernelLevel level) {
+	const kernelTable *table = tableFor(level);
+	activeTable().store(table, memory_order_release);
+	return table->level;
+}
+
+//----------------------------------------------------------------------------
+// kernelLevelName()
+// Postcondition: Returns "scalar", "sse2" or "avx2"
+const char *kernelLevelName(kernelLevel level) {
+	switch (level) {
+	case KERNEL_AVX2:
+		return "avx2";
+	case KERNEL_SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+//----------------------------------------------------------------------------
+// negatePixels()
+// Precondition: source and target hold count pixels, they may be the same
+// Postcondition: Every channel of target is 255 minus that of source
+void negatePixels(const pixel *source, pixel *target, size_t count) {
+	kernels().negate(source, target, count);
+}
+
+//----------------------------------------------------------------------------
+// countPixelDifferences()
+// Precondition: first and second hold count pixels
+// Postcondition: Returns the number of positions where the pixels differ
+//				  in at least one channel
+size_t countPixelDifferences(const pixel *first, const pixel *second,
+	size_t count) {
+	return kernels().count(first, second, count);
+}
+
+//----------------------------------------------------------------------------
+// pixelsEqual()
+// Precondition: first and second hold count pixels
+// Postcondition: Returns true if all count pixels are the same
+bool pixelsEqual(const pixel *first, const pixel *second, size_t count) {
+	return kernels().equal(first, second, count);
+}
+
+//----------------------------------------------------------------------------
+// similarPixels()
+// Precondition: source holds count pixels, mask holds maskWords(count) words
+// Postcondition: Bit i % 64 of mask[i / 64] is set if pixel i is within
+//				  threshold of seed by metric, as withinDistance decides.
+//				  Bits past count are cleared.
+void similarPixels(const pixel *source, size_t count, const pixel &seed,
+	int threshold, colorMetric metric, uint64_t *mask) {
+	if (threshold <= 0) {
+		for (size_t word = 0; word < maskWords(count); word++) {
+			mask[word] = 0;
+		}
+		return;
+	}
+	kernels().similar(source, count, seed, threshold, metric, mask);
+}
+
+//----------------------------------------------------------------------------
+// similarPairs()
+// Precondition: first and second hold count pixels, they may overlap,
+//				 mask holds maskWords(count) words
+// Postcondition: Bit i % 64 of mask[i / 64] is set if first[i] is within
+//				  threshold of second[i] by the sum of channel differences.
+//				  Bits past count are cleared.
+void similarPairs(const pixel *first, const pixel *second, size_t count,
+	int threshold, uint64_t *mask) {
+	if (threshold <= 0) {
+		for (size_t word = 0; word < maskWords(count); word++) {
+			mask[word] = 0;
+		}
+		return;
+	}
+	kernels().pairs(first, second, count, threshold, mask);
+}
+
+//----------------------------------------------------------------------------
+// transformPixels()
+// Precondition: source and target hold count pixels, they may be the same
+// Postcondition: Every pixel of target is its source pixel mapped by
+//				  matrix
+void transformPixels(const pixel *source, pixel *target, size_t count,
+	const colorMatrix &matrix) {
+	kernels().transform(source, target, count, matrix);
+}
+
+//----------------------------------------------------------------------------
+// labPixels()
+// Precondition: source and target hold count pixels, they may be the same
+// Postcondition: Every pixel of target is its source pixel in CIE Lab
+void labPixels(const pixel *source, pixel *target, size_t count) {
+	kernels().lab(source, target, count);
+}
+
+//----------------------------------------------------------------------------
+// downsamplePixels()
+// Precondition: upper and lower hold 2 * count pixels, target holds count
+// Postcondition: target[i] is the average of upper[2i], upper[2i + 1],
+//				  lower[2i] and lower[2i + 1], each channel rounded to
+//				  the nearest
+void downsamplePixels(const pixel *upper, const pixel *lower, pixel *target,
+	size_t count) {
+	kernels().downsample(upper, lower, target, count);
+}
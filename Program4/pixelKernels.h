@@ -0,0 +1,216 @@
+// pixelKernels.h
+// Author: Terence Ho
+//
+// This file describes the bulk pixel kernels used by imageClass to negate,
+// compare and count differences between rows of pixels, and by the region
+// growing code to test a span of pixels against a seed colour or against
+// another span, by the colour space conversion to run every pixel
+// through a fixed point matrix or into CIE Lab, and by the image pyramid
+// to halve rows of pixels. Each kernel has a scalar version plus SSE2 and
+// AVX2 versions on x86. The best version the processor supports is picked
+// the first time a kernel is called.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include <cstddef>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Instruction sets the kernels can run with, in increasing order
+enum kernelLevel {
+	KERNEL_SCALAR,
+	KERNEL_SSE2,
+	KERNEL_AVX2
+};
+
+// Ways of measuring how far apart two colours are
+enum colorMetric {
+	METRIC_L1,		// sum of the channel differences
+	METRIC_L2,		// straight-line distance in RGB space
+	METRIC_MAX		// largest channel difference
+};
+
+// Bits after the binary point of colorMatrix weights
+const int COLOR_MATRIX_SHIFT = 14;
+
+// Affine map from one 3 byte colour to another. Output channel c is
+// (weight[c][0] * red + weight[c][1] * green + weight[c][2] * blue +
+// offset[c]) >> COLOR_MATRIX_SHIFT, clamped to 0 to 255, so the offset
+// holds the rounding as well.
+struct colorMatrix {
+	int16_t weight[3][3];
+	int32_t offset[3];
+};
+
+//----------------------------------------------------------------------------
+// withinDistance()
+// Postcondition: Returns true if first is closer than threshold to second
+//				  when measured with metric
+inline bool withinDistance(const pixel &first, const pixel &second,
+	int threshold, colorMetric metric) {
+	int red = first.red > second.red ? first.red - second.red :
+		second.red - first.red;
+	int green = first.green > second.green ? first.green - second.green :
+		second.green - first.green;
+	int blue = first.blue > second.blue ? first.blue - second.blue :
+		second.blue - first.blue;
+	if (threshold <= 0) {
+		return false;
+	}
+	switch (metric) {
+	case METRIC_L2:
+		// compared squared, the largest distance is below 442
+		if (threshold > 442) {
+			return true;
+		}
+		return red * red + green * green + blue * blue < threshold * threshold;
+	case METRIC_MAX: {
+		int most = red > green ? red : green;
+		return (most > blue ? most : blue) < threshold;
+	}
+	case METRIC_L1:
+	default:
+		return red + green + blue < threshold;
+	}
+}
+
+//----------------------------------------------------------------------------
+// maskWords()
+// Postcondition: Returns the number of 64-bit words needed to hold one bit
+//				  for each of count pixels
+inline size_t maskWords(size_t count) {
+	return (count + 63) / 64;
+}
+
+//----------------------------------------------------------------------------
+// trailingZeros()
+// Precondition: bits is not 0
+// Postcondition: Returns the index of the lowest set bit
+inline int trailingZeros(uint64_t bits) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#elif defined(_MSC_VER)
+	// 32-bit targets only scan 32 bits at a time
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)bits)) {
+		return (int)index;
+	}
+	_BitScanForward(&index, (unsigned long)(bits >> 32));
+	return 32 + (int)index;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// leadingZeros()
+// Precondition: bits is not 0
+// Postcondition: Returns the number of clear bits above the highest set bit
+inline int leadingZeros(uint64_t bits) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return 63 - (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(bits >> 32))) {
+		return 31 - (int)index;
+	}
+	_BitScanReverse(&index, (unsigned long)bits);
+	return 63 - (int)index;
+#else
+	return __builtin_clzll(bits);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// activeKernelLevel()
+// Postcondition: Returns the instruction set the kernels currently use
+kernelLevel activeKernelLevel();
+
+//----------------------------------------------------------------------------
+// setKernelLevel()
+// Precondition: level is the highest instruction set wanted
+// Postcondition: Kernels use level, or the best supported level below it
+//				  if the processor does not support level.
+//				  Returns the level now in use. Safe while other threads
+//				  run kernels, each call uses one level throughout.
+kernelLevel setKernelLevel(kernelLevel level);
+
+//----------------------------------------------------------------------------
+// kernelLevelName()
+// Postcondition: Returns "scalar", "sse2" or "avx2"
+const char *kernelLevelName(kernelLevel level);
+
+//----------------------------------------------------------------------------
+// negatePixels()
+// Precondition: source and target hold count pixels, they may be the same
+// Postcondition: Every channel of target is 255 minus that of source
+void negatePixels(const pixel *source, pixel *target, size_t count);
+
+//----------------------------------------------------------------------------
+// countPixelDifferences()
+// Precondition: first and second hold count pixels
+// Postcondition: Returns the number of positions where the pixels differ
+//				  in at least one channel
+size_t countPixelDifferences(const pixel *first, const pixel *second,
+	size_t count);
+
+//----------------------------------------------------------------------------
+// pixelsEqual()
+// Precondition: first and second hold count pixels
+// Postcondition: Returns true if all count pixels are the same
+bool pixelsEqual(const pixel *first, const pixel *second, size_t count);
+
+//----------------------------------------------------------------------------
+// similarPixels()
+// Precondition: source holds count pixels, mask holds maskWords(count) words
+// Postcondition: Bit i % 64 of mask[i / 64] is set if pixel i is within
+//				  threshold of seed by metric, as withinDistance decides.
+//				  Bits past count are cleared. The vector version needs
+//				  byte shuffles, so the SSE2 level uses the scalar one.
+void similarPixels(const pixel *source, size_t count, const pixel &seed,
+	int threshold, colorMetric metric, uint64_t *mask);
+
+//----------------------------------------------------------------------------
+// similarPairs()
+// Precondition: first and second hold count pixels, they may overlap,
+//				 mask holds maskWords(count) words
+// Postcondition: Bit i % 64 of mask[i / 64] is set if first[i] is within
+//				  threshold of second[i] by the sum of channel differences.
+//				  Bits past count are cleared. Comparing a row with itself
+//				  one pixel on finds where the colour jumps between
+//				  neighbours.
+void similarPairs(const pixel *first, const pixel *second, size_t count,
+	int threshold, uint64_t *mask);
+
+//----------------------------------------------------------------------------
+// transformPixels()
+// Precondition: source and target hold count pixels, they may be the same
+// Postcondition: Every pixel of target is its source pixel mapped by
+//				  matrix. The vector version needs byte shuffles, so the
+//				  SSE2 level uses the scalar one.
+void transformPixels(const pixel *source, pixel *target, size_t count,
+	const colorMatrix &matrix);
+
+//----------------------------------------------------------------------------
+// labPixels()
+// Precondition: source and target hold count pixels, they may be the same
+// Postcondition: Every pixel of target is its source pixel in CIE Lab
+//				  under D65, with L scaled to 0 to 255 and a and b offset
+//				  by 128. The SSE2 level uses the scalar version.
+void labPixels(const pixel *source, pixel *target, size_t count);
+
+//----------------------------------------------------------------------------
+// downsamplePixels()
+// Precondition: upper and lower hold 2 * count pixels, target holds count
+// Postcondition: target[i] is the average of upper[2i], upper[2i + 1],
+//				  lower[2i] and lower[2i + 1], each channel rounded to
+//				  the nearest. The SSE2 level uses the scalar version.
+void downsamplePixels(const pixel *upper, const pixel *lower, pixel *target,
+	size_t count);
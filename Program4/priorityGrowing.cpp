@@ -0,0 +1,268 @@
+// priorityGrowing.cpp
+// Author: Terence Ho
+//
+// Seeded region growing. Distances are small integers, so the queue is an
+// array of buckets, one per distance, and pushing or taking the closest
+// pixel costs constant time instead of the logarithm of a heap. A pixel is
+// marked in the label map while it waits, so it is queued once however
+// many region pixels reach it, and it keeps the distance it had when it
+// was reached. When the average has since moved away from it, it is queued
+// again at its new distance instead of joining out of turn. The labels are
+// region numbers from the start, and the runs and statistics are built in
+// one pass at the end.
+//---------------------------------------------------------------------------
+#include "priorityGrowing.h"
+#include "componentLabel.h"
+#include "growPolicies.h"
+#include "metrics.h"
+#include "pixelKernels.h"
+#include "unionFind.h"
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Label of a pixel waiting in the queue, cleared before the region ends
+const uint32_t QUEUED = NO_LABEL - 1;
+
+struct queuedPixel {
+	int row;
+	int col;
+};
+
+// Number of distances a queued pixel can have
+const int DISTANCES = MAX_COLOR_DISTANCE + 1;
+
+// Boundary pixels of the region being grown, one bucket per distance, with
+// a bit per bucket that holds any so the lowest is found a word at a time
+class distanceQueue {
+public:
+	distanceQueue() : buckets(DISTANCES), used(maskWords(DISTANCES), 0) {}
+
+	bool empty() const {
+		for (uint64_t word : used) {
+			if (word != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// push()
+	// Precondition: distance is from 0 to MAX_COLOR_DISTANCE
+	void push(int distance, int row, int col) {
+		buckets[distance].push_back({ row, col });
+		used[distance / 64] |= 1ull << (distance % 64);
+	}
+
+	// pop()
+	// Precondition: the queue is not empty
+	// Postcondition: Takes a pixel of the lowest distance and returns it,
+	//				  with distance set to the one it was pushed with
+	queuedPixel pop(int &distance) {
+		size_t word = 0;
+		while (used[word] == 0) {
+			word++;
+		}
+		distance = (int)word * 64 + trailingZeros(used[word]);
+		vector<queuedPixel> &bucket = buckets[distance];
+		queuedPixel next = bucket.back();
+		bucket.pop_back();
+		if (bucket.empty()) {
+			used[word] &= used[word] - 1;
+		}
+		return next;
+	}
+
+private:
+	vector<vector<queuedPixel>> buckets;
+	vector<uint64_t> used;		// bit d is set while bucket d holds pixels
+};
+
+//----------------------------------------------------------------------------
+// metricDistance()
+// Postcondition: Returns the distance of first from second by Metric, from
+//				  0 to MAX_COLOR_DISTANCE. It is below a threshold exactly
+//				  when withinDistance says the colours are within it.
+template <colorMetric Metric>
+inline int metricDistance(const pixel &first, const pixel &second) {
+	int red = first.red > second.red ? first.red - second.red :
+		second.red - first.red;
+	int green = first.green > second.green ? first.green - second.green :
+		second.green - first.green;
+	int blue = first.blue > second.blue ? first.blue - second.blue :
+		second.blue - first.blue;
+	if (Metric == METRIC_L2) {
+		// the whole part of the root, as the squares of whole thresholds
+		// fall on whole roots
+		return (int)sqrt((double)(red * red + green * green + blue * blue));
+	}
+	if (Metric == METRIC_MAX) {
+		int most = red > green ? red : green;
+		return most > blue ? most : blue;
+	}
+	return red + green + blue;
+}
+
+//----------------------------------------------------------------------------
+// growRegion()
+// Precondition: (row, col) is unlabelled, labels covers input
+// Postcondition: The region label seeded at (row, col) has taken the
+//				  closest boundary pixel to its average until none was
+//				  within threshold. Returns the number of pixels taken.
+template <connectivity Connect, colorMetric Metric>
+uint64_t growRegion(int row, int col, uint32_t label, int threshold,
+	const imageClass &input, labelMap &labels, distanceQueue &queue) {
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	meanPolicy<Metric> mean(input.rowSpan(row)[col], threshold);
+	uint64_t taken = 0;
+
+	// queues a pixel nothing has reached yet at its distance from the
+	// average
+	auto reach = [&](uint32_t *labelRow, const pixel *in, int r, int c) {
+		if (labelRow[c] == NO_LABEL) {
+			labelRow[c] = QUEUED;
+			queue.push(metricDistance<Metric>(in[c], mean.colour), r, c);
+		}
+	};
+	// adds a pixel to the region and queues the pixels above and below it,
+	// and diagonally next to it with 8-connectivity
+	auto take = [&](uint32_t *labelRow, const pixel *in, int r, int c) {
+		labelRow[c] = label;
+		mean.add(in[c]);
+		taken++;
+		const int first = Connect == CONNECT_8 && c > 0 ? c - 1 : c;
+		const int last = Connect == CONNECT_8 && c < cols - 1 ? c + 1 : c;
+		for (int other = r - 1; other <= r + 1; other += 2) {
+			if (other < 0 || other >= rows) {
+				continue;
+			}
+			uint32_t *otherLabels = labels.rowSpan(other);
+			const pixel *otherIn = input.rowSpan(other);
+			for (int k = first; k <= last; k++) {
+				reach(otherLabels, otherIn, other, k);
+			}
+		}
+	};
+
+	labels.rowSpan(row)[col] = QUEUED;
+	queue.push(0, row, col);
+	while (!queue.empty()) {
+		int queued;
+		queuedPixel next = queue.pop(queued);
+		uint32_t *labelRow = labels.rowSpan(next.row);
+		// already taken along a row, or turned away since it was queued
+		if (labelRow[next.col] != QUEUED) {
+			continue;
+		}
+		const pixel *in = input.rowSpan(next.row);
+		int distance = metricDistance<Metric>(in[next.col], mean.colour);
+		if (distance > queued) {
+			queue.push(distance, next.row, next.col);
+			continue;
+		}
+		// too far for now, a pixel taken next to it later queues it again.
+		// The seed always joins, even with no threshold.
+		if (distance >= threshold && taken > 0) {
+			labelRow[next.col] = NO_LABEL;
+			continue;
+		}
+		take(labelRow, in, next.row, next.col);
+
+		// nothing queued is closer than this pixel was, so the pixels along
+		// the row that are at least as close would be taken next anyway.
+		// Taking them now walks the image a row at a time. The seed can be
+		// past the threshold, the pixels next to it cannot.
+		const int closest = distance < threshold ? distance : threshold - 1;
+		int right = next.col;
+		while (right < cols - 1 && (labelRow[right + 1] == NO_LABEL ||
+			labelRow[right + 1] == QUEUED) &&
+			metricDistance<Metric>(in[right + 1], mean.colour) <= closest) {
+			right++;
+			take(labelRow, in, next.row, right);
+		}
+		int left = next.col;
+		while (left > 0 && (labelRow[left - 1] == NO_LABEL ||
+			labelRow[left - 1] == QUEUED) &&
+			metricDistance<Metric>(in[left - 1], mean.colour) <= closest) {
+			left--;
+			take(labelRow, in, next.row, left);
+		}
+		if (right < cols - 1) {
+			reach(labelRow, in, next.row, right + 1);
+		}
+		if (left > 0) {
+			reach(labelRow, in, next.row, left - 1);
+		}
+	}
+	return taken;
+}
+
+//----------------------------------------------------------------------------
+// growAll()
+// Precondition: result was reset to the size of input
+// Postcondition: Every pixel is labelled with a set of sets, one set per
+//				  region grown from the first unlabelled pixel in scan order
+template <connectivity Connect, colorMetric Metric>
+void growAll(const imageClass &input, segmentationResult &result,
+	int threshold, unionFind &sets) {
+	labelMap &labels = result.getLabels();
+	distanceQueue queue;
+	uint64_t pixels = 0;
+	for (int row = 0; row < input.getRow(); row++) {
+		const uint32_t *labelRow = labels.rowSpan(row);
+		for (int col = 0; col < input.getCol(); col++) {
+			if (labelRow[col] == NO_LABEL) {
+				pixels += growRegion<Connect, Metric>(row, col, sets.makeSet(),
+					threshold, input, labels, queue);
+			}
+		}
+	}
+	metricAdd(COUNTER_PIXELS, pixels);
+}
+
+template <connectivity Connect>
+void growAll(const imageClass &input, segmentationResult &result,
+	const growOptions &growing, unionFind &sets) {
+	switch (growing.metric) {
+	case METRIC_L2:
+		growAll<Connect, METRIC_L2>(input, result, growing.threshold, sets);
+		break;
+	case METRIC_MAX:
+		growAll<Connect, METRIC_MAX>(input, result, growing.threshold, sets);
+		break;
+	case METRIC_L1:
+	default:
+		growAll<Connect, METRIC_L1>(input, result, growing.threshold, sets);
+		break;
+	}
+}
+
+}
+
+//----------------------------------------------------------------------------
+// segmentPriority()
+// Precondition: input is a valid image
+// Postcondition: result holds one region per seed, grown through the 4 or
+//				  8 neighbours growing asks for, closest pixel to the
+//				  region average first by growing's metric. Regions are
+//				  numbered in the scan order of their seeds. The similarity
+//				  rule of growing is not used.
+void segmentPriority(const imageClass &input, segmentationResult &result,
+	const growOptions &growing) {
+	stageTimer timer(STAGE_SEGMENT);
+	result.reset(input.getRow(), input.getCol());
+	// every pixel before a seed was taken by an earlier region, so each
+	// set is its own root and resolving keeps the numbering
+	unionFind sets;
+	if (growing.connect == CONNECT_8) {
+		growAll<CONNECT_8>(input, result, growing, sets);
+	} else {
+		growAll<CONNECT_4>(input, result, growing, sets);
+	}
+	resolveComponents(input, sets, result);
+	metricAdd(COUNTER_REGIONS, result.regionCount());
+}
@@ -0,0 +1,27 @@
+// priorityGrowing.h
+// Author: Terence Ho
+//
+// This file describes seeded region growing with a priority queue. Each
+// region starts from the first unlabelled pixel in scan order and keeps the
+// pixels on its boundary in a queue ordered by their distance from the
+// region's running average colour. The closest one joins first, the
+// average is updated from integer sums in constant time, and the region
+// stops when no pixel on its boundary is within the threshold.
+// Gradients that flooding from a fixed seed colour cuts into bands are
+// followed as far as the average can move with them.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "segmentation.h"
+
+//----------------------------------------------------------------------------
+// segmentPriority()
+// Precondition: input is a valid image
+// Postcondition: result holds one region per seed, grown through the 4 or
+//				  8 neighbours growing asks for, closest pixel to the
+//				  region average first by growing's metric. Regions are
+//				  numbered in the scan order of their seeds. The similarity
+//				  rule of growing is not used.
+void segmentPriority(const imageClass &input, segmentationResult &result,
+	const growOptions &growing = DEFAULT_GROW);
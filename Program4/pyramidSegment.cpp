@@ -0,0 +1,255 @@
+// pyramidSegment.cpp
+// Author: Terence Ho
+//
+// Coarse-to-fine segmentation. Every pixel of a finer level has a parent
+// pixel on the level above. A parent whose 3x3 neighbourhood holds one
+// label passes it down to its children unchanged, which is most of the
+// image. Children of a parent next to a boundary take whichever label of
+// that neighbourhood has the average colour closest to theirs, so the
+// boundary moves by at most one parent pixel a level and is settled at
+// full resolution along its length only.
+//---------------------------------------------------------------------------
+#include "pyramidSegment.h"
+#include "colorSpace.h"
+#include "componentLabel.h"
+#include "metrics.h"
+#include "pixelKernels.h"
+#include <chrono>
+
+using namespace std;
+
+namespace {
+
+// Pixels the next finer level has for every pixel of a level, and so how
+// many times longer it is expected to take to segment
+const double LEVEL_GROWTH = 4.0;
+
+//----------------------------------------------------------------------------
+// millisecondsSince()
+// Postcondition: Returns the time passed since start
+double millisecondsSince(chrono::steady_clock::time_point start) {
+	chrono::duration<double, milli> elapsed =
+		chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+}
+
+//----------------------------------------------------------------------------
+// downsampleImage()
+// Precondition: input is a valid image
+// Postcondition: half is input halved in both directions, rounded down,
+//				  every pixel the rounded average of a 2x2 block. Its
+//				  pixels are reused if it already had that size.
+void downsampleImage(const imageClass &input, imageClass &half) {
+	const int rows = input.getRow() / 2;
+	const int cols = input.getCol() / 2;
+	if (half.getRow() != rows || half.getCol() != cols) {
+		half = imageClass(rows, cols);
+	}
+	for (int row = 0; row < rows; row++) {
+		downsamplePixels(input.rowSpan(2 * row), input.rowSpan(2 * row + 1),
+			half.rowSpan(row), cols);
+	}
+}
+
+//----------------------------------------------------------------------------
+// pyramidSegmenter()
+// Creates a segmenter with no pyramid
+pyramidSegmenter::pyramidSegmenter() : input(nullptr), coarseLevels(0),
+	space(SPACE_RGB), previewAt(0) {
+}
+
+//----------------------------------------------------------------------------
+// preview()
+// Precondition: input is a valid image that outlives the segmenter
+//				 or the next preview
+// Postcondition: The pyramid of input is built and returns the regions
+//				  of the finest level segmented within options.budgetMs,
+//				  the level is previewLevel()
+const segmentationResult &pyramidSegmenter::preview(const imageClass &source,
+	const pyramidOptions &options) {
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	input = &source;
+	space = options.space;
+	{
+		// halve while both sides stay at least PYRAMID_MIN_SIDE
+		stageTimer timer(STAGE_PYRAMID);
+		coarseLevels = 0;
+		int rows = source.getRow();
+		int cols = source.getCol();
+		while (rows / 2 >= PYRAMID_MIN_SIDE && cols / 2 >= PYRAMID_MIN_SIDE) {
+			if ((int)levels.size() == coarseLevels) {
+				levels.emplace_back();
+			}
+			downsampleImage(level(coarseLevels), levels[coarseLevels]);
+			coarseLevels++;
+			rows /= 2;
+			cols /= 2;
+		}
+	}
+
+	// coarsest level first, then a level finer while it should still fit
+	int at = coarseLevels;
+	chrono::steady_clock::time_point levelStart = chrono::steady_clock::now();
+	segmentImage(compared(at), coarse, options.mode, options.threads,
+		options.growing);
+	double levelMs = millisecondsSince(levelStart);
+	while (at > 1 && millisecondsSince(start) + LEVEL_GROWTH * levelMs <=
+		options.budgetMs) {
+		at--;
+		levelStart = chrono::steady_clock::now();
+		segmentImage(compared(at), coarse, options.mode, options.threads,
+			options.growing);
+		levelMs = millisecondsSince(levelStart);
+	}
+	previewAt = at;
+
+	// refining compares with the averages in the space segmented in,
+	// the preview itself is given RGB statistics
+	averages.resize(coarse.regionCount());
+	for (int label = 0; label < coarse.regionCount(); label++) {
+		averages[label] = coarse.getRegions().averageColor(label);
+	}
+	if (space != SPACE_RGB) {
+		recolorRegions(level(at), coarse);
+	}
+	return coarse;
+}
+
+//----------------------------------------------------------------------------
+// previewLevel()
+// Postcondition: Returns the level of the last preview, each level
+//				  halves the one before and 0 is the input
+int pyramidSegmenter::previewLevel() const {
+	return previewAt;
+}
+
+//----------------------------------------------------------------------------
+// levelCount()
+// Postcondition: Returns the number of levels, the input included
+int pyramidSegmenter::levelCount() const {
+	return input == nullptr ? 0 : coarseLevels + 1;
+}
+
+//----------------------------------------------------------------------------
+// level()
+// Precondition: index is less than levelCount()
+// Postcondition: Returns the image of that level
+const imageClass &pyramidSegmenter::level(int index) const {
+	return index == 0 ? *input : levels[index - 1];
+}
+
+//----------------------------------------------------------------------------
+// compared()
+// Precondition: index is less than levelCount()
+// Postcondition: Returns the level in the space of the last preview,
+//				  converting it if that is not RGB
+const imageClass &pyramidSegmenter::compared(int index) {
+	if (space == SPACE_RGB) {
+		return level(index);
+	}
+	if ((int)converted.size() <= index) {
+		converted.resize(index + 1);
+	}
+	convertImage(level(index), converted[index], space);
+	return converted[index];
+}
+
+//----------------------------------------------------------------------------
+// refine()
+// Precondition: preview() has been called
+// Postcondition: result holds the regions of the preview at full
+//				  resolution, numbered in scan order
+void pyramidSegmenter::refine(segmentationResult &result) {
+	if (previewAt == 0) {
+		result = coarse;
+		return;
+	}
+	stageTimer timer(STAGE_PYRAMID);
+	if ((int)labels.size() < previewAt) {
+		labels.resize(previewAt);
+	}
+	const labelMap *from = &coarse.getLabels();
+	for (int index = previewAt - 1; index > 0; index--) {
+		labels[index].reset(level(index).getRow(), level(index).getCol());
+		refineLevel(index, *from, labels[index]);
+		from = &labels[index];
+	}
+	result.reset(input->getRow(), input->getCol());
+	refineLevel(0, *from, result.getLabels());
+
+	// the preview labels are the sets, resolving numbers the regions in
+	// scan order and adds their runs and statistics
+	sets.clear();
+	sets.reserve(averages.size());
+	for (size_t label = 0; label < averages.size(); label++) {
+		sets.makeSet();
+	}
+	resolveComponents(*input, sets, result);
+	metricAdd(COUNTER_REGIONS, result.regionCount());
+}
+
+//----------------------------------------------------------------------------
+// refineLevel()
+// Precondition: index is below the preview level, from is labelled
+//				 with preview labels at level index + 1
+// Postcondition: to is labelled with preview labels at level index
+void pyramidSegmenter::refineLevel(int index, const labelMap &from,
+	labelMap &to) {
+	const imageClass &fine = compared(index);
+	const int rows = fine.getRow();
+	const int cols = fine.getCol();
+	const int parentRows = from.getRow();
+	const int parentCols = from.getCol();
+	boundary.resize(parentCols);
+	int boundaryRow = -1;
+
+	for (int row = 0; row < rows; row++) {
+		// a row or column left over when halving belongs to the last parent
+		const int parent = row / 2 < parentRows ? row / 2 : parentRows - 1;
+		const uint32_t *above = from.rowSpan(parent > 0 ? parent - 1 : parent);
+		const uint32_t *middle = from.rowSpan(parent);
+		const uint32_t *below = from.rowSpan(parent + 1 < parentRows ?
+			parent + 1 : parent);
+		if (parent != boundaryRow) {
+			for (int col = 0; col < parentCols; col++) {
+				const uint32_t label = middle[col];
+				const int left = col > 0 ? col - 1 : col;
+				const int right = col + 1 < parentCols ? col + 1 : col;
+				bool mixed = false;
+				for (int k = left; k <= right; k++) {
+					mixed |= (above[k] != label) | (middle[k] != label) |
+						(below[k] != label);
+				}
+				boundary[col] = mixed;
+			}
+			boundaryRow = parent;
+		}
+
+		const pixel *in = fine.rowSpan(row);
+		uint32_t *out = to.rowSpan(row);
+		for (int col = 0; col < cols; col++) {
+			const int parentCol = col / 2 < parentCols ? col / 2 : parentCols - 1;
+			uint32_t label = middle[parentCol];
+			if (boundary[parentCol]) {
+				// the parent's label wins a tie
+				int closest = colorDistance(in[col], averages[label]);
+				const int left = parentCol > 0 ? parentCol - 1 : parentCol;
+				const int right = parentCol + 1 < parentCols ? parentCol + 1 :
+					parentCol;
+				const uint32_t *neighbours[3] = { above, middle, below };
+				for (const uint32_t *line : neighbours) {
+					for (int k = left; k <= right; k++) {
+						int distance = colorDistance(in[col], averages[line[k]]);
+						if (distance < closest) {
+							closest = distance;
+							label = line[k];
+						}
+					}
+				}
+			}
+			out[col] = label;
+		}
+	}
+}
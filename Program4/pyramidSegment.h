@@ -0,0 +1,120 @@
+// pyramidSegment.h
+// Author: Terence Ho
+//
+// This file describes coarse-to-fine segmentation over an image pyramid.
+// Each level of the pyramid is the one above it halved with a 2x2 box
+// average. The coarsest level is segmented first, and finer levels are
+// segmented in turn for as long as the next one is expected to fit the
+// preview budget, so a rough label map is ready quickly whatever the
+// image size. The full resolution result then follows from the preview
+// without segmenting again: labels are carried down a level at a time,
+// and only pixels whose coarse parent lies on a region boundary are
+// decided afresh, by the region average closest to their colour. Pixels
+// are compared in the colour space of the options, each level converted
+// once just before it is used, and the statistics stay RGB. The
+// levels, label maps and region averages are kept between calls, so a
+// segmenter reused for images of one size allocates nothing.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "labelMap.h"
+#include "segmentation.h"
+#include "unionFind.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Smallest side a coarse level is allowed to have
+const int PYRAMID_MIN_SIDE = 32;
+
+// How pyramidSegmenter makes the preview
+struct pyramidOptions {
+	segmentMode mode;		// mode run on the preview level
+	int threads;			// workers for SEGMENT_TILES, 0 for one per core
+	growOptions growing;	// used by SEGMENT_SEEDED and SEGMENT_PRIORITY
+	double budgetMs;		// time the preview may take, the coarsest level
+							// is segmented however long it takes
+	colorSpace space;		// colours the pixels are compared in, the
+							// statistics stay RGB
+};
+
+// Seed flooding in RGB, with a budget fit for an interactive preview
+const pyramidOptions DEFAULT_PYRAMID = { SEGMENT_SEEDED, 0, DEFAULT_GROW, 20.0,
+	SPACE_RGB };
+
+//----------------------------------------------------------------------------
+// downsampleImage()
+// Precondition: input is a valid image
+// Postcondition: half is input halved in both directions, rounded down,
+//				  every pixel the rounded average of a 2x2 block. Its
+//				  pixels are reused if it already had that size.
+void downsampleImage(const imageClass &input, imageClass &half);
+
+class pyramidSegmenter {
+public:
+	// pyramidSegmenter()
+	// Creates a segmenter with no pyramid
+	pyramidSegmenter();
+
+	// preview()
+	// Precondition: input is a valid image that outlives the segmenter
+	//				 or the next preview
+	// Postcondition: The pyramid of input is built and returns the regions
+	//				  of the finest level segmented within options.budgetMs,
+	//				  the level is previewLevel(). The level is full
+	//				  resolution only when input is too small to halve.
+	const segmentationResult &preview(const imageClass &input,
+		const pyramidOptions &options = DEFAULT_PYRAMID);
+
+	// previewLevel()
+	// Postcondition: Returns the level of the last preview, each level
+	//				  halves the one before and 0 is the input
+	int previewLevel() const;
+
+	// levelCount()
+	// Postcondition: Returns the number of levels, the input included
+	int levelCount() const;
+
+	// level()
+	// Precondition: index is less than levelCount()
+	// Postcondition: Returns the image of that level
+	const imageClass &level(int index) const;
+
+	// refine()
+	// Precondition: preview() has been called
+	// Postcondition: result holds the regions of the preview at full
+	//				  resolution, numbered in scan order. Boundaries are
+	//				  placed a level at a time, every pixel next to a
+	//				  boundary joining the neighbouring region whose
+	//				  preview average is closest to its colour.
+	void refine(segmentationResult &result);
+
+private:
+	const imageClass *input;
+	vector<imageClass> levels;		// level 1 on, level 0 is input, may
+									// hold more than are in use
+	int coarseLevels;				// levels in use after level 0
+	colorSpace space;				// space of the last preview
+	vector<imageClass> converted;	// levels in that space, each converted
+									// when first compared
+	vector<labelMap> labels;		// labels of the levels below the preview
+	vector<pixel> averages;			// preview average colour of each label
+	vector<uint8_t> boundary;		// preview parents next to another label
+	unionFind sets;					// one set per preview label
+	segmentationResult coarse;		// regions of the preview level
+	int previewAt;
+
+	// compared()
+	// Precondition: index is less than levelCount()
+	// Postcondition: Returns the level in the space of the last preview,
+	//				  converting it if that is not RGB
+	const imageClass &compared(int index);
+
+	// refineLevel()
+	// Precondition: index is below the preview level, from is labelled
+	//				 with preview labels at level index + 1
+	// Postcondition: to is labelled with preview labels at level index
+	void refineLevel(int index, const labelMap &from, labelMap &to);
+};
@@ -0,0 +1,340 @@
+// rawImage.cpp
+// Author: Terence Ho
+//
+// Raw image cache files and the memory mapping behind them. POSIX systems
+// use a private mmap, Windows a copy-on-write file mapping view.
+//---------------------------------------------------------------------------
+#include "rawImage.h"
+#include "ImageClass.h"
+#include "gifCodec.h"
+#include "pixelBuffer.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+//----------------------------------------------------------------------------
+// makeHeader()
+// Precondition: rows and cols are greater than 0
+// Postcondition: Returns the header of a raw image of that size, with rows
+//				  padded to the stride imageClass uses
+rawImageHeader makeHeader(int rows, int cols) {
+	rawImageHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RAW_IMAGE_MAGIC, sizeof(header.magic));
+	header.version = RAW_IMAGE_VERSION;
+	header.byteOrder = RAW_IMAGE_BYTE_ORDER;
+	header.headerSize = sizeof(rawImageHeader);
+	header.rows = rows;
+	header.cols = cols;
+	header.stride = rowStride(cols, sizeof(pixel));
+	header.channels = 3;
+	memcpy(header.layout, "RGB", 4);
+	header.dataSize = (uint64_t)rows * header.stride * sizeof(pixel);
+	return header;
+}
+
+//----------------------------------------------------------------------------
+// finishFile()
+// Precondition: file was opened on tempName and every byte written
+// Postcondition: file is closed and renamed to filename if all the writes
+//				  succeeded, removed otherwise. Returns true on success.
+bool finishFile(FILE *file, bool written, const string &tempName,
+	const string &filename) {
+	if (fclose(file) != 0) {
+		written = false;
+	}
+	if (written) {
+		// rename does not replace an existing file everywhere
+		remove(filename.c_str());
+		written = rename(tempName.c_str(), filename.c_str()) == 0;
+	}
+	if (!written) {
+		remove(tempName.c_str());
+	}
+	return written;
+}
+
+//----------------------------------------------------------------------------
+// seekTo()
+// Postcondition: The next write to file lands offset bytes from its start,
+//				  returns false if the position can not be reached
+bool seekTo(FILE *file, uint64_t offset) {
+#ifdef _WIN32
+	return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// modifiedTime()
+// Postcondition: Returns true and sets when to the last change of the file
+//				  if it exists
+bool modifiedTime(const string &filename, time_t &when) {
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return false;
+	}
+	when = info.st_mtime;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// fileLength()
+// Postcondition: Returns true and sets length to the size of the file in
+//				  bytes if it exists, 64-bit on every platform
+bool fileLength(const string &filename, uint64_t &length) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(filename.c_str(), &info) != 0) {
+		return false;
+	}
+#else
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return false;
+	}
+#endif
+	length = (uint64_t)info.st_size;
+	return true;
+}
+
+}
+
+//---------------------------------------------------------------------------
+// mappedFile()
+// Creates an object with no file mapped
+mappedFile::mappedFile() : view(nullptr), length(0)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+#endif
+{
+}
+
+//---------------------------------------------------------------------------
+// ~mappedFile()
+// Postcondition: Unmaps the file if one is mapped
+mappedFile::~mappedFile() {
+	close();
+}
+
+//---------------------------------------------------------------------------
+// open()
+// Precondition: filename refers to a file that is not empty
+// Postcondition: The whole file is mapped copy-on-write, writes to
+//				  data() are private to this process.
+//				  Returns false if the file can not be mapped.
+bool mappedFile::open(const string &filename) {
+	close();
+#ifdef _WIN32
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_WRITECOPY,
+		0, 0, nullptr);
+	if (mappingHandle == nullptr) {
+		close();
+		return false;
+	}
+	view = static_cast<unsigned char *>(
+		MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0));
+	if (view == nullptr) {
+		close();
+		return false;
+	}
+	length = (size_t)fileSize.QuadPart;
+#else
+	int descriptor = ::open(filename.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+		::close(descriptor);
+		return false;
+	}
+	void *address = mmap(nullptr, (size_t)info.st_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+	// the mapping keeps the file open on its own
+	::close(descriptor);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	view = static_cast<unsigned char *>(address);
+	length = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// close()
+// Postcondition: Unmaps the file, data() returns nullptr
+void mappedFile::close() {
+#ifdef _WIN32
+	if (view != nullptr) {
+		UnmapViewOfFile(view);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (view != nullptr) {
+		munmap(view, length);
+	}
+#endif
+	view = nullptr;
+	length = 0;
+}
+
+unsigned char *mappedFile::data() {
+	return view;
+}
+
+size_t mappedFile::size() const {
+	return length;
+}
+
+//----------------------------------------------------------------------------
+// validRawHeader()
+// Postcondition: Returns true if header describes a raw image this build
+//				  can map
+bool validRawHeader(const rawImageHeader &header) {
+	return memcmp(header.magic, RAW_IMAGE_MAGIC, sizeof(header.magic)) == 0 &&
+		header.version == RAW_IMAGE_VERSION &&
+		header.byteOrder == RAW_IMAGE_BYTE_ORDER &&
+		header.headerSize >= sizeof(rawImageHeader) &&
+		header.headerSize % BUFFER_ALIGNMENT == 0 &&
+		header.channels == 3 && memcmp(header.layout, "RGB", 4) == 0 &&
+		header.rows > 0 && header.cols > 0 && header.stride >= header.cols &&
+		header.rows <= 0x7FFFFFFF && header.stride <= 0x7FFFFFFF &&
+		header.dataSize == (uint64_t)header.rows * header.stride * sizeof(pixel);
+}
+
+//----------------------------------------------------------------------------
+// readRawHeader()
+// Precondition: filename is any path
+// Postcondition: Returns true and fills header if the file starts with a
+//				  raw image header this build can map and is long enough
+//				  to hold the pixel data the header describes, so a
+//				  truncated or partly copied file is never used
+bool readRawHeader(const string &filename, rawImageHeader &header) {
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	bool read = fread(&header, sizeof(header), 1, file) == 1;
+	fclose(file);
+	uint64_t length;
+	return read && validRawHeader(header) && fileLength(filename, length) &&
+		length >= header.headerSize &&
+		length - header.headerSize >= header.dataSize;
+}
+
+//----------------------------------------------------------------------------
+// writeRawImage()
+// Precondition: image is a valid image
+// Postcondition: image is saved as a raw image file.
+//				  Returns false if the file can not be written.
+bool writeRawImage(const string &filename, const imageClass &image) {
+	if (image.getRow() <= 0 || image.getCol() <= 0) {
+		return false;
+	}
+	const string tempName = filename + ".tmp";
+	FILE *file = fopen(tempName.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	rawImageHeader header = makeHeader(image.getRow(), image.getCol());
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	vector<pixel> padded(header.stride);
+	for (int row = 0; written && row < image.getRow(); row++) {
+		memcpy(padded.data(), image.rowSpan(row),
+			image.getCol() * sizeof(pixel));
+		written = fwrite(padded.data(), sizeof(pixel), padded.size(), file) ==
+			padded.size();
+	}
+	return finishFile(file, written, tempName, filename);
+}
+
+//----------------------------------------------------------------------------
+// convertGIFToRaw()
+// Precondition: gifName refers to a GIF image
+// Postcondition: The image is decoded one row at a time into a raw image
+//				  file named rawName, without holding the whole image.
+//				  The file only appears once it is complete.
+//				  Returns false if either file can not be used.
+bool convertGIFToRaw(const string &gifName, const string &rawName) {
+	gifDecoder decoder;
+	if (!decoder.open(gifName)) {
+		return false;
+	}
+	const string tempName = rawName + ".tmp";
+	FILE *file = fopen(tempName.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+
+	rawImageHeader header = makeHeader(decoder.getRow(), decoder.getCol());
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	vector<pixel> padded(header.stride);
+	const uint64_t rowBytes = (uint64_t)header.stride * sizeof(pixel);
+	while (written && decoder.hasRows()) {
+		int row = decoder.nextRowIndex();
+		decoder.readRow(padded.data());
+		// interlaced images do not arrive in row order
+		if (decoder.isInterlaced()) {
+			written = seekTo(file, header.headerSize + row * rowBytes);
+		}
+		written = written &&
+			fwrite(padded.data(), sizeof(pixel), padded.size(), file) ==
+			padded.size();
+	}
+	return finishFile(file, written, tempName, rawName);
+}
+
+//----------------------------------------------------------------------------
+// refreshRawCache()
+// Precondition: gifName refers to a GIF image
+// Postcondition: rawName holds the image of gifName, converted again only
+//				  if it is missing, unreadable, shorter than its header
+//				  says or older than gifName.
+//				  Returns false if no usable cache could be made.
+bool refreshRawCache(const string &gifName, const string &rawName) {
+	time_t gifTime;
+	time_t rawTime;
+	rawImageHeader header;
+	if (modifiedTime(rawName, rawTime) && readRawHeader(rawName, header) &&
+		(!modifiedTime(gifName, gifTime) || gifTime <= rawTime)) {
+		return true;
+	}
+	return convertGIFToRaw(gifName, rawName);
+}
@@ -0,0 +1,120 @@
+// rawImage.h
+// Author: Terence Ho
+//
+// This file describes the uncompressed image cache. A raw image file is a
+// 64 byte header followed by the rows of the image exactly as imageClass
+// keeps them in memory: interleaved red, green and blue bytes, with every
+// row padded to the stride. imageClass maps such a file instead of
+// decoding it, so a cached image is ready as soon as the header is read
+// and its pages are loaded on first touch. The mapping is copy-on-write,
+// so changes made to the image never reach the file.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+class imageClass;
+
+// First bytes of every raw image file
+const char RAW_IMAGE_MAGIC[8] = { 'P', '4', 'R', 'A', 'W', 'I', 'M', 'G' };
+const uint32_t RAW_IMAGE_VERSION = 1;
+// Written in the byte order of the machine that made the file
+const uint32_t RAW_IMAGE_BYTE_ORDER = 0x01020304;
+
+struct rawImageHeader {
+	char magic[8];			// RAW_IMAGE_MAGIC
+	uint32_t version;		// RAW_IMAGE_VERSION
+	uint32_t byteOrder;		// RAW_IMAGE_BYTE_ORDER
+	uint32_t headerSize;	// bytes before the first row
+	uint32_t rows;
+	uint32_t cols;
+	uint32_t stride;		// pixels from the start of one row to the next
+	uint32_t channels;		// bytes per pixel, always 3
+	char layout[4];			// channel order, "RGB"
+	uint64_t dataSize;		// bytes of pixel data after the header
+	uint8_t reserved[16];
+};
+
+static_assert(sizeof(rawImageHeader) == 64,
+	"rows must start on a cache line after the header");
+
+class mappedFile {
+public:
+	// mappedFile()
+	// Creates an object with no file mapped
+	mappedFile();
+
+	// ~mappedFile()
+	// Postcondition: Unmaps the file if one is mapped
+	~mappedFile();
+
+	mappedFile(const mappedFile &) = delete;
+	mappedFile& operator=(const mappedFile &) = delete;
+
+	// open()
+	// Precondition: filename refers to a file that is not empty
+	// Postcondition: The whole file is mapped copy-on-write, writes to
+	//				  data() are private to this process.
+	//				  Returns false if the file can not be mapped.
+	bool open(const string &filename);
+
+	// close()
+	// Postcondition: Unmaps the file, data() returns nullptr
+	void close();
+
+	unsigned char *data();
+	size_t size() const;
+
+private:
+	unsigned char *view;
+	size_t length;
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#endif
+};
+
+//----------------------------------------------------------------------------
+// validRawHeader()
+// Postcondition: Returns true if header describes a raw image this build
+//				  can map
+bool validRawHeader(const rawImageHeader &header);
+
+//----------------------------------------------------------------------------
+// readRawHeader()
+// Precondition: filename is any path
+// Postcondition: Returns true and fills header if the file starts with a
+//				  raw image header this build can map and is long enough
+//				  to hold the pixel data the header describes, so a
+//				  truncated or partly copied file is never used
+bool readRawHeader(const string &filename, rawImageHeader &header);
+
+//----------------------------------------------------------------------------
+// writeRawImage()
+// Precondition: image is a valid image
+// Postcondition: image is saved as a raw image file.
+//				  Returns false if the file can not be written.
+bool writeRawImage(const string &filename, const imageClass &image);
+
+//----------------------------------------------------------------------------
+// convertGIFToRaw()
+// Precondition: gifName refers to a GIF image
+// Postcondition: The image is decoded one row at a time into a raw image
+//				  file named rawName, without holding the whole image.
+//				  The file only appears once it is complete.
+//				  Returns false if either file can not be used.
+bool convertGIFToRaw(const string &gifName, const string &rawName);
+
+//----------------------------------------------------------------------------
+// refreshRawCache()
+// Precondition: gifName refers to a GIF image
+// Postcondition: rawName holds the image of gifName, converted again only
+//				  if it is missing, unreadable, shorter than its header
+//				  says or older than gifName.
+//				  Returns false if no usable cache could be made.
+bool refreshRawCache(const string &gifName, const string &rawName);
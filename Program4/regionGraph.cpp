@@ -0,0 +1,362 @@
+// regionGraph.cpp
+// Author: Terence Ho
+//
+// Adjacency graph built with a counting sort of the boundary pixel pairs,
+// and a merge pass driven by a bucket queue of colour differences.
+//---------------------------------------------------------------------------
+#include "regionGraph.h"
+#include "componentLabel.h"
+#include "metrics.h"
+#include "unionFind.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Boundary between two labels, with the pixel edges found so far
+struct labelPair {
+	uint32_t low;
+	uint32_t high;
+	uint32_t length;
+};
+
+//----------------------------------------------------------------------------
+// addPair()
+// Precondition: a and b are different labels
+// Postcondition: The pair is recorded in pairs. A pair equal to the last
+//				  one recorded only adds to its length, which folds the long
+//				  runs of one boundary found in scan order.
+void addPair(vector<labelPair> &pairs, uint32_t a, uint32_t b) {
+	uint32_t low = a < b ? a : b;
+	uint32_t high = a < b ? b : a;
+	if (!pairs.empty() && pairs.back().low == low &&
+		pairs.back().high == high) {
+		pairs.back().length++;
+		return;
+	}
+	labelPair pair = { low, high, 1 };
+	pairs.push_back(pair);
+}
+
+// What the queue checks about a set of merged regions, kept at its root.
+// The colour sums live apart, since only a merge needs them, so more of
+// these fit in the cache.
+struct mergeStats {
+	byte mean[3];		// average colour, rounded down like averageColor
+	uint32_t count;		// pixels, saturating, only compared with minArea
+	uint32_t version;	// merge that last grew the set, 0 if none
+};
+
+// Channel sums of a set of merged regions
+struct mergeSums {
+	uint64_t count;
+	uint64_t sums[3];
+};
+
+// Edge waiting in the queue, with the versions its cost was worked out for
+struct queuedEdge {
+	uint32_t a;
+	uint32_t b;
+	uint32_t versionA;
+	uint32_t versionB;
+};
+
+//----------------------------------------------------------------------------
+// setStats()
+// Precondition: totals is not empty
+// Postcondition: stats holds the average colour and count of totals
+void setStats(mergeStats &stats, const mergeSums &totals) {
+	for (int channel = 0; channel < 3; channel++) {
+		stats.mean[channel] = (byte)(totals.sums[channel] / totals.count);
+	}
+	stats.count = totals.count > UINT32_MAX ? UINT32_MAX :
+		(uint32_t)totals.count;
+}
+
+//----------------------------------------------------------------------------
+// meanDistance()
+// Postcondition: Returns the sum of channel differences of the average
+//				  colours of a and b
+int meanDistance(const mergeStats &a, const mergeStats &b) {
+	int distance = 0;
+	for (int channel = 0; channel < 3; channel++) {
+		int difference = a.mean[channel] - b.mean[channel];
+		distance += difference < 0 ? -difference : difference;
+	}
+	return distance;
+}
+
+}
+
+//---------------------------------------------------------------------------
+// regionGraph()
+// Creates a graph with no regions
+regionGraph::regionGraph() : regions(0) {
+}
+
+//---------------------------------------------------------------------------
+// build()
+// Precondition: every label in labels is less than regions
+// Postcondition: The graph holds one node per region and one edge per
+//				  pair of 4-connected regions. The neighbour lists are
+//				  only made when neighbours is true.
+void regionGraph::build(const labelMap &labels, uint32_t regionTotal,
+	bool neighbours) {
+	regions = regionTotal;
+	const int rows = labels.getRow();
+	const int cols = labels.getCol();
+
+	// every boundary pixel edge, horizontal and vertical ones scanned
+	// separately so the pairs of one boundary come one after another
+	vector<labelPair> pairs;
+	for (int row = 0; row < rows; row++) {
+		const uint32_t *labelRow = labels.rowSpan(row);
+		for (int col = 0; col + 1 < cols; col++) {
+			if (labelRow[col] != labelRow[col + 1]) {
+				addPair(pairs, labelRow[col], labelRow[col + 1]);
+			}
+		}
+		if (row + 1 < rows) {
+			const uint32_t *labelBelow = labels.rowSpan(row + 1);
+			for (int col = 0; col < cols; col++) {
+				if (labelRow[col] != labelBelow[col]) {
+					addPair(pairs, labelRow[col], labelBelow[col]);
+				}
+			}
+		}
+	}
+
+	// counting sort by lower label, then each short bucket by higher label
+	vector<size_t> start(regions + 1, 0);
+	for (const labelPair &pair : pairs) {
+		start[pair.low + 1]++;
+	}
+	for (uint32_t label = 0; label < regions; label++) {
+		start[label + 1] += start[label];
+	}
+	vector<labelPair> sorted(pairs.size());
+	vector<size_t> next(start.begin(), start.end() - 1);
+	for (const labelPair &pair : pairs) {
+		sorted[next[pair.low]++] = pair;
+	}
+	pairs.clear();
+	pairs.shrink_to_fit();
+
+	edges.clear();
+	for (uint32_t label = 0; label < regions; label++) {
+		auto first = sorted.begin() + start[label];
+		auto last = sorted.begin() + start[label + 1];
+		// most regions have a handful of neighbours, too few for sort()
+		for (auto pair = first + (first != last); pair < last; ++pair) {
+			labelPair moving = *pair;
+			auto hole = pair;
+			for (; hole != first && (hole - 1)->high > moving.high; --hole) {
+				*hole = *(hole - 1);
+			}
+			*hole = moving;
+		}
+		for (auto pair = first; pair != last; ++pair) {
+			if (!edges.empty() && edges.back().a == label &&
+				edges.back().b == pair->high) {
+				edges.back().length += pair->length;
+			} else {
+				regionEdge edge = { label, pair->high, pair->length };
+				edges.push_back(edge);
+			}
+		}
+	}
+
+	// both directions of every edge, in label order
+	offsets.clear();
+	adjacent.clear();
+	adjacentEdge.clear();
+	if (!neighbours) {
+		return;
+	}
+	offsets.assign(regions + 1, 0);
+	for (const regionEdge &edge : edges) {
+		offsets[edge.a + 1]++;
+		offsets[edge.b + 1]++;
+	}
+	for (uint32_t label = 0; label < regions; label++) {
+		offsets[label + 1] += offsets[label];
+	}
+	adjacent.resize(2 * edges.size());
+	adjacentEdge.resize(2 * edges.size());
+	next.assign(offsets.begin(), offsets.end() - 1);
+	// edges are sorted by a then b, so lower neighbours come first and
+	// each run of neighbours is in label order
+	for (uint32_t edge = 0; edge < edges.size(); edge++) {
+		size_t slot = next[edges[edge].b]++;
+		adjacent[slot] = edges[edge].a;
+		adjacentEdge[slot] = edge;
+	}
+	for (uint32_t edge = 0; edge < edges.size(); edge++) {
+		size_t slot = next[edges[edge].a]++;
+		adjacent[slot] = edges[edge].b;
+		adjacentEdge[slot] = edge;
+	}
+}
+
+//---------------------------------------------------------------------------
+// regionCount()
+// Postcondition: Returns the number of nodes
+uint32_t regionGraph::regionCount() const {
+	return regions;
+}
+
+//---------------------------------------------------------------------------
+// edgeCount()
+// Postcondition: Returns the number of edges
+size_t regionGraph::edgeCount() const {
+	return edges.size();
+}
+
+//---------------------------------------------------------------------------
+// getEdge()
+// Precondition: edge is less than edgeCount()
+// Postcondition: Returns the regions joined by the edge
+const regionEdge &regionGraph::getEdge(size_t edge) const {
+	return edges[edge];
+}
+
+//---------------------------------------------------------------------------
+// neighbourBegin() / neighbourEnd()
+// Precondition: label is less than regionCount(), the graph was built
+//				 with its neighbour lists
+// Postcondition: Slots from neighbourBegin up to neighbourEnd list the
+//				  neighbours of label in label order
+size_t regionGraph::neighbourBegin(uint32_t label) const {
+	return offsets[label];
+}
+
+size_t regionGraph::neighbourEnd(uint32_t label) const {
+	return offsets[label + 1];
+}
+
+//---------------------------------------------------------------------------
+// neighbour() / neighbourEdge()
+// Precondition: slot lies between neighbourBegin and neighbourEnd
+// Postcondition: Return the neighbouring label and the edge to it
+uint32_t regionGraph::neighbour(size_t slot) const {
+	return adjacent[slot];
+}
+
+uint32_t regionGraph::neighbourEdge(size_t slot) const {
+	return adjacentEdge[slot];
+}
+
+//----------------------------------------------------------------------------
+// mergeRegions()
+// Precondition: input is the image result was segmented from and every
+//				 pixel of result is labelled
+// Postcondition: Neighbouring regions are joined while one of them is
+//				  smaller than options.minArea or their average colours
+//				  differ by less than options.colorThreshold, cheapest
+//				  colour difference first. The merged regions are numbered
+//				  again in scan order. Returns the number of merges.
+int mergeRegions(const imageClass &input, segmentationResult &result,
+	const mergeOptions &options) {
+	stageTimer timer(STAGE_MERGE);
+	const uint32_t regions = (uint32_t)result.regionCount();
+	if (regions < 2 || (options.minArea == 0 && options.colorThreshold <= 0)) {
+		return 0;
+	}
+	regionGraph graph;
+	graph.build(result.getLabels(), regions, false);
+
+	unionFind sets;
+	sets.reserve(regions);
+	vector<mergeStats> stats(regions);
+	vector<mergeSums> totals(regions);
+	const regionTable &table = result.getTable();
+	for (uint32_t label = 0; label < regions; label++) {
+		sets.makeSet();
+		totals[label].count = table.area(label);
+		for (int channel = 0; channel < 3; channel++) {
+			totals[label].sums[channel] = table.channelSum(label, channel);
+		}
+		setStats(stats[label], totals[label]);
+		stats[label].version = 0;
+	}
+	auto wanted = [&options](const mergeStats &a, const mergeStats &b,
+		int cost) {
+		return cost < options.colorThreshold || a.count < options.minArea ||
+			b.count < options.minArea;
+	};
+
+	// colour differences are small integers, so the priority queue is one
+	// bucket per cost, taken in increasing order. Averages change as sets
+	// grow, so an edge turned down in one pass can be wanted later, and
+	// passes repeat until one makes no merge.
+	vector<vector<queuedEdge>> buckets(MAX_COLOR_DISTANCE + 1);
+	uint32_t merges = 0;
+	uint32_t lastPass;
+	do {
+		lastPass = merges;
+		for (uint32_t edge = 0; edge < graph.edgeCount(); edge++) {
+			const regionEdge &pair = graph.getEdge(edge);
+			uint32_t a = sets.find(pair.a);
+			uint32_t b = sets.find(pair.b);
+			if (a == b) {
+				continue;
+			}
+			int cost = meanDistance(stats[a], stats[b]);
+			if (wanted(stats[a], stats[b], cost)) {
+				queuedEdge queued = { a, b, stats[a].version, stats[b].version };
+				buckets[cost].push_back(queued);
+			}
+		}
+
+		for (int cost = 0; cost <= MAX_COLOR_DISTANCE; cost++) {
+			vector<queuedEdge> &bucket = buckets[cost];
+			while (!bucket.empty()) {
+				queuedEdge queued = bucket.back();
+				bucket.pop_back();
+				uint32_t a = sets.find(queued.a);
+				uint32_t b = sets.find(queued.b);
+				if (a == b) {
+					continue;
+				}
+				// a set that grew since the edge was queued has a new
+				// average, the edge waits in a later bucket if it got more
+				// expensive
+				int current = cost;
+				if (stats[a].version != queued.versionA ||
+					stats[b].version != queued.versionB) {
+					current = meanDistance(stats[a], stats[b]);
+					if (current > cost) {
+						if (wanted(stats[a], stats[b], current)) {
+							queuedEdge later = { a, b, stats[a].version,
+								stats[b].version };
+							buckets[current].push_back(later);
+						}
+						continue;
+					}
+				}
+				if (!wanted(stats[a], stats[b], current)) {
+					continue;
+				}
+
+				uint32_t root = sets.unite(a, b);
+				uint32_t other = root == a ? b : a;
+				totals[root].count += totals[other].count;
+				for (int channel = 0; channel < 3; channel++) {
+					totals[root].sums[channel] += totals[other].sums[channel];
+				}
+				setStats(stats[root], totals[root]);
+				// versions are unique, so a stale edge is always noticed
+				stats[root].version = ++merges;
+			}
+		}
+	} while (merges != lastPass);
+
+	// one pass renumbers the merged regions and counts their runs again
+	if (merges > 0) {
+		result.getRegions().clear();
+		resolveComponents(input, sets, result);
+	}
+	metricAdd(COUNTER_MERGES, merges);
+	return (int)merges;
+}
@@ -0,0 +1,97 @@
+// regionGraph.h
+// Author: Terence Ho
+//
+// This file describes the region adjacency graph and the merge pass built
+// on it. The graph has one node per region and one edge per pair of
+// regions that touch, weighted by the number of pixel edges they share,
+// and is built from the label map in one scan. The merge pass folds
+// regions that are too small, or whose average colours are too close, into
+// a neighbour. Edges are taken cheapest first from a priority queue and
+// regions are joined in a union-find forest, so the image is only scanned
+// again once, at the end, to renumber the merged regions.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "labelMap.h"
+#include "segmentation.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Two regions that touch
+struct regionEdge {
+	uint32_t a;			// lower label
+	uint32_t b;			// higher label
+	uint32_t length;	// pixel edges shared by the two regions
+};
+
+// When the merge pass joins two neighbouring regions
+struct mergeOptions {
+	uint64_t minArea;	// regions with fewer pixels join their neighbour
+						// of nearest colour, 0 for none
+	int colorThreshold;	// neighbours whose average colours are closer than
+						// this (sum of channel differences) join, 0 for none
+};
+
+class regionGraph {
+public:
+	// regionGraph()
+	// Creates a graph with no regions
+	regionGraph();
+
+	// build()
+	// Precondition: every label in labels is less than regions
+	// Postcondition: The graph holds one node per region and one edge per
+	//				  pair of 4-connected regions. The neighbour lists are
+	//				  only made when neighbours is true.
+	void build(const labelMap &labels, uint32_t regions,
+		bool neighbours = true);
+
+	// regionCount()
+	// Postcondition: Returns the number of nodes
+	uint32_t regionCount() const;
+
+	// edgeCount()
+	// Postcondition: Returns the number of edges
+	size_t edgeCount() const;
+
+	// getEdge()
+	// Precondition: edge is less than edgeCount()
+	// Postcondition: Returns the regions joined by the edge
+	const regionEdge &getEdge(size_t edge) const;
+
+	// neighbourBegin() / neighbourEnd()
+	// Precondition: label is less than regionCount(), the graph was built
+	//				 with its neighbour lists
+	// Postcondition: Slots from neighbourBegin up to neighbourEnd list the
+	//				  neighbours of label in label order
+	size_t neighbourBegin(uint32_t label) const;
+	size_t neighbourEnd(uint32_t label) const;
+
+	// neighbour() / neighbourEdge()
+	// Precondition: slot lies between neighbourBegin and neighbourEnd
+	// Postcondition: Return the neighbouring label and the edge to it
+	uint32_t neighbour(size_t slot) const;
+	uint32_t neighbourEdge(size_t slot) const;
+
+private:
+	uint32_t regions;
+	vector<regionEdge> edges;		// sorted by a, then b
+	vector<size_t> offsets;			// first slot of each region
+	vector<uint32_t> adjacent;		// neighbour in each slot
+	vector<uint32_t> adjacentEdge;	// edge of each slot
+};
+
+//----------------------------------------------------------------------------
+// mergeRegions()
+// Precondition: input is the image result was segmented from and every
+//				 pixel of result is labelled
+// Postcondition: Neighbouring regions are joined while one of them is
+//				  smaller than options.minArea or their average colours
+//				  differ by less than options.colorThreshold, cheapest
+//				  colour difference first. The merged regions are numbered
+//				  again in scan order. Returns the number of merges.
+int mergeRegions(const imageClass &input, segmentationResult &result,
+	const mergeOptions &options);
@@ -0,0 +1,233 @@
+// regionStore.cpp
+// Author: Terence Ho
+//
+// Region accumulator with running sums and spliced run chains.
+//---------------------------------------------------------------------------
+#include "regionStore.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// averageColor()
+// Postcondition: Returns the mean colour of the region, or the seed
+//				  colour if the region is empty
+pixel regionStats::averageColor() const {
+	if (count == 0) {
+		return seed;
+	}
+	pixel average;
+	average.red = (byte)(redSum / count);
+	average.green = (byte)(greenSum / count);
+	average.blue = (byte)(blueSum / count);
+	return average;
+}
+
+//---------------------------------------------------------------------------
+// regionStore()
+// Creates a store with no regions
+regionStore::regionStore() {
+}
+
+//---------------------------------------------------------------------------
+// clear()
+// Postcondition: All regions and runs are removed, the memory already
+//				  reserved is kept for the next image
+void regionStore::clear() {
+	seeds.clear();
+	heads.clear();
+	tails.clear();
+	runRow.clear();
+	runLeft.clear();
+	runRight.clear();
+	runNext.clear();
+	table.clear();
+}
+
+//---------------------------------------------------------------------------
+// reserveRuns()
+// Precondition: runs is the expected number of runs
+// Postcondition: Runs can be added without growing the arena
+void regionStore::reserveRuns(size_t runs) {
+	runRow.reserve(runs);
+	runLeft.reserve(runs);
+	runRight.reserve(runs);
+	runNext.reserve(runs);
+}
+
+//---------------------------------------------------------------------------
+// addRegion()
+// Precondition: row and col are the seed pixel of a new region
+// Postcondition: Returns the label of a new empty region
+uint32_t regionStore::addRegion(int row, int col, const pixel &seed) {
+	regionSeed start;
+	start.row = row;
+	start.col = col;
+	start.colour = seed;
+	seeds.push_back(start);
+	heads.push_back(NO_RUN);
+	tails.push_back(NO_RUN);
+	return table.addRegion();
+}
+
+//---------------------------------------------------------------------------
+// addPixel()
+// Precondition: label is an existing region
+// Postcondition: The pixel is recorded as a run of one and added to
+//				  the running sums of the region
+void regionStore::addPixel(uint32_t label, int row, int col,
+	const pixel &newPixel) {
+	table.addPixel(label, row, col, newPixel);
+	appendRun(label, row, col, col);
+}
+
+//---------------------------------------------------------------------------
+// addRun()
+// Precondition: label is an existing region, pixels is the row span
+//				 of row and left <= right are columns of it
+// Postcondition: Pixels left to right of row are recorded as one run
+//				  and added to the running sums of the region
+void regionStore::addRun(uint32_t label, int row, int left, int right,
+	const pixel *pixels) {
+	table.addRun(label, row, left, right, pixels);
+	appendRun(label, row, left, right);
+}
+
+//---------------------------------------------------------------------------
+// joinEdges()
+// Precondition: label is an existing region
+// Postcondition: edges pixel edges between a run just added and pixels
+//				  of the same region are taken off its perimeter
+void regionStore::joinEdges(uint32_t label, uint64_t edges) {
+	table.joinEdges(label, edges);
+}
+
+//---------------------------------------------------------------------------
+// recolor()
+// Precondition: label is an existing region, rows holds the row span of
+//				 every row of an image the size of the one labelled
+// Postcondition: The seed colour and channel statistics of the region
+//				  are counted again from that image, its runs and shape
+//				  are kept
+void regionStore::recolor(uint32_t label, const pixel *const *rows) {
+	regionSeed &seed = seeds[label];
+	seed.colour = rows[seed.row][seed.col];
+	table.clearColors(label);
+	for (int32_t run = heads[label]; run != NO_RUN; run = runNext[run]) {
+		table.addColors(label, runLeft[run], runRight[run], rows[runRow[run]]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// merge()
+// Precondition: into and from are different existing regions
+// Postcondition: The runs of from are spliced onto into and its sums
+//				  are added to into, from is left empty
+void regionStore::merge(uint32_t into, uint32_t from) {
+	if (into == from || heads[from] == NO_RUN) {
+		return;
+	}
+	if (heads[into] == NO_RUN) {
+		heads[into] = heads[from];
+	} else {
+		runNext[tails[into]] = heads[from];
+	}
+	tails[into] = tails[from];
+	heads[from] = NO_RUN;
+	tails[from] = NO_RUN;
+	table.merge(into, from);
+}
+
+//---------------------------------------------------------------------------
+// regionCount()
+// Postcondition: Returns the number of regions, including merged ones
+int regionStore::regionCount() const {
+	return (int)seeds.size();
+}
+
+//---------------------------------------------------------------------------
+// size()
+// Precondition: label is an existing region
+// Postcondition: Returns the number of pixels of the region
+uint64_t regionStore::size(uint32_t label) const {
+	return table.area(label);
+}
+
+//---------------------------------------------------------------------------
+// averageColor()
+// Precondition: label is an existing region
+// Postcondition: Returns the average colour of the region
+pixel regionStore::averageColor(uint32_t label) const {
+	uint64_t count = table.area(label);
+	if (count == 0) {
+		return seeds[label].colour;
+	}
+	pixel average;
+	average.red = (byte)(table.channelSum(label, 0) / count);
+	average.green = (byte)(table.channelSum(label, 1) / count);
+	average.blue = (byte)(table.channelSum(label, 2) / count);
+	return average;
+}
+
+//---------------------------------------------------------------------------
+// getRegion()
+// Precondition: label is an existing region
+// Postcondition: Returns the seed, size and sums of the region
+regionStats regionStore::getRegion(uint32_t label) const {
+	regionStats stats;
+	stats.seedRow = seeds[label].row;
+	stats.seedCol = seeds[label].col;
+	stats.seed = seeds[label].colour;
+	stats.count = table.area(label);
+	stats.redSum = table.channelSum(label, 0);
+	stats.greenSum = table.channelSum(label, 1);
+	stats.blueSum = table.channelSum(label, 2);
+	return stats;
+}
+
+//---------------------------------------------------------------------------
+// firstRun() / nextRun()
+// Precondition: label is an existing region, run is a run index
+// Postcondition: Walk the runs of a region, NO_RUN ends the chain
+int32_t regionStore::firstRun(uint32_t label) const {
+	return heads[label];
+}
+
+int32_t regionStore::nextRun(int32_t run) const {
+	return runNext[run];
+}
+
+//---------------------------------------------------------------------------
+// getRun()
+// Precondition: run is a run index
+// Postcondition: Returns the row and columns covered by the run
+regionRun regionStore::getRun(int32_t run) const {
+	regionRun result;
+	result.row = runRow[run];
+	result.left = runLeft[run];
+	result.right = runRight[run];
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// getTable()
+// Postcondition: Returns the statistics table of every region
+const regionTable &regionStore::getTable() const {
+	return table;
+}
+
+//---------------------------------------------------------------------------
+// appendRun()
+// Postcondition: Adds a run to the end of the chain of label
+void regionStore::appendRun(uint32_t label, int row, int left, int right) {
+	int32_t run = (int32_t)runRow.size();
+	runRow.push_back(row);
+	runLeft.push_back(left);
+	runRight.push_back(right);
+	runNext.push_back(NO_RUN);
+	if (heads[label] == NO_RUN) {
+		heads[label] = run;
+	} else {
+		runNext[tails[label]] = run;
+	}
+	tails[label] = run;
+}
@@ -0,0 +1,158 @@
+// regionStore.h
+// Author: Terence Ho
+//
+// This file describes the region accumulator that replaces the pixel linked
+// list. Every region keeps running channel sums and a pixel count, so its
+// size and average colour are available in constant time. The pixels of a
+// region are recorded as horizontal runs in shared structure-of-arrays
+// vectors, and each region chains its runs through a next index, so two
+// regions are merged by splicing one chain onto the other without copying.
+// The sums live in a regionTable, which also keeps the bounding box,
+// centroid, colour variance and perimeter of every region.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include "regionTable.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Index used to end a chain of runs
+const int32_t NO_RUN = -1;
+
+struct regionStats {
+	int seedRow;		// first pixel of the region in scan order
+	int seedCol;
+	pixel seed;			// colour the region was grown from
+	uint64_t count;		// number of pixels in the region
+	uint64_t redSum;	// channel sums of every pixel in the region
+	uint64_t greenSum;
+	uint64_t blueSum;
+
+	// averageColor()
+	// Postcondition: Returns the mean colour of the region, or the seed
+	//				  colour if the region is empty
+	pixel averageColor() const;
+};
+
+struct regionRun {
+	int row;
+	int left;			// first column of the run
+	int right;			// last column of the run, inclusive
+};
+
+class regionStore {
+public:
+	// regionStore()
+	// Creates a store with no regions
+	regionStore();
+
+	// clear()
+	// Postcondition: All regions and runs are removed, the memory already
+	//				  reserved is kept for the next image
+	void clear();
+
+	// reserveRuns()
+	// Precondition: runs is the expected number of runs
+	// Postcondition: Runs can be added without growing the arena
+	void reserveRuns(size_t runs);
+
+	// addRegion()
+	// Precondition: row and col are the seed pixel of a new region
+	// Postcondition: Returns the label of a new empty region
+	uint32_t addRegion(int row, int col, const pixel &seed);
+
+	// addPixel()
+	// Precondition: label is an existing region
+	// Postcondition: The pixel is recorded as a run of one and added to
+	//				  the running sums of the region
+	void addPixel(uint32_t label, int row, int col, const pixel &newPixel);
+
+	// addRun()
+	// Precondition: label is an existing region, pixels is the row span
+	//				 of row and left <= right are columns of it
+	// Postcondition: Pixels left to right of row are recorded as one run
+	//				  and added to the running sums of the region
+	void addRun(uint32_t label, int row, int left, int right,
+		const pixel *pixels);
+
+	// joinEdges()
+	// Precondition: label is an existing region
+	// Postcondition: edges pixel edges between a run just added and pixels
+	//				  of the same region are taken off its perimeter
+	void joinEdges(uint32_t label, uint64_t edges);
+
+	// recolor()
+	// Precondition: label is an existing region, rows holds the row span of
+	//				 every row of an image the size of the one labelled
+	// Postcondition: The seed colour and channel statistics of the region
+	//				  are counted again from that image, its runs and shape
+	//				  are kept
+	void recolor(uint32_t label, const pixel *const *rows);
+
+	// merge()
+	// Precondition: into and from are different existing regions
+	// Postcondition: The runs of from are spliced onto into and its sums
+	//				  are added to into, from is left empty. Edges the two
+	//				  regions share must still be reported with joinEdges.
+	void merge(uint32_t into, uint32_t from);
+
+	// regionCount()
+	// Postcondition: Returns the number of regions, including merged ones
+	int regionCount() const;
+
+	// size()
+	// Precondition: label is an existing region
+	// Postcondition: Returns the number of pixels of the region
+	uint64_t size(uint32_t label) const;
+
+	// averageColor()
+	// Precondition: label is an existing region
+	// Postcondition: Returns the average colour of the region
+	pixel averageColor(uint32_t label) const;
+
+	// getRegion()
+	// Precondition: label is an existing region
+	// Postcondition: Returns the seed, size and sums of the region
+	regionStats getRegion(uint32_t label) const;
+
+	// firstRun() / nextRun()
+	// Precondition: label is an existing region, run is a run index
+	// Postcondition: Walk the runs of a region, NO_RUN ends the chain
+	int32_t firstRun(uint32_t label) const;
+	int32_t nextRun(int32_t run) const;
+
+	// getRun()
+	// Precondition: run is a run index
+	// Postcondition: Returns the row and columns covered by the run
+	regionRun getRun(int32_t run) const;
+
+	// getTable()
+	// Postcondition: Returns the statistics table of every region
+	const regionTable &getTable() const;
+
+private:
+	// where each region was grown from
+	struct regionSeed {
+		int row;
+		int col;
+		pixel colour;
+	};
+
+	vector<regionSeed> seeds;
+	regionTable table;
+	vector<int32_t> heads;		// first run of each region
+	vector<int32_t> tails;		// last run of each region
+
+	// run arena, one entry per run in the order added
+	vector<int32_t> runRow;
+	vector<int32_t> runLeft;
+	vector<int32_t> runRight;
+	vector<int32_t> runNext;
+
+	// appendRun()
+	// Postcondition: Adds a run to the end of the chain of label
+	void appendRun(uint32_t label, int row, int left, int right);
+};
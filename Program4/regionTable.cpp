@@ -0,0 +1,431 @@
+// regionTable.cpp
+// Author: Terence Ho
+//
+// Column store of region statistics. Means, variances and centroids are
+// derived from running sums when asked for, so adding a run only adds.
+//---------------------------------------------------------------------------
+#include "regionTable.h"
+#include "metrics.h"
+#include <climits>
+#include <cstdio>
+
+using namespace std;
+
+// Pixels whose squared channel values fit a 32 bit sum (255 * 255 each)
+const int SQUARE_BLOCK = 65536;
+
+namespace {
+
+//---------------------------------------------------------------------------
+// runTotals()
+// Precondition: pixels is a row span and left <= right are columns of it
+// Postcondition: channels and squares hold the channel sums and sums of
+//				  squares of the run
+void runTotals(int left, int right, const pixel *pixels, uint32_t channels[3],
+	uint64_t squares[3]) {
+	for (int channel = 0; channel < 3; channel++) {
+		channels[channel] = 0;
+		squares[channel] = 0;
+	}
+	// squares are summed in 32 bits over blocks short enough not to
+	// overflow, which keeps the loop vectorisable
+	for (int start = left; start <= right; start += SQUARE_BLOCK) {
+		const int end = right - start < SQUARE_BLOCK ? right : start + SQUARE_BLOCK - 1;
+		uint32_t redSquares = 0;
+		uint32_t greenSquares = 0;
+		uint32_t blueSquares = 0;
+		for (int col = start; col <= end; col++) {
+			uint32_t red = pixels[col].red;
+			uint32_t green = pixels[col].green;
+			uint32_t blue = pixels[col].blue;
+			channels[0] += red;
+			channels[1] += green;
+			channels[2] += blue;
+			redSquares += red * red;
+			greenSquares += green * green;
+			blueSquares += blue * blue;
+		}
+		squares[0] += redSquares;
+		squares[1] += greenSquares;
+		squares[2] += blueSquares;
+	}
+}
+
+}
+
+//---------------------------------------------------------------------------
+// regionTable()
+// Creates a table with no regions
+regionTable::regionTable() : used(0) {
+}
+
+//---------------------------------------------------------------------------
+// clear()
+// Postcondition: Removes every region, reserved memory is kept
+void regionTable::clear() {
+	used = 0;
+}
+
+//---------------------------------------------------------------------------
+// addRegion()
+// Postcondition: Adds an empty region and returns its label
+uint32_t regionTable::addRegion() {
+	if (used == areas.size()) {
+		grow();
+	}
+	// the other columns are set by the first run
+	areas[used] = 0;
+	return (uint32_t)used++;
+}
+
+//---------------------------------------------------------------------------
+// addRun()
+// Precondition: label is an existing region, pixels is the row span
+//				 of row and left <= right are columns of it
+// Postcondition: The run is counted in every statistic of the region,
+//				  its perimeter grows as if the run touched nothing
+void regionTable::addRun(uint32_t label, int row, int left, int right,
+	const pixel *pixels) {
+	uint32_t channels[3];
+	uint64_t squares[3];
+	runTotals(left, right, pixels, channels, squares);
+	addTotals(label, row, left, right, channels, squares);
+}
+
+//---------------------------------------------------------------------------
+// clearColors()
+// Precondition: label is an existing region
+// Postcondition: The channel sums and sums of squares of the region are
+//				  0, every other statistic is kept
+void regionTable::clearColors(uint32_t label) {
+	for (int channel = 0; channel < 3; channel++) {
+		sums[channel][label] = 0;
+		squareSums[channel][label] = 0;
+	}
+}
+
+//---------------------------------------------------------------------------
+// addColors()
+// Precondition: label is an existing region, pixels is a row span and
+//				 left <= right are columns of it
+// Postcondition: The run is added to the channel sums and sums of squares
+//				  of the region only
+void regionTable::addColors(uint32_t label, int left, int right,
+	const pixel *pixels) {
+	uint32_t channels[3];
+	uint64_t squares[3];
+	runTotals(left, right, pixels, channels, squares);
+	for (int channel = 0; channel < 3; channel++) {
+		sums[channel][label] += channels[channel];
+		squareSums[channel][label] += squares[channel];
+	}
+}
+
+//---------------------------------------------------------------------------
+// addTotals()
+// Precondition: channels and squares are the channel sums and sums of
+//				 squares of the run left to right of row
+// Postcondition: The run is counted in every statistic of the region
+void regionTable::addTotals(uint32_t label, int row, int left, int right,
+	const uint32_t channels[3], const uint64_t squares[3]) {
+	const uint64_t length = (uint64_t)(right - left + 1);
+	if (areas[label] == 0) {
+		areas[label] = length;
+		tops[label] = row;
+		bottoms[label] = row;
+		lefts[label] = left;
+		rights[label] = right;
+		rowSums[label] = (uint64_t)row * length;
+		colSums[label] = (uint64_t)(left + right) * length / 2;
+		for (int channel = 0; channel < 3; channel++) {
+			sums[channel][label] = channels[channel];
+			squareSums[channel][label] = squares[channel];
+		}
+		perimeters[label] = 2 * length + 2;
+		return;
+	}
+
+	areas[label] += length;
+	if (row < tops[label]) {
+		tops[label] = row;
+	}
+	if (row > bottoms[label]) {
+		bottoms[label] = row;
+	}
+	if (left < lefts[label]) {
+		lefts[label] = left;
+	}
+	if (right > rights[label]) {
+		rights[label] = right;
+	}
+	rowSums[label] += (uint64_t)row * length;
+	colSums[label] += (uint64_t)(left + right) * length / 2;
+	for (int channel = 0; channel < 3; channel++) {
+		sums[channel][label] += channels[channel];
+		squareSums[channel][label] += squares[channel];
+	}
+	// 4 edges per pixel, less 2 for each of the length - 1 inner joins
+	perimeters[label] += 2 * length + 2;
+}
+
+//---------------------------------------------------------------------------
+// addPixel()
+// Precondition: label is an existing region
+// Postcondition: The pixel is counted as a run of one
+void regionTable::addPixel(uint32_t label, int row, int col,
+	const pixel &newPixel) {
+	const uint32_t channels[3] = { newPixel.red, newPixel.green,
+		newPixel.blue };
+	const uint64_t squares[3] = { channels[0] * channels[0],
+		channels[1] * channels[1], channels[2] * channels[2] };
+	addTotals(label, row, col, col, channels, squares);
+}
+
+//---------------------------------------------------------------------------
+// joinEdges()
+// Precondition: label is an existing region
+// Postcondition: edges pixel edges of the region are shared with other
+//				  pixels of it, so they are taken off the perimeter
+void regionTable::joinEdges(uint32_t label, uint64_t edges) {
+	perimeters[label] -= 2 * edges;
+}
+
+//---------------------------------------------------------------------------
+// merge()
+// Precondition: into and from are different existing regions
+// Postcondition: The statistics of from are added to into and from is
+//				  left empty. Edges the two regions share must still be
+//				  reported with joinEdges.
+void regionTable::merge(uint32_t into, uint32_t from) {
+	if (into == from || areas[from] == 0) {
+		return;
+	}
+	if (areas[into] == 0) {
+		copyRegion(into, from);
+		areas[from] = 0;
+		return;
+	}
+	areas[into] += areas[from];
+	tops[into] = min(tops[into], tops[from]);
+	lefts[into] = min(lefts[into], lefts[from]);
+	bottoms[into] = max(bottoms[into], bottoms[from]);
+	rights[into] = max(rights[into], rights[from]);
+	rowSums[into] += rowSums[from];
+	colSums[into] += colSums[from];
+	for (int channel = 0; channel < 3; channel++) {
+		sums[channel][into] += sums[channel][from];
+		squareSums[channel][into] += squareSums[channel][from];
+	}
+	perimeters[into] += perimeters[from];
+	areas[from] = 0;
+}
+
+//---------------------------------------------------------------------------
+// size()
+// Postcondition: Returns the number of regions, including empty ones
+size_t regionTable::size() const {
+	return used;
+}
+
+//---------------------------------------------------------------------------
+// area()
+// Precondition: label is an existing region
+// Postcondition: Returns the number of pixels of the region
+uint64_t regionTable::area(uint32_t label) const {
+	return areas[label];
+}
+
+//---------------------------------------------------------------------------
+// box()
+// Precondition: label is an existing region that is not empty
+// Postcondition: Returns the bounding box of the region
+regionBox regionTable::box(uint32_t label) const {
+	regionBox bounds;
+	bounds.top = tops[label];
+	bounds.left = lefts[label];
+	bounds.bottom = bottoms[label];
+	bounds.right = rights[label];
+	return bounds;
+}
+
+//---------------------------------------------------------------------------
+// centroidRow() / centroidCol()
+// Precondition: label is an existing region
+// Postcondition: Returns the mean row or column of the region's
+//				  pixels, 0 if it is empty
+double regionTable::centroidRow(uint32_t label) const {
+	return areas[label] == 0 ? 0.0 : (double)rowSums[label] / areas[label];
+}
+
+double regionTable::centroidCol(uint32_t label) const {
+	return areas[label] == 0 ? 0.0 : (double)colSums[label] / areas[label];
+}
+
+//---------------------------------------------------------------------------
+// mean()
+// Precondition: label is an existing region, channel is 0 (red),
+//				 1 (green) or 2 (blue)
+// Postcondition: Returns the mean of the channel over the region
+double regionTable::mean(uint32_t label, int channel) const {
+	if (areas[label] == 0) {
+		return 0.0;
+	}
+	return (double)sums[channel][label] / areas[label];
+}
+
+//---------------------------------------------------------------------------
+// channelSum()
+// Precondition: label is an existing region, channel is 0 to 2
+// Postcondition: Returns the sum of the channel over the region
+uint64_t regionTable::channelSum(uint32_t label, int channel) const {
+	return areas[label] == 0 ? 0 : sums[channel][label];
+}
+
+//---------------------------------------------------------------------------
+// variance()
+// Precondition: label is an existing region, channel is 0 to 2
+// Postcondition: Returns the population variance of the channel
+double regionTable::variance(uint32_t label, int channel) const {
+	if (areas[label] == 0) {
+		return 0.0;
+	}
+	double average = mean(label, channel);
+	double spread = (double)squareSums[channel][label] / areas[label] -
+		average * average;
+	return spread < 0.0 ? 0.0 : spread;
+}
+
+//---------------------------------------------------------------------------
+// perimeter()
+// Precondition: label is an existing region
+// Postcondition: Returns the number of pixel edges between the region
+//				  and other regions or the image border
+uint64_t regionTable::perimeter(uint32_t label) const {
+	return areas[label] == 0 ? 0 : perimeters[label];
+}
+
+//---------------------------------------------------------------------------
+// writeCSV()
+// Postcondition: Saves one line per region that is not empty, with a
+//				  header line naming the columns. Returns false if the
+//				  file can not be written.
+bool regionTable::writeCSV(const string &filename) const {
+	stageTimer timer(STAGE_STATS);
+	FILE *file = fopen(filename.c_str(), "w");
+	if (file == nullptr) {
+		return false;
+	}
+	fprintf(file, "label,area,top,left,bottom,right,centroid_row,"
+		"centroid_col,mean_red,mean_green,mean_blue,variance_red,"
+		"variance_green,variance_blue,perimeter\n");
+	for (uint32_t label = 0; label < used; label++) {
+		if (areas[label] == 0) {
+			continue;
+		}
+		fprintf(file, "%u,%llu,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,"
+			"%.3f,%.3f,%.3f,%llu\n", label,
+			(unsigned long long)areas[label], tops[label], lefts[label],
+			bottoms[label], rights[label], centroidRow(label),
+			centroidCol(label), mean(label, 0), mean(label, 1),
+			mean(label, 2), variance(label, 0), variance(label, 1),
+			variance(label, 2), (unsigned long long)perimeters[label]);
+	}
+	return fclose(file) == 0;
+}
+
+//---------------------------------------------------------------------------
+// writeBinary()
+// Postcondition: Saves a 16 byte header (REGION_TABLE_MAGIC, version,
+//				  region count) followed by whole columns for every
+//				  region: area (uint64), top, left, bottom, right
+//				  (int32), centroid row and column, red, green and blue
+//				  mean, red, green and blue variance (double) and
+//				  perimeter (uint64), in the byte order of the machine.
+//				  Returns false if the file can not be written.
+bool regionTable::writeBinary(const string &filename) const {
+	stageTimer timer(STAGE_STATS);
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	const size_t count = used;
+	const uint32_t header[2] = { REGION_TABLE_VERSION, (uint32_t)count };
+	bool written = fwrite(REGION_TABLE_MAGIC, 1, 8, file) == 8 &&
+		fwrite(header, sizeof(header), 1, file) == 1 &&
+		fwrite(areas.data(), sizeof(uint64_t), count, file) == count;
+
+	// columns of empty regions hold stale values, so they are written as 0
+	const vector<int32_t> *boxColumns[] = { &tops, &lefts, &bottoms, &rights };
+	vector<int32_t> bounds(count);
+	for (const vector<int32_t> *column : boxColumns) {
+		for (size_t label = 0; label < count; label++) {
+			bounds[label] = areas[label] == 0 ? 0 : (*column)[label];
+		}
+		written = written &&
+			fwrite(bounds.data(), sizeof(int32_t), count, file) == count;
+	}
+	vector<double> derived(count);
+	for (int column = 0; column < 8 && written; column++) {
+		for (uint32_t label = 0; label < count; label++) {
+			if (column == 0) {
+				derived[label] = centroidRow(label);
+			} else if (column == 1) {
+				derived[label] = centroidCol(label);
+			} else if (column < 5) {
+				derived[label] = mean(label, column - 2);
+			} else {
+				derived[label] = variance(label, column - 5);
+			}
+		}
+		written = fwrite(derived.data(), sizeof(double), count, file) == count;
+	}
+	vector<uint64_t> edges(count);
+	for (uint32_t label = 0; label < count; label++) {
+		edges[label] = perimeter(label);
+	}
+	written = written &&
+		fwrite(edges.data(), sizeof(uint64_t), count, file) == count;
+
+	if (fclose(file) != 0) {
+		written = false;
+	}
+	return written;
+}
+
+//---------------------------------------------------------------------------
+// grow()
+// Postcondition: Every column has room for at least one more region
+void regionTable::grow() {
+	const size_t length = areas.size() < 64 ? 64 : areas.size() * 2;
+	areas.resize(length);
+	tops.resize(length);
+	lefts.resize(length);
+	bottoms.resize(length);
+	rights.resize(length);
+	rowSums.resize(length);
+	colSums.resize(length);
+	for (int channel = 0; channel < 3; channel++) {
+		sums[channel].resize(length);
+		squareSums[channel].resize(length);
+	}
+	perimeters.resize(length);
+}
+
+//---------------------------------------------------------------------------
+// copyRegion()
+// Precondition: from is not empty
+// Postcondition: Every statistic of into is set to those of from
+void regionTable::copyRegion(uint32_t into, uint32_t from) {
+	areas[into] = areas[from];
+	tops[into] = tops[from];
+	lefts[into] = lefts[from];
+	bottoms[into] = bottoms[from];
+	rights[into] = rights[from];
+	rowSums[into] = rowSums[from];
+	colSums[into] = colSums[from];
+	for (int channel = 0; channel < 3; channel++) {
+		sums[channel][into] = sums[channel][from];
+		squareSums[channel][into] = squareSums[channel][from];
+	}
+	perimeters[into] = perimeters[from];
+}
@@ -0,0 +1,177 @@
+// regionTable.h
+// Author: Terence Ho
+//
+// This file describes the per-region statistics table. Each statistic is
+// kept in its own column vector (structure of arrays), so a tool that only
+// needs areas or bounding boxes reads just those columns. The regionStore
+// fills the table from every run as it is labelled, and the labelling code
+// reports the edges a new run shares with pixels of the same region that
+// are already labelled, so the perimeter is known without another pass
+// over the image. The table can be saved as CSV or as a binary file of
+// whole columns. Columns only grow, so a table reused for the next image
+// adds regions without writing every column again, and the first run of a
+// region sets its statistics instead of adding to them.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Smallest rectangle holding every pixel of a region, inclusive
+struct regionBox {
+	int top;
+	int left;
+	int bottom;
+	int right;
+};
+
+// First bytes of a binary region table file
+const char REGION_TABLE_MAGIC[8] = { 'P', '4', 'R', 'E', 'G', 'T', 'A', 'B' };
+const uint32_t REGION_TABLE_VERSION = 1;
+
+class regionTable {
+public:
+	// regionTable()
+	// Creates a table with no regions
+	regionTable();
+
+	// clear()
+	// Postcondition: Removes every region, reserved memory is kept
+	void clear();
+
+	// addRegion()
+	// Postcondition: Adds an empty region and returns its label
+	uint32_t addRegion();
+
+	// addRun()
+	// Precondition: label is an existing region, pixels is the row span
+	//				 of row and left <= right are columns of it
+	// Postcondition: The run is counted in every statistic of the region,
+	//				  its perimeter grows as if the run touched nothing
+	void addRun(uint32_t label, int row, int left, int right,
+		const pixel *pixels);
+
+	// addPixel()
+	// Precondition: label is an existing region
+	// Postcondition: The pixel is counted as a run of one
+	void addPixel(uint32_t label, int row, int col, const pixel &newPixel);
+
+	// clearColors()
+	// Precondition: label is an existing region
+	// Postcondition: The channel sums and sums of squares of the region are
+	//				  0, every other statistic is kept
+	void clearColors(uint32_t label);
+
+	// addColors()
+	// Precondition: label is an existing region, pixels is a row span and
+	//				 left <= right are columns of it
+	// Postcondition: The run is added to the channel sums and sums of
+	//				  squares of the region only, for counting the colours
+	//				  of a region again from another image
+	void addColors(uint32_t label, int left, int right, const pixel *pixels);
+
+	// joinEdges()
+	// Precondition: label is an existing region
+	// Postcondition: edges pixel edges of the region are shared with other
+	//				  pixels of it, so they are taken off the perimeter
+	void joinEdges(uint32_t label, uint64_t edges);
+
+	// merge()
+	// Precondition: into and from are different existing regions
+	// Postcondition: The statistics of from are added to into and from is
+	//				  left empty. Edges the two regions share must still be
+	//				  reported with joinEdges.
+	void merge(uint32_t into, uint32_t from);
+
+	// size()
+	// Postcondition: Returns the number of regions, including empty ones
+	size_t size() const;
+
+	// area()
+	// Precondition: label is an existing region
+	// Postcondition: Returns the number of pixels of the region
+	uint64_t area(uint32_t label) const;
+
+	// box()
+	// Precondition: label is an existing region that is not empty
+	// Postcondition: Returns the bounding box of the region
+	regionBox box(uint32_t label) const;
+
+	// centroidRow() / centroidCol()
+	// Precondition: label is an existing region
+	// Postcondition: Returns the mean row or column of the region's
+	//				  pixels, 0 if it is empty
+	double centroidRow(uint32_t label) const;
+	double centroidCol(uint32_t label) const;
+
+	// mean()
+	// Precondition: label is an existing region, channel is 0 (red),
+	//				 1 (green) or 2 (blue)
+	// Postcondition: Returns the mean of the channel over the region
+	double mean(uint32_t label, int channel) const;
+
+	// channelSum()
+	// Precondition: label is an existing region, channel is 0 to 2
+	// Postcondition: Returns the sum of the channel over the region
+	uint64_t channelSum(uint32_t label, int channel) const;
+
+	// variance()
+	// Precondition: label is an existing region, channel is 0 to 2
+	// Postcondition: Returns the population variance of the channel
+	double variance(uint32_t label, int channel) const;
+
+	// perimeter()
+	// Precondition: label is an existing region
+	// Postcondition: Returns the number of pixel edges between the region
+	//				  and other regions or the image border
+	uint64_t perimeter(uint32_t label) const;
+
+	// writeCSV()
+	// Postcondition: Saves one line per region that is not empty, with a
+	//				  header line naming the columns. Returns false if the
+	//				  file can not be written.
+	bool writeCSV(const string &filename) const;
+
+	// writeBinary()
+	// Postcondition: Saves a 16 byte header (REGION_TABLE_MAGIC, version,
+	//				  region count) followed by whole columns for every
+	//				  region: area (uint64), top, left, bottom, right
+	//				  (int32), centroid row and column, red, green and blue
+	//				  mean, red, green and blue variance (double) and
+	//				  perimeter (uint64), in the byte order of the machine.
+	//				  Returns false if the file can not be written.
+	bool writeBinary(const string &filename) const;
+
+private:
+	size_t used;					// regions in use, columns may be longer
+	vector<uint64_t> areas;
+	vector<int32_t> tops;
+	vector<int32_t> lefts;
+	vector<int32_t> bottoms;
+	vector<int32_t> rights;
+	vector<uint64_t> rowSums;		// sum of the row of every pixel
+	vector<uint64_t> colSums;		// sum of the column of every pixel
+	vector<uint64_t> sums[3];		// channel sums
+	vector<uint64_t> squareSums[3];	// sums of squared channel values
+	vector<uint64_t> perimeters;
+
+	// grow()
+	// Postcondition: Every column has room for at least one more region
+	void grow();
+
+	// copyRegion()
+	// Precondition: from is not empty
+	// Postcondition: Every statistic of into is set to those of from
+	void copyRegion(uint32_t into, uint32_t from);
+
+	// addTotals()
+	// Precondition: channels and squares are the channel sums and sums of
+	//				 squares of the run left to right of row
+	// Postcondition: The run is counted in every statistic of the region
+	void addTotals(uint32_t label, int row, int left, int right,
+		const uint32_t channels[3], const uint64_t squares[3]);
+};
@@ -0,0 +1,250 @@
+// runComponents.cpp
+// Author: Terence Ho
+//
+// Two-pass connected-component labelling over runs of similar pixels,
+// with a union-find forest of provisional run labels.
+//---------------------------------------------------------------------------
+#include "runComponents.h"
+#include "metrics.h"
+#include "pixelKernels.h"
+#include "unionFind.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Run of one row with its provisional or final label
+struct labelledRun {
+	int left;
+	int right;			// inclusive
+	uint32_t label;
+};
+
+//----------------------------------------------------------------------------
+// overlapSimilar()
+// Precondition: from <= to are columns of in and above
+// Postcondition: Returns true if some pixel from from to to is within
+//				  threshold of the pixel above it
+bool overlapSimilar(const pixel *in, const pixel *above, int from, int to,
+	int threshold) {
+	for (int col = from; col <= to; col++) {
+		if (colorDistance(in[col], above[col]) < threshold) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+// runEnd()
+// Precondition: mask holds the similarPairs bits of a row of cols pixels
+//				 against itself one pixel on, left is a column of the row
+// Postcondition: Returns the last column of the run starting at left
+int runEnd(const uint64_t *mask, int left, int cols) {
+	for (int word = left / 64; word * 64 < cols - 1; word++) {
+		uint64_t breaks = ~mask[word];
+		if (word == left / 64) {
+			breaks &= ~0ull << (left % 64);
+		}
+		if (breaks != 0) {
+			int col = word * 64 + trailingZeros(breaks);
+			return col < cols - 1 ? col : cols - 1;
+		}
+	}
+	return cols - 1;
+}
+
+//----------------------------------------------------------------------------
+// findRuns()
+// Precondition: input is a valid image, rowStart has rows + 1 entries
+// Postcondition: First pass. runs holds the runs of every row, those of
+//				  row r from rowStart[r] up to rowStart[r + 1], each
+//				  labelled with a set of sets joined with the runs above
+//				  it that it touches through similar pixels.
+void findRuns(const imageClass &input, int threshold, unionFind &sets,
+	vector<labelledRun> &runs, vector<size_t> &rowStart) {
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	// bit c is set if pixel c + 1 continues the run holding pixel c
+	vector<uint64_t> mask(maskWords(cols));
+	for (int row = 0; row < rows; row++) {
+		rowStart[row] = runs.size();
+		const pixel *in = input.rowSpan(row);
+		similarPairs(in, in + 1, cols - 1, threshold, mask.data());
+		const pixel *above = row > 0 ? input.rowSpan(row - 1) : nullptr;
+		size_t previous = row > 0 ? rowStart[row - 1] : 0;
+		const size_t previousEnd = rowStart[row];
+
+		int left = 0;
+		while (left < cols) {
+			int right = runEnd(mask.data(), left, cols);
+
+			uint32_t label = NO_LABEL;
+			if (above != nullptr) {
+				// runs above that end before this one can not touch it or
+				// any later run on this row
+				while (previous < previousEnd && runs[previous].right < left) {
+					previous++;
+				}
+				for (size_t up = previous;
+					up < previousEnd && runs[up].left <= right; up++) {
+					uint32_t upLabel = runs[up].label;
+					// already joined through another run, no need to look
+					if (label != NO_LABEL &&
+						sets.find(label) == sets.find(upLabel)) {
+						continue;
+					}
+					if (overlapSimilar(in, above, max(left, runs[up].left),
+						min(right, runs[up].right), threshold)) {
+						if (label == NO_LABEL) {
+							label = upLabel;
+						} else {
+							sets.unite(label, upLabel);
+						}
+					}
+				}
+			}
+			if (label == NO_LABEL) {
+				label = sets.makeSet();
+			}
+			labelledRun run = { left, right, label };
+			runs.push_back(run);
+			left = right + 1;
+		}
+	}
+	rowStart[rows] = runs.size();
+}
+
+//----------------------------------------------------------------------------
+// resolveRuns()
+// Precondition: runs and rowStart were made by findRuns with sets
+// Postcondition: Second pass. Every set becomes a region numbered in scan
+//				  order, neighbouring runs of one region are joined, and
+//				  the runs are added to regions with the edges they share
+//				  with the row above. labels is filled too unless null.
+void resolveRuns(const imageClass &input, unionFind &sets,
+	const vector<labelledRun> &runs, const vector<size_t> &rowStart,
+	regionStore &regions, labelMap *labels) {
+	const int rows = input.getRow();
+	vector<uint32_t> finalLabel(sets.size(), NO_LABEL);
+	vector<labelledRun> current;
+	vector<labelledRun> previous;
+
+	for (int row = 0; row < rows; row++) {
+		const pixel *in = input.rowSpan(row);
+		current.clear();
+		for (size_t index = rowStart[row]; index < rowStart[row + 1]; index++) {
+			const labelledRun &run = runs[index];
+			uint32_t root = sets.find(run.label);
+			uint32_t label = finalLabel[root];
+			if (label == NO_LABEL) {
+				label = regions.addRegion(row, run.left, in[run.left]);
+				finalLabel[root] = label;
+			}
+			if (!current.empty() && current.back().label == label) {
+				current.back().right = run.right;
+			} else {
+				labelledRun joined = { run.left, run.right, label };
+				current.push_back(joined);
+			}
+		}
+
+		uint32_t *labelRow = labels != nullptr ? labels->rowSpan(row) : nullptr;
+		size_t up = 0;
+		for (const labelledRun &run : current) {
+			regions.addRun(run.label, row, run.left, run.right, in);
+			if (labelRow != nullptr) {
+				fill(labelRow + run.left, labelRow + run.right + 1, run.label);
+			}
+			// edges shared with runs of the same region on the row above
+			while (up < previous.size() && previous[up].right < run.left) {
+				up++;
+			}
+			int joined = 0;
+			for (size_t other = up;
+				other < previous.size() && previous[other].left <= run.right;
+				other++) {
+				if (previous[other].label == run.label) {
+					joined += min(run.right, previous[other].right) -
+						max(run.left, previous[other].left) + 1;
+				}
+			}
+			if (joined > 0) {
+				regions.joinEdges(run.label, joined);
+			}
+		}
+		swap(current, previous);
+	}
+}
+
+//----------------------------------------------------------------------------
+// labelRuns()
+// Precondition: input is a valid image, regions is empty
+// Postcondition: Both passes, with labels filled unless null
+void labelRuns(const imageClass &input, regionStore &regions,
+	labelMap *labels, int threshold) {
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	if (rows == 0 || cols == 0) {
+		return;
+	}
+	unionFind sets;
+	vector<labelledRun> runs;
+	vector<size_t> rowStart(rows + 1);
+	runs.reserve(rows);
+	findRuns(input, threshold, sets, runs, rowStart);
+	resolveRuns(input, sets, runs, rowStart, regions, labels);
+	metricAdd(COUNTER_PIXELS, (uint64_t)rows * cols);
+	metricAdd(COUNTER_REGIONS, regions.regionCount());
+}
+
+}
+
+//----------------------------------------------------------------------------
+// segmentRuns()
+// Precondition: input is a valid image
+// Postcondition: regions holds one region per 4-connected group of pixels
+//				  whose neighbouring colours differ by less than threshold,
+//				  with the same labels, runs and statistics as
+//				  segmentComponents gives. No label map is made.
+void segmentRuns(const imageClass &input, regionStore &regions,
+	int threshold) {
+	stageTimer timer(STAGE_SEGMENT);
+	regions.clear();
+	labelRuns(input, regions, nullptr, threshold);
+}
+
+//----------------------------------------------------------------------------
+// segmentRuns()
+// Precondition: input is a valid image
+// Postcondition: result holds the same regions as segmentComponents with
+//				  the same threshold, the label map filled run by run
+void segmentRuns(const imageClass &input, segmentationResult &result,
+	int threshold) {
+	stageTimer timer(STAGE_SEGMENT);
+	result.reset(input.getRow(), input.getCol());
+	labelRuns(input, result.getRegions(), &result.getLabels(), threshold);
+}
+
+//----------------------------------------------------------------------------
+// renderRuns()
+// Precondition: output has the size of the image regions was found in
+// Postcondition: Every run of every region is filled with the average
+//				  colour of its region, pixels outside all runs are left
+//				  as they are
+void renderRuns(const regionStore &regions, imageClass &output) {
+	stageTimer timer(STAGE_RENDER);
+	for (int label = 0; label < regions.regionCount(); label++) {
+		const pixel colour = regions.averageColor(label);
+		for (int32_t run = regions.firstRun(label); run != NO_RUN;
+			run = regions.nextRun(run)) {
+			regionRun span = regions.getRun(run);
+			if (span.row >= output.getRow() || span.right >= output.getCol()) {
+				continue;
+			}
+			pixel *target = output.rowSpan(span.row);
+			fill(target + span.left, target + span.right + 1, colour);
+		}
+	}
+}
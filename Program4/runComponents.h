@@ -0,0 +1,45 @@
+// runComponents.h
+// Author: Terence Ho
+//
+// This file describes connected-component labelling over runs instead of
+// pixels. Each row is first cut into runs of neighbouring pixels whose
+// colours differ by less than the threshold, then every run is joined in
+// a union-find forest with the runs it overlaps on the row above when a
+// pair of pixels stacked in the overlap is similar. A flat area is a
+// handful of runs however many pixels it covers, so scans and screenshots
+// with large uniform areas do far less work than per-pixel labelling.
+// The regions are the same as segmentComponents finds, numbered the same
+// way, and a regionStore already keeps every region as runs, so the label
+// map can be left out entirely.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "regionStore.h"
+#include "segmentation.h"
+
+//----------------------------------------------------------------------------
+// segmentRuns()
+// Precondition: input is a valid image
+// Postcondition: regions holds one region per 4-connected group of pixels
+//				  whose neighbouring colours differ by less than threshold,
+//				  with the same labels, runs and statistics as
+//				  segmentComponents gives. No label map is made.
+void segmentRuns(const imageClass &input, regionStore &regions,
+	int threshold = SEED_THRESHOLD);
+
+//----------------------------------------------------------------------------
+// segmentRuns()
+// Precondition: input is a valid image
+// Postcondition: result holds the same regions as segmentComponents with
+//				  the same threshold, the label map filled run by run
+void segmentRuns(const imageClass &input, segmentationResult &result,
+	int threshold = SEED_THRESHOLD);
+
+//----------------------------------------------------------------------------
+// renderRuns()
+// Precondition: output has the size of the image regions was found in
+// Postcondition: Every run of every region is filled with the average
+//				  colour of its region, pixels outside all runs are left
+//				  as they are
+void renderRuns(const regionStore &regions, imageClass &output);
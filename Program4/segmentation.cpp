@@ -0,0 +1,256 @@
+// segmentation.cpp
+// Author: Terence Ho
+//
+// Segmentation result and the seed based segmentation driver. Regions are
+// labelled in a separate map, so the colours of the input and output
+// images never affect which pixels have been visited.
+//---------------------------------------------------------------------------
+#include "segmentation.h"
+#include "colorSpace.h"
+#include "floodFill.h"
+#include "componentLabel.h"
+#include "metrics.h"
+#include "priorityGrowing.h"
+#include "runComponents.h"
+#include "tileSegment.h"
+#include <algorithm>
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// paletteColor()
+// Postcondition: Returns a colour scrambled from label, the same for the
+//				  same label on every run
+pixel paletteColor(uint32_t label) {
+	uint32_t mix = label * 0x9E3779B1u;
+	mix ^= mix >> 15;
+	mix *= 0x85EBCA77u;
+	mix ^= mix >> 13;
+	pixel colour;
+	colour.red = (byte)mix;
+	colour.green = (byte)(mix >> 8);
+	colour.blue = (byte)(mix >> 16);
+	return colour;
+}
+
+//---------------------------------------------------------------------------
+// segmentationResult()
+// Creates an empty result with no regions
+segmentationResult::segmentationResult() {
+}
+
+//---------------------------------------------------------------------------
+// reset()
+// Precondition: rows and cols describe the image being segmented
+// Postcondition: Every pixel is unlabelled and there are no regions
+void segmentationResult::reset(int rows, int cols) {
+	labels.reset(rows, cols);
+	regions.clear();
+	regions.reserveRuns(rows);
+}
+
+//---------------------------------------------------------------------------
+// addRegion()
+// Precondition: row and col are the seed pixel of a new region
+// Postcondition: Returns the label of a new empty region
+uint32_t segmentationResult::addRegion(int row, int col, const pixel &seed) {
+	return regions.addRegion(row, col, seed);
+}
+
+//---------------------------------------------------------------------------
+// getLabels()
+// Postcondition: Returns the label of every pixel
+labelMap &segmentationResult::getLabels() {
+	return labels;
+}
+
+const labelMap &segmentationResult::getLabels() const {
+	return labels;
+}
+
+//---------------------------------------------------------------------------
+// regionCount()
+// Postcondition: Returns the number of regions found
+int segmentationResult::regionCount() const {
+	return regions.regionCount();
+}
+
+//---------------------------------------------------------------------------
+// getRegion()
+// Precondition: label is less than regionCount()
+// Postcondition: Returns the seed, size and sums of that region
+regionStats segmentationResult::getRegion(uint32_t label) const {
+	return regions.getRegion(label);
+}
+
+//---------------------------------------------------------------------------
+// getRegions()
+// Postcondition: Returns the store holding the runs of every region
+regionStore &segmentationResult::getRegions() {
+	return regions;
+}
+
+const regionStore &segmentationResult::getRegions() const {
+	return regions;
+}
+
+//----------------------------------------------------------------------------
+// getTable()
+// Postcondition: Returns the area, bounding box, centroid, colour
+//				  mean and variance and perimeter of every region
+const regionTable &segmentationResult::getTable() const {
+	return regions.getTable();
+}
+
+//---------------------------------------------------------------------------
+// render()
+// Precondition: output has the same size as the segmented image, and
+//				 so has background if it is given
+// Postcondition: Every pixel of output is coloured by mode in one pass
+//				  over the label map. Unlabelled pixels are white. A
+//				  boundary pixel is one with a 4-connected neighbour in
+//				  another region.
+void segmentationResult::render(imageClass &output, renderMode mode,
+	const imageClass *background) const {
+	stageTimer timer(STAGE_RENDER);
+	const int rows = labels.getRow();
+	const int cols = labels.getCol();
+	if (output.getRow() != rows || output.getCol() != cols) {
+		return;
+	}
+	if (background != nullptr && (background->getRow() != rows ||
+		background->getCol() != cols)) {
+		background = nullptr;
+	}
+
+	// colour of each label, one entry along so NO_LABEL wraps to the
+	// white entry 0 and the pass below needs no branch
+	vector<pixel> colours(regions.regionCount() + 1);
+	colours[0].red = 255;
+	colours[0].green = 255;
+	colours[0].blue = 255;
+	for (uint32_t label = 0; label + 1 < colours.size(); label++) {
+		colours[label + 1] = mode == RENDER_PALETTE ? paletteColor(label) :
+			regions.averageColor(label);
+	}
+	const pixel *lookup = colours.data();
+
+	for (int row = 0; row < rows; row++) {
+		const uint32_t *labelRow = labels.rowSpan(row);
+		pixel *target = output.rowSpan(row);
+		if (mode == RENDER_BOUNDARY && background != nullptr) {
+			const pixel *source = background->rowSpan(row);
+			copy(source, source + cols, target);
+		} else {
+			for (int col = 0; col < cols; col++) {
+				target[col] = lookup[labelRow[col] + 1];
+			}
+		}
+		if (mode != RENDER_BOUNDARY) {
+			continue;
+		}
+
+		// pixels that differ from a neighbour, the image border is not a
+		// boundary
+		const uint32_t *above = row > 0 ? labels.rowSpan(row - 1) : labelRow;
+		const uint32_t *below = row + 1 < rows ? labels.rowSpan(row + 1) :
+			labelRow;
+		for (int col = 0; col < cols; col++) {
+			uint32_t label = labelRow[col];
+			uint32_t left = col > 0 ? labelRow[col - 1] : label;
+			uint32_t right = col + 1 < cols ? labelRow[col + 1] : label;
+			if ((label != left) | (label != right) | (label != above[col]) |
+				(label != below[col])) {
+				target[col] = BOUNDARY_COLOR;
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// segmentSeeded()
+// Precondition: input is a valid image
+// Postcondition: result holds one region per seed, grown in scan order from
+//				  the first unlabelled pixel with floodFill by growing
+void segmentSeeded(const imageClass &input, segmentationResult &result,
+	const growOptions &growing) {
+	stageTimer timer(STAGE_SEGMENT);
+	result.reset(input.getRow(), input.getCol());
+	floodFillAll(input, result, growing);
+	metricAdd(COUNTER_REGIONS, result.regionCount());
+}
+
+namespace {
+
+//---------------------------------------------------------------------------
+// segmentWith()
+// Precondition: input is a valid image, pool is null or runs the tiles
+//				 of SEGMENT_TILES, otherwise a pool of threads workers does.
+//				 converted is null or a buffer kept by the caller.
+// Postcondition: result holds the regions of input found with mode
+void segmentWith(const imageClass &input, segmentationResult &result,
+	segmentMode mode, threadPool *pool, int threads,
+	const growOptions &growing, colorSpace space, imageClass *converted) {
+	if (space != SPACE_RGB) {
+		imageClass scratch;
+		imageClass &compared = converted != nullptr ? *converted : scratch;
+		convertImage(input, compared, space);
+		segmentWith(compared, result, mode, pool, threads, growing, SPACE_RGB,
+			nullptr);
+		recolorRegions(input, result);
+		return;
+	}
+	switch (mode) {
+	case SEGMENT_COMPONENTS:
+		segmentComponents(input, result);
+		break;
+	case SEGMENT_RUNS:
+		segmentRuns(input, result);
+		break;
+	case SEGMENT_PRIORITY:
+		segmentPriority(input, result, growing);
+		break;
+	case SEGMENT_TILES:
+		if (pool != nullptr) {
+			segmentTiles(input, result, *pool);
+		} else {
+			threadPool workers(threads);
+			segmentTiles(input, result, workers);
+		}
+		break;
+	case SEGMENT_SEEDED:
+	default:
+		segmentSeeded(input, result, growing);
+		break;
+	}
+}
+
+}
+
+//---------------------------------------------------------------------------
+// segmentImage()
+// Precondition: input is a valid image, threads is the number of worker
+//				 threads for SEGMENT_TILES (0 uses one per core)
+// Postcondition: result holds the regions of input found with mode,
+//				  SEGMENT_SEEDED and SEGMENT_PRIORITY grow them by growing.
+//				  Pixels are compared in space, the statistics stay RGB.
+//				  The pixels in space are kept in converted if it is
+//				  given, so a caller segmenting many images reuses it.
+void segmentImage(const imageClass &input, segmentationResult &result,
+	segmentMode mode, int threads, const growOptions &growing,
+	colorSpace space, imageClass *converted) {
+	segmentWith(input, result, mode, nullptr, threads, growing, space,
+		converted);
+}
+
+//---------------------------------------------------------------------------
+// segmentImage()
+// Precondition: input is a valid image, pool is kept by the caller to run
+//				 the tiles of SEGMENT_TILES and may be shared by callers
+//				 on other threads
+// Postcondition: Same as segmentImage() above, without starting threads
+void segmentImage(const imageClass &input, segmentationResult &result,
+	segmentMode mode, threadPool &pool, const growOptions &growing,
+	colorSpace space, imageClass *converted) {
+	segmentWith(input, result, mode, &pool, 0, growing, space, converted);
+}
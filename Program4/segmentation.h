@@ -0,0 +1,190 @@
+// segmentation.h
+// Author: Terence Ho
+//
+// This file describes the result of segmenting an image: a label for every
+// pixel plus a regionStore with the runs and running statistics of every
+// region found. The result is
+// filled in by the region growing engine and rendered to an output image
+// in a single pass over the label map, through a table holding the colour
+// of every label.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "labelMap.h"
+#include "pixelKernels.h"
+#include "regionStore.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+class threadPool;
+
+// Colour distance (sum of absolute channel differences) at which two pixels
+// stop belonging to the same region.
+const int SEED_THRESHOLD = 100;
+
+// Ways of splitting an image into regions
+enum segmentMode {
+	SEGMENT_SEEDED,		// flood fill from seeds in scan order
+	SEGMENT_COMPONENTS,	// union-find connected-component labelling
+	SEGMENT_TILES,		// connected components labelled tile by tile
+						// on a thread pool
+	SEGMENT_RUNS,		// connected components labelled run by run
+	SEGMENT_PRIORITY	// seeded region growing, closest pixel to the
+						// region average first
+};
+
+// Ways of colouring the output image
+enum renderMode {
+	RENDER_AVERAGE,		// every region in its average colour
+	RENDER_PALETTE,		// every region in a colour picked from its label,
+						// so neighbouring regions stand apart
+	RENDER_BOUNDARY		// region boundaries drawn over a background image,
+						// or over the average colours if there is none
+};
+
+// Colour of the pixels render() finds on a region boundary
+const pixel BOUNDARY_COLOR = { 255, 0, 0 };
+
+// Neighbours a region grows into
+enum connectivity {
+	CONNECT_4,			// left, right, above and below
+	CONNECT_8			// the four diagonal pixels as well
+};
+
+// What a candidate pixel is compared with while a region grows
+enum similarityRule {
+	SIMILAR_SEED,		// the colour of the seed pixel
+	SIMILAR_NEIGHBOUR,	// the region pixel it was reached from
+	SIMILAR_MEAN,		// the average colour of the region so far
+	SIMILAR_LUMA		// the brightness of the seed pixel only
+};
+
+// How segmentSeeded grows every region
+struct growOptions {
+	connectivity connect;
+	similarityRule similarity;
+	int threshold;
+	colorMetric metric;		// not used by SIMILAR_LUMA
+};
+
+// Colours the similarity tests compare, see colorSpace.h
+enum colorSpace {
+	SPACE_RGB,			// the pixels as read
+	SPACE_YCBCR,		// brightness and two colour differences
+	SPACE_LAB			// CIE Lab, close to perceived differences
+};
+
+// The original rule, 4-connected pixels close to the seed colour
+const growOptions DEFAULT_GROW = { CONNECT_4, SIMILAR_SEED, SEED_THRESHOLD,
+	METRIC_L1 };
+
+// Largest value colorDistance() returns
+const int MAX_COLOR_DISTANCE = 3 * 255;
+
+//----------------------------------------------------------------------------
+// colorDistance()
+// Postcondition: Returns the sum of absolute channel differences of a and b
+inline int colorDistance(const pixel &a, const pixel &b) {
+	int red = a.red - b.red;
+	int green = a.green - b.green;
+	int blue = a.blue - b.blue;
+	return (red < 0 ? -red : red) + (green < 0 ? -green : green) +
+		(blue < 0 ? -blue : blue);
+}
+
+//----------------------------------------------------------------------------
+// paletteColor()
+// Postcondition: Returns a colour scrambled from label, the same for the
+//				  same label on every run
+pixel paletteColor(uint32_t label);
+
+class segmentationResult {
+public:
+	// segmentationResult()
+	// Creates an empty result with no regions
+	segmentationResult();
+
+	// reset()
+	// Precondition: rows and cols describe the image being segmented
+	// Postcondition: Every pixel is unlabelled and there are no regions
+	void reset(int rows, int cols);
+
+	// addRegion()
+	// Precondition: row and col are the seed pixel of a new region
+	// Postcondition: Returns the label of a new empty region
+	uint32_t addRegion(int row, int col, const pixel &seed);
+
+	// getLabels()
+	// Postcondition: Returns the label of every pixel
+	labelMap &getLabels();
+	const labelMap &getLabels() const;
+
+	// regionCount()
+	// Postcondition: Returns the number of regions found
+	int regionCount() const;
+
+	// getRegion()
+	// Precondition: label is less than regionCount()
+	// Postcondition: Returns the seed, size and sums of that region
+	regionStats getRegion(uint32_t label) const;
+
+	// getRegions()
+	// Postcondition: Returns the store holding the runs of every region
+	regionStore &getRegions();
+	const regionStore &getRegions() const;
+
+	// getTable()
+	// Postcondition: Returns the area, bounding box, centroid, colour
+	//				  mean and variance and perimeter of every region
+	const regionTable &getTable() const;
+
+	// render()
+	// Precondition: output has the same size as the segmented image, and
+	//				 so has background if it is given
+	// Postcondition: Every pixel of output is coloured by mode in one pass
+	//				  over the label map. Unlabelled pixels are white. A
+	//				  boundary pixel is one with a 4-connected neighbour in
+	//				  another region.
+	void render(imageClass &output, renderMode mode = RENDER_AVERAGE,
+		const imageClass *background = nullptr) const;
+
+private:
+	labelMap labels;
+	regionStore regions;
+};
+
+//----------------------------------------------------------------------------
+// segmentSeeded()
+// Precondition: input is a valid image
+// Postcondition: result holds one region per seed, grown in scan order from
+//				  the first unlabelled pixel with floodFill by growing
+void segmentSeeded(const imageClass &input, segmentationResult &result,
+	const growOptions &growing = DEFAULT_GROW);
+
+//----------------------------------------------------------------------------
+// segmentImage()
+// Precondition: input is a valid image, threads is the number of worker
+//				 threads for SEGMENT_TILES (0 uses one per core)
+// Postcondition: result holds the regions of input found with mode,
+//				  SEGMENT_SEEDED and SEGMENT_PRIORITY grow them by growing.
+//				  Pixels are compared in space, the statistics stay RGB.
+//				  The pixels in space are kept in converted if it is
+//				  given, so a caller segmenting many images reuses it.
+void segmentImage(const imageClass &input, segmentationResult &result,
+	segmentMode mode, int threads = 0,
+	const growOptions &growing = DEFAULT_GROW, colorSpace space = SPACE_RGB,
+	imageClass *converted = nullptr);
+
+//----------------------------------------------------------------------------
+// segmentImage()
+// Precondition: input is a valid image, pool is kept by the caller to run
+//				 the tiles of SEGMENT_TILES and may be shared by callers
+//				 on other threads
+// Postcondition: Same as segmentImage() above, without starting threads
+void segmentImage(const imageClass &input, segmentationResult &result,
+	segmentMode mode, threadPool &pool,
+	const growOptions &growing = DEFAULT_GROW, colorSpace space = SPACE_RGB,
+	imageClass *converted = nullptr);
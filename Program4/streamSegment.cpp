@@ -0,0 +1,212 @@
+// streamSegment.cpp
+// Author: Terence Ho
+//
+// Streaming segmentation over a rolling window of two rows. Labels made
+// for one row are compacted to 0..k-1 before the next row is pushed, with
+// k at most the width of the image, so the forest, the statistics and the
+// label rows all stay the size of a row.
+//---------------------------------------------------------------------------
+#include "streamSegment.h"
+#include "ImageClass.h"
+#include "gifCodec.h"
+#include "metrics.h"
+
+using namespace std;
+
+namespace {
+
+//----------------------------------------------------------------------------
+// mergeStats()
+// Postcondition: from is counted in into, which keeps whichever seed
+//				  comes first in scan order
+void mergeStats(regionStats &into, const regionStats &from) {
+	if (from.seedRow < into.seedRow ||
+		(from.seedRow == into.seedRow && from.seedCol < into.seedCol)) {
+		into.seedRow = from.seedRow;
+		into.seedCol = from.seedCol;
+		into.seed = from.seed;
+	}
+	into.count += from.count;
+	into.redSum += from.redSum;
+	into.greenSum += from.greenSum;
+	into.blueSum += from.blueSum;
+}
+
+}
+
+//----------------------------------------------------------------------------
+// streamSegmenter()
+// Precondition: cols is the width of every row pushed
+// Postcondition: Regions are grown from 4-connected pixels whose
+//				  neighbouring colours differ by less than threshold
+//				  and are passed to sink as they close
+streamSegmenter::streamSegmenter(int cols, const regionSink &sink,
+	int threshold) : cols(cols < 0 ? 0 : cols), threshold(threshold),
+	sink(sink), rowsSeen(0), emitted(0) {
+	previous.resize(this->cols);
+	previousLabels.resize(this->cols);
+	labels.resize(this->cols);
+	// a row adds at most cols labels to the cols carried over
+	sets.reserve((size_t)this->cols * 2);
+	remap.reserve((size_t)this->cols * 2);
+	open.reserve((size_t)this->cols * 2);
+	kept.reserve((size_t)this->cols * 2);
+}
+
+//----------------------------------------------------------------------------
+// pushRow()
+// Precondition: in holds the cols pixels of the next row, top first
+// Postcondition: The row is labelled, regions that do not reach it
+//				  are passed to the sink
+void streamSegmenter::pushRow(const pixel *in) {
+	for (int col = 0; col < cols; col++) {
+		uint32_t label = NO_LABEL;
+		if (col > 0 && colorDistance(in[col], in[col - 1]) < threshold) {
+			label = labels[col - 1];
+		}
+		if (rowsSeen > 0 && colorDistance(in[col], previous[col]) < threshold) {
+			uint32_t above = previousLabels[col];
+			if (label == NO_LABEL) {
+				label = above;
+			} else if (label != above) {
+				sets.unite(label, above);
+			}
+		}
+		if (label == NO_LABEL) {
+			label = sets.makeSet();
+			regionStats stats = { rowsSeen, col, in[col], 0, 0, 0, 0 };
+			open.push_back(stats);
+		}
+		labels[col] = label;
+		addPixel(label, in[col]);
+	}
+
+	previous.assign(in, in + cols);
+	rowsSeen++;
+	metricAdd(COUNTER_PIXELS, cols);
+	compact();
+}
+
+//----------------------------------------------------------------------------
+// finish()
+// Postcondition: Every region still open is passed to the sink and
+//				  the segmenter is ready for a new image
+void streamSegmenter::finish() {
+	// after compact() every open label is the root of its own set
+	for (const regionStats &region : open) {
+		sink(region);
+		emitted++;
+	}
+	open.clear();
+	sets.clear();
+	rowsSeen = 0;
+}
+
+//----------------------------------------------------------------------------
+// getRowsSeen()
+// Postcondition: Returns the number of rows pushed since the last finish
+int streamSegmenter::getRowsSeen() const {
+	return rowsSeen;
+}
+
+//----------------------------------------------------------------------------
+// openRegions()
+// Postcondition: Returns the number of regions touching the last row
+size_t streamSegmenter::openRegions() const {
+	return open.size();
+}
+
+//----------------------------------------------------------------------------
+// regionsEmitted()
+// Postcondition: Returns the number of regions passed to the sink
+uint64_t streamSegmenter::regionsEmitted() const {
+	return emitted;
+}
+
+//----------------------------------------------------------------------------
+// addPixel()
+// Precondition: label is a set id made for the current row or carried over
+// Postcondition: The pixel is counted in the statistics of label
+void streamSegmenter::addPixel(uint32_t label, const pixel &in) {
+	regionStats &stats = open[label];
+	stats.count++;
+	stats.redSum += in.red;
+	stats.greenSum += in.green;
+	stats.blueSum += in.blue;
+}
+
+//----------------------------------------------------------------------------
+// compact()
+// Precondition: labels holds the set ids of the row just pushed
+// Postcondition: Statistics are folded into the root of each set. Sets
+//				  that reach the row are renumbered 0..k-1 in the order
+//				  they appear on it, the rest are passed to the sink.
+//				  The forest then holds just the k renumbered sets.
+void streamSegmenter::compact() {
+	const uint32_t ids = (uint32_t)sets.size();
+	for (uint32_t id = 0; id < ids; id++) {
+		uint32_t root = sets.find(id);
+		if (root != id) {
+			mergeStats(open[root], open[id]);
+		}
+	}
+
+	remap.assign(ids, NO_LABEL);
+	kept.clear();
+	for (int col = 0; col < cols; col++) {
+		uint32_t root = sets.find(labels[col]);
+		if (remap[root] == NO_LABEL) {
+			remap[root] = (uint32_t)kept.size();
+			kept.push_back(open[root]);
+		}
+		labels[col] = remap[root];
+	}
+
+	for (uint32_t id = 0; id < ids; id++) {
+		if (remap[id] == NO_LABEL && sets.find(id) == id) {
+			sink(open[id]);
+			emitted++;
+		}
+	}
+
+	sets.clear();
+	for (size_t label = 0; label < kept.size(); label++) {
+		sets.makeSet();
+	}
+	open.swap(kept);
+	previousLabels.swap(labels);
+}
+
+//----------------------------------------------------------------------------
+// segmentStream()
+// Precondition: filename refers to a GIF image
+// Postcondition: Decodes the image row by row into a streamSegmenter and
+//				  passes every region to sink. Interlaced images do not
+//				  store their rows in order, so they are read whole first.
+//				  Returns false if the file can not be read.
+bool segmentStream(const string &filename,
+	const streamSegmenter::regionSink &sink, int threshold) {
+	stageTimer timer(STAGE_SEGMENT);
+	gifDecoder decoder;
+	if (!decoder.open(filename)) {
+		return false;
+	}
+	streamSegmenter segmenter(decoder.getCol(), sink, threshold);
+
+	if (decoder.isInterlaced()) {
+		decoder.close();
+		imageClass input(filename);
+		for (int row = 0; row < input.getRow(); row++) {
+			segmenter.pushRow(input.rowSpan(row));
+		}
+	} else {
+		vector<pixel> row(decoder.getCol());
+		while (decoder.hasRows()) {
+			decoder.readRow(row.data());
+			segmenter.pushRow(row.data());
+		}
+	}
+	segmenter.finish();
+	metricAdd(COUNTER_REGIONS, segmenter.regionsEmitted());
+	return true;
+}
@@ -0,0 +1,87 @@
+// streamSegment.h
+// Author: Terence Ho
+//
+// This file describes the streaming segmentation mode for images too large
+// to hold in memory. Rows are labelled one at a time against the row above
+// them, in the same way as the first pass of segmentComponents, and only
+// the labels still open on the newest row are kept. After each row the
+// union-find forest is rebuilt from those labels alone, and every region
+// that no longer touches the row is finished and handed to a callback.
+// Memory therefore grows with the image width, not its area.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageLib.h"
+#include "regionStore.h"
+#include "segmentation.h"
+#include "unionFind.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class streamSegmenter {
+public:
+	// Receives each region once no later row can add to it
+	typedef function<void(const regionStats &)> regionSink;
+
+	// streamSegmenter()
+	// Precondition: cols is the width of every row pushed
+	// Postcondition: Regions are grown from 4-connected pixels whose
+	//				  neighbouring colours differ by less than threshold
+	//				  and are passed to sink as they close
+	streamSegmenter(int cols, const regionSink &sink,
+		int threshold = SEED_THRESHOLD);
+
+	// pushRow()
+	// Precondition: in holds the cols pixels of the next row, top first
+	// Postcondition: The row is labelled, regions that do not reach it
+	//				  are passed to the sink
+	void pushRow(const pixel *in);
+
+	// finish()
+	// Postcondition: Every region still open is passed to the sink and
+	//				  the segmenter is ready for a new image
+	void finish();
+
+	// getRowsSeen()
+	// Postcondition: Returns the number of rows pushed since the last finish
+	int getRowsSeen() const;
+
+	// openRegions()
+	// Postcondition: Returns the number of regions touching the last row
+	size_t openRegions() const;
+
+	// regionsEmitted()
+	// Postcondition: Returns the number of regions passed to the sink
+	uint64_t regionsEmitted() const;
+
+private:
+	int cols;
+	int threshold;
+	regionSink sink;
+	int rowsSeen;
+	uint64_t emitted;
+
+	vector<pixel> previous;			// pixels of the last row pushed
+	vector<uint32_t> previousLabels;	// open labels of the last row
+	vector<uint32_t> labels;		// labels of the row being pushed
+	vector<uint32_t> remap;			// root to compacted label
+	unionFind sets;
+	vector<regionStats> open;		// statistics per set id
+	vector<regionStats> kept;		// statistics of the compacted labels
+
+	void addPixel(uint32_t label, const pixel &in);
+	void compact();
+};
+
+//----------------------------------------------------------------------------
+// segmentStream()
+// Precondition: filename refers to a GIF image
+// Postcondition: Decodes the image row by row into a streamSegmenter and
+//				  passes every region to sink. Interlaced images do not
+//				  store their rows in order, so they are read whole first.
+//				  Returns false if the file can not be read.
+bool segmentStream(const string &filename,
+	const streamSegmenter::regionSink &sink, int threshold = SEED_THRESHOLD);
@@ -0,0 +1,122 @@
+// threadPool.cpp
+// Author: Terence Ho
+//
+// Fixed size pool of worker threads with a shared task queue.
+//---------------------------------------------------------------------------
+#include "threadPool.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// threadPool()
+// Precondition: threads is the number of workers, 0 uses one per core
+// Postcondition: Workers are started and wait for tasks
+threadPool::threadPool(int threads) : running(0), stopping(false) {
+	if (threads <= 0) {
+		threads = hardwareThreads();
+	}
+	workers.reserve(threads);
+	for (int i = 0; i < threads; i++) {
+		workers.emplace_back(&threadPool::workerLoop, this);
+	}
+}
+
+//---------------------------------------------------------------------------
+// ~threadPool()
+// Postcondition: Waits for the queued tasks and joins the workers
+threadPool::~threadPool() {
+	wait();
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (thread &worker : workers) {
+		worker.join();
+	}
+}
+
+//---------------------------------------------------------------------------
+// submit()
+// Precondition: task can run on any thread
+// Postcondition: task is queued for the next free worker
+void threadPool::submit(function<void()> task) {
+	{
+		unique_lock<mutex> guard(lock);
+		tasks.push_back(move(task));
+	}
+	taskReady.notify_one();
+}
+
+//---------------------------------------------------------------------------
+// wait()
+// Postcondition: Returns once every submitted task has finished
+void threadPool::wait() {
+	unique_lock<mutex> guard(lock);
+	allDone.wait(guard, [this] { return tasks.empty() && running == 0; });
+}
+
+//---------------------------------------------------------------------------
+// parallelFor()
+// Precondition: body can be called from several threads at once
+// Postcondition: body(i) has run for every i from 0 to count - 1
+void threadPool::parallelFor(int count, const function<void(int)> &body) {
+	// counted apart from wait(), so callers sharing the pool on several
+	// threads only wait for their own tasks
+	mutex doneLock;
+	condition_variable allRun;
+	int left = count;
+	for (int i = 0; i < count; i++) {
+		submit([&, i] {
+			body(i);
+			lock_guard<mutex> guard(doneLock);
+			if (--left == 0) {
+				allRun.notify_all();
+			}
+		});
+	}
+	unique_lock<mutex> guard(doneLock);
+	allRun.wait(guard, [&left] { return left == 0; });
+}
+
+//---------------------------------------------------------------------------
+// getThreads()
+// Postcondition: Returns the number of workers
+int threadPool::getThreads() const {
+	return (int)workers.size();
+}
+
+//---------------------------------------------------------------------------
+// hardwareThreads()
+// Postcondition: Returns the number of cores, at least 1
+int threadPool::hardwareThreads() {
+	unsigned int cores = thread::hardware_concurrency();
+	return cores == 0 ? 1 : (int)cores;
+}
+
+//---------------------------------------------------------------------------
+// workerLoop()
+// Postcondition: Runs tasks until the pool is destroyed
+void threadPool::workerLoop() {
+	for (;;) {
+		function<void()> task;
+		{
+			unique_lock<mutex> guard(lock);
+			taskReady.wait(guard, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty()) {
+				return;
+			}
+			task = move(tasks.front());
+			tasks.pop_front();
+			running++;
+		}
+		task();
+		{
+			unique_lock<mutex> guard(lock);
+			running--;
+			if (tasks.empty() && running == 0) {
+				allDone.notify_all();
+			}
+		}
+	}
+}
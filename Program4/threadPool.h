@@ -0,0 +1,68 @@
+// threadPool.h
+// Author: Terence Ho
+//
+// This file describes a fixed set of worker threads that run queued tasks.
+// The pool is created once and reused, so splitting an image into tiles
+// does not pay for starting threads every time.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class threadPool {
+public:
+	// threadPool()
+	// Precondition: threads is the number of workers, 0 uses one per core
+	// Postcondition: Workers are started and wait for tasks
+	explicit threadPool(int threads = 0);
+
+	// ~threadPool()
+	// Postcondition: Waits for the queued tasks and joins the workers
+	~threadPool();
+
+	threadPool(const threadPool &) = delete;
+	threadPool& operator=(const threadPool &) = delete;
+
+	// submit()
+	// Precondition: task can run on any thread
+	// Postcondition: task is queued for the next free worker
+	void submit(function<void()> task);
+
+	// wait()
+	// Postcondition: Returns once every submitted task has finished
+	void wait();
+
+	// parallelFor()
+	// Precondition: body can be called from several threads at once
+	// Postcondition: body(i) has run for every i from 0 to count - 1.
+	//				  Tasks other callers queued may still be running.
+	void parallelFor(int count, const function<void(int)> &body);
+
+	// getThreads()
+	// Postcondition: Returns the number of workers
+	int getThreads() const;
+
+	// hardwareThreads()
+	// Postcondition: Returns the number of cores, at least 1
+	static int hardwareThreads();
+
+private:
+	vector<thread> workers;
+	deque<function<void()>> tasks;
+	mutex lock;
+	condition_variable taskReady;
+	condition_variable allDone;
+	int running;			// tasks taken by a worker but not finished
+	bool stopping;
+
+	// workerLoop()
+	// Postcondition: Runs tasks until the pool is destroyed
+	void workerLoop();
+};
@@ -0,0 +1,180 @@
+// thresholdSweep.cpp
+// Author: Terence Ho
+//
+// First pass labelling at the lowest threshold, then the heavier edges
+// sorted by colour distance with a counting sort and replayed into a
+// union-find forest one threshold slice at a time.
+//---------------------------------------------------------------------------
+#include "thresholdSweep.h"
+#include "componentLabel.h"
+#include "metrics.h"
+#include <algorithm>
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// thresholdSweep()
+// Creates a sweep with no image
+thresholdSweep::thresholdSweep() : image(nullptr), lowest(1),
+	lowestRegions(0), threshold(1), regions(0) {
+}
+
+//---------------------------------------------------------------------------
+// build()
+// Precondition: input is a valid image that outlives the sweep, or
+//				 until build is called again, lowest is at least 1
+// Postcondition: The edges of input are sorted by colour distance and
+//				  the threshold is lowest, the smallest one it can take
+void thresholdSweep::build(const imageClass &input, int lowestThreshold) {
+	image = &input;
+	lowest = lowestThreshold < 1 ? 1 : lowestThreshold;
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	provisional.reset(rows, cols);
+	lowestSets.clear();
+	edges.clear();
+	firstEdge.assign(MAX_COLOR_DISTANCE + 2, 0);
+	if (rows > 0 && cols > 0) {
+		lowestSets.reserve((size_t)rows * cols / 4 + 1);
+		labelRect(input, provisional, 0, 0, rows - 1, cols - 1, lowest,
+			lowestSets);
+	}
+	lowestRegions = 0;
+	for (uint32_t id = 0; id < lowestSets.size(); id++) {
+		if (lowestSets.find(id) == id) {
+			lowestRegions++;
+		}
+	}
+
+	// an edge only matters if its pixels have different provisional
+	// labels. Distances are small integers, so one pass counts each
+	// distance and a second places every edge straight into its slot.
+	auto scan = [&](auto &&visit) {
+		for (int row = 0; row < rows; row++) {
+			const pixel *in = input.rowSpan(row);
+			const uint32_t *labelRow = provisional.rowSpan(row);
+			const pixel *below = nullptr;
+			const uint32_t *labelBelow = nullptr;
+			if (row + 1 < rows) {
+				below = input.rowSpan(row + 1);
+				labelBelow = provisional.rowSpan(row + 1);
+			}
+			for (int col = 0; col < cols; col++) {
+				if (col + 1 < cols && labelRow[col] != labelRow[col + 1]) {
+					int distance = colorDistance(in[col], in[col + 1]);
+					if (distance >= lowest) {
+						visit(distance, labelRow[col], labelRow[col + 1]);
+					}
+				}
+				if (below != nullptr && labelRow[col] != labelBelow[col]) {
+					int distance = colorDistance(in[col], below[col]);
+					if (distance >= lowest) {
+						visit(distance, labelRow[col], labelBelow[col]);
+					}
+				}
+			}
+		}
+	};
+	scan([&](int distance, uint32_t, uint32_t) {
+		firstEdge[distance + 1]++;
+	});
+	for (int distance = 0; distance <= MAX_COLOR_DISTANCE; distance++) {
+		firstEdge[distance + 1] += firstEdge[distance];
+	}
+	edges.resize(firstEdge[MAX_COLOR_DISTANCE + 1]);
+	vector<size_t> next(firstEdge.begin(), firstEdge.end() - 1);
+	scan([&](int distance, uint32_t a, uint32_t b) {
+		sweepEdge edge = { a, b };
+		edges[next[distance]++] = edge;
+	});
+	restart();
+}
+
+//---------------------------------------------------------------------------
+// setThreshold()
+// Postcondition: Pixels are joined across every edge whose distance is
+//				  less than threshold, which is raised to the lowest
+//				  threshold given to build if it is below it. Raising
+//				  the threshold only adds the edges in between, lowering
+//				  it starts again from the lowest.
+void thresholdSweep::setThreshold(int newThreshold) {
+	if (newThreshold < lowest) {
+		newThreshold = lowest;
+	}
+	if (newThreshold < threshold) {
+		restart();
+	}
+	size_t first = edgeCount(threshold);
+	size_t last = edgeCount(newThreshold);
+	for (size_t edge = first; edge < last; edge++) {
+		uint32_t a = sets.find(edges[edge].a);
+		uint32_t b = sets.find(edges[edge].b);
+		if (a != b) {
+			sets.unite(a, b);
+			regions--;
+		}
+	}
+	threshold = newThreshold;
+}
+
+//---------------------------------------------------------------------------
+// getThreshold()
+// Postcondition: Returns the current threshold
+int thresholdSweep::getThreshold() const {
+	return threshold;
+}
+
+//---------------------------------------------------------------------------
+// regionCount()
+// Postcondition: Returns the number of regions at the current threshold
+uint32_t thresholdSweep::regionCount() const {
+	return regions;
+}
+
+//---------------------------------------------------------------------------
+// edgeCount()
+// Postcondition: Returns the number of sorted edges lighter than
+//				  threshold, the ones setThreshold replays to reach it
+size_t thresholdSweep::edgeCount(int limit) const {
+	if (firstEdge.empty() || limit <= 0) {
+		return 0;
+	}
+	if (limit > MAX_COLOR_DISTANCE) {
+		return edges.size();
+	}
+	return firstEdge[limit];
+}
+
+//---------------------------------------------------------------------------
+// segment()
+// Precondition: build has been called
+// Postcondition: result holds the regions at the current threshold,
+//				  the same as segmentComponents with that threshold
+void thresholdSweep::segment(segmentationResult &result) {
+	stageTimer timer(STAGE_SEGMENT);
+	const int rows = provisional.getRow();
+	const int cols = provisional.getCol();
+	result.reset(rows, cols);
+	if (rows == 0 || cols == 0) {
+		return;
+	}
+	// the provisional labels are ids of sets, so resolveComponents numbers
+	// the regions in scan order just as segmentComponents does
+	labelMap &labels = result.getLabels();
+	for (int row = 0; row < rows; row++) {
+		const uint32_t *labelRow = provisional.rowSpan(row);
+		copy(labelRow, labelRow + cols, labels.rowSpan(row));
+	}
+	resolveComponents(*image, sets, result);
+	metricAdd(COUNTER_REGIONS, result.regionCount());
+}
+
+//---------------------------------------------------------------------------
+// restart()
+// Postcondition: The sets are those of the first pass and the
+//				  threshold is lowest
+void thresholdSweep::restart() {
+	sets = lowestSets;
+	regions = lowestRegions;
+	threshold = lowest;
+}
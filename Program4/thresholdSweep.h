@@ -0,0 +1,93 @@
+// thresholdSweep.h
+// Author: Terence Ho
+//
+// This file describes the threshold sweep, which segments one image at
+// many thresholds without labelling it again each time. Every pair of
+// 4-connected pixels is an edge weighted by their colour distance, and the
+// edges are sorted once by weight, as in Kruskal's spanning forest
+// algorithm. The regions at a threshold are then the union-find sets of
+// the edges lighter than it, so raising the threshold only replays the
+// next slice of the list. The region count at each threshold is known
+// straight away, and the full segmentation, the same as segmentComponents
+// gives, costs one pass to number the regions.
+//
+// The edges below the lowest threshold are joined up front by the first
+// pass of segmentComponents, so only the heavier edges between different
+// provisional labels are sorted and replayed. Smooth images keep few of
+// them.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "labelMap.h"
+#include "segmentation.h"
+#include "unionFind.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Two provisional labels joined once the threshold passes their distance
+struct sweepEdge {
+	uint32_t a;
+	uint32_t b;
+};
+
+class thresholdSweep {
+public:
+	// thresholdSweep()
+	// Creates a sweep with no image
+	thresholdSweep();
+
+	// build()
+	// Precondition: input is a valid image that outlives the sweep, or
+	//				 until build is called again, lowest is at least 1
+	// Postcondition: The edges of input are sorted by colour distance and
+	//				  the threshold is lowest, the smallest one it can take
+	void build(const imageClass &input, int lowest = 1);
+
+	// setThreshold()
+	// Postcondition: Pixels are joined across every edge whose distance is
+	//				  less than threshold, which is raised to the lowest
+	//				  threshold given to build if it is below it. Raising
+	//				  the threshold only adds the edges in between, lowering
+	//				  it starts again from the lowest.
+	void setThreshold(int threshold);
+
+	// getThreshold()
+	// Postcondition: Returns the current threshold
+	int getThreshold() const;
+
+	// regionCount()
+	// Postcondition: Returns the number of regions at the current threshold
+	uint32_t regionCount() const;
+
+	// edgeCount()
+	// Postcondition: Returns the number of sorted edges lighter than
+	//				  threshold, the ones setThreshold replays to reach it
+	size_t edgeCount(int threshold) const;
+
+	// segment()
+	// Precondition: build has been called
+	// Postcondition: result holds the regions at the current threshold,
+	//				  the same as segmentComponents with that threshold
+	void segment(segmentationResult &result);
+
+private:
+	const imageClass *image;
+	int lowest;
+	labelMap provisional;	// labels of the first pass at lowest
+	unionFind lowestSets;	// sets of the first pass at lowest
+	uint32_t lowestRegions;
+	vector<sweepEdge> edges;	// sorted by distance
+	vector<size_t> firstEdge;	// first edge of each distance, one more
+								// entry for the end
+	unionFind sets;
+	int threshold;
+	uint32_t regions;
+
+	// restart()
+	// Postcondition: The sets are those of the first pass and the
+	//				  threshold is lowest
+	void restart();
+};
@@ -0,0 +1,142 @@
+// tileSegment.cpp
+// Author: Terence Ho
+//
+// Tile-parallel connected-component labelling with seam merging.
+//---------------------------------------------------------------------------
+#include "tileSegment.h"
+#include "componentLabel.h"
+#include "metrics.h"
+#include "unionFind.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+struct Tile {
+	int top;
+	int left;
+	int bottom;			// last row, inclusive
+	int right;			// last column, inclusive
+	uint32_t labels;	// number of local labels after compaction
+	uint32_t offset;	// first shared label of the tile
+};
+
+//----------------------------------------------------------------------------
+// labelTile()
+// Precondition: tile lies inside input and labels
+// Postcondition: Pixels of the tile hold local labels 0 to tile.labels - 1,
+//				  numbered in the scan order of the tile
+void labelTile(const imageClass &input, labelMap &labels, int threshold,
+	Tile &tile) {
+	unionFind sets;
+	sets.reserve((size_t)(tile.bottom - tile.top + 1) *
+		(tile.right - tile.left + 1) / 4 + 1);
+	labelRect(input, labels, tile.top, tile.left, tile.bottom, tile.right,
+		threshold, sets);
+
+	vector<uint32_t> compact(sets.size(), NO_LABEL);
+	uint32_t next = 0;
+	for (int row = tile.top; row <= tile.bottom; row++) {
+		uint32_t *labelRow = labels.rowSpan(row);
+		for (int col = tile.left; col <= tile.right; col++) {
+			uint32_t root = sets.find(labelRow[col]);
+			if (compact[root] == NO_LABEL) {
+				compact[root] = next++;
+			}
+			labelRow[col] = compact[root];
+		}
+	}
+	tile.labels = next;
+}
+
+//----------------------------------------------------------------------------
+// offsetTile()
+// Precondition: labelTile has run on tile and tile.offset is set
+// Postcondition: Local labels of the tile are moved to the shared range
+void offsetTile(labelMap &labels, const Tile &tile) {
+	for (int row = tile.top; row <= tile.bottom; row++) {
+		uint32_t *labelRow = labels.rowSpan(row);
+		for (int col = tile.left; col <= tile.right; col++) {
+			labelRow[col] += tile.offset;
+		}
+	}
+}
+
+}
+
+//----------------------------------------------------------------------------
+// segmentTiles()
+// Precondition: input is a valid image, pool is a running thread pool
+// Postcondition: result holds the same regions as segmentComponents with
+//				  the same threshold, labelled tile by tile on pool
+void segmentTiles(const imageClass &input, segmentationResult &result,
+	threadPool &pool, int threshold) {
+	stageTimer timer(STAGE_SEGMENT);
+	const int rows = input.getRow();
+	const int cols = input.getCol();
+	result.reset(rows, cols);
+	if (rows == 0 || cols == 0) {
+		return;
+	}
+	labelMap &labels = result.getLabels();
+
+	vector<Tile> tiles;
+	for (int top = 0; top < rows; top += TILE_SIZE) {
+		for (int left = 0; left < cols; left += TILE_SIZE) {
+			Tile tile;
+			tile.top = top;
+			tile.left = left;
+			tile.bottom = min(top + TILE_SIZE, rows) - 1;
+			tile.right = min(left + TILE_SIZE, cols) - 1;
+			tile.labels = 0;
+			tile.offset = 0;
+			tiles.push_back(tile);
+		}
+	}
+
+	// label every tile on its own
+	pool.parallelFor((int)tiles.size(), [&](int index) {
+		labelTile(input, labels, threshold, tiles[index]);
+	});
+
+	// give each tile its own part of one label range
+	uint32_t total = 0;
+	for (Tile &tile : tiles) {
+		tile.offset = total;
+		total += tile.labels;
+	}
+	pool.parallelFor((int)tiles.size(), [&](int index) {
+		offsetTile(labels, tiles[index]);
+	});
+
+	// join labels across the seams between tiles
+	unionFind sets;
+	sets.reserve(total);
+	for (uint32_t label = 0; label < total; label++) {
+		sets.makeSet();
+	}
+	for (int row = 0; row < rows; row++) {
+		const pixel *in = input.rowSpan(row);
+		const uint32_t *labelRow = labels.rowSpan(row);
+		for (int col = TILE_SIZE; col < cols; col += TILE_SIZE) {
+			if (colorDistance(in[col], in[col - 1]) < threshold) {
+				sets.unite(labelRow[col], labelRow[col - 1]);
+			}
+		}
+	}
+	for (int row = TILE_SIZE; row < rows; row += TILE_SIZE) {
+		const pixel *in = input.rowSpan(row);
+		const pixel *above = input.rowSpan(row - 1);
+		const uint32_t *labelRow = labels.rowSpan(row);
+		const uint32_t *labelAbove = labels.rowSpan(row - 1);
+		for (int col = 0; col < cols; col++) {
+			if (colorDistance(in[col], above[col]) < threshold) {
+				sets.unite(labelRow[col], labelAbove[col]);
+			}
+		}
+	}
+
+	resolveComponents(input, sets, result);
+	metricAdd(COUNTER_REGIONS, result.regionCount());
+}
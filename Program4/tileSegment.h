@@ -0,0 +1,26 @@
+// tileSegment.h
+// Author: Terence Ho
+//
+// This file describes the tile-parallel labelling mode. The image is cut
+// into square tiles that are labelled independently on a thread pool with
+// the first pass of connected-component labelling. The tile labels are
+// then moved into one shared range, joined across the tile seams with a
+// union-find pass and resolved in scan order, so the regions are the same
+// as segmentComponents finds no matter how many threads are used.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "ImageClass.h"
+#include "segmentation.h"
+#include "threadPool.h"
+
+// Width and height of the tiles labelled by one task
+const int TILE_SIZE = 256;
+
+//----------------------------------------------------------------------------
+// segmentTiles()
+// Precondition: input is a valid image, pool is a running thread pool
+// Postcondition: result holds the same regions as segmentComponents with
+//				  the same threshold, labelled tile by tile on pool
+void segmentTiles(const imageClass &input, segmentationResult &result,
+	threadPool &pool, int threshold = SEED_THRESHOLD);
@@ -0,0 +1,88 @@
+// unionFind.cpp
+// Author: Terence Ho
+//
+// Disjoint set forest with path compression and union by rank.
+//---------------------------------------------------------------------------
+#include "unionFind.h"
+
+using namespace std;
+
+//---------------------------------------------------------------------------
+// unionFind()
+// Creates an empty forest
+unionFind::unionFind() {
+}
+
+//---------------------------------------------------------------------------
+// clear()
+// Postcondition: Removes every set, reserved memory is kept
+void unionFind::clear() {
+	parent.clear();
+	rank.clear();
+}
+
+//---------------------------------------------------------------------------
+// reserve()
+// Precondition: sets is the expected number of sets
+// Postcondition: That many sets can be made without reallocating
+void unionFind::reserve(size_t sets) {
+	parent.reserve(sets);
+	rank.reserve(sets);
+}
+
+//---------------------------------------------------------------------------
+// makeSet()
+// Postcondition: Returns the id of a new set holding only itself
+uint32_t unionFind::makeSet() {
+	uint32_t id = (uint32_t)parent.size();
+	parent.push_back(id);
+	rank.push_back(0);
+	return id;
+}
+
+//---------------------------------------------------------------------------
+// find()
+// Precondition: id was returned by makeSet
+// Postcondition: Returns the root of the set holding id, every node
+//				  on the way now points directly at the root
+uint32_t unionFind::find(uint32_t id) {
+	uint32_t root = id;
+	while (parent[root] != root) {
+		root = parent[root];
+	}
+	while (parent[id] != root) {
+		uint32_t next = parent[id];
+		parent[id] = root;
+		id = next;
+	}
+	return root;
+}
+
+//---------------------------------------------------------------------------
+// unite()
+// Precondition: a and b were returned by makeSet
+// Postcondition: The sets holding a and b are joined by rank,
+//				  returns the root of the joined set
+uint32_t unionFind::unite(uint32_t a, uint32_t b) {
+	a = find(a);
+	b = find(b);
+	if (a == b) {
+		return a;
+	}
+	if (rank[a] < rank[b]) {
+		parent[a] = b;
+		return b;
+	}
+	parent[b] = a;
+	if (rank[a] == rank[b]) {
+		rank[a]++;
+	}
+	return a;
+}
+
+//---------------------------------------------------------------------------
+// size()
+// Postcondition: Returns the number of ids made
+size_t unionFind::size() const {
+	return parent.size();
+}
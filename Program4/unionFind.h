@@ -0,0 +1,54 @@
+// unionFind.h
+// Author: Terence Ho
+//
+// This file describes a disjoint set forest used to join provisional
+// region labels. find() compresses the path it walks and unite() hangs the
+// shallower tree under the deeper one, so a sequence of operations costs
+// close to constant time each.
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+class unionFind {
+public:
+	// unionFind()
+	// Creates an empty forest
+	unionFind();
+
+	// clear()
+	// Postcondition: Removes every set, reserved memory is kept
+	void clear();
+
+	// reserve()
+	// Precondition: sets is the expected number of sets
+	// Postcondition: That many sets can be made without reallocating
+	void reserve(size_t sets);
+
+	// makeSet()
+	// Postcondition: Returns the id of a new set holding only itself
+	uint32_t makeSet();
+
+	// find()
+	// Precondition: id was returned by makeSet
+	// Postcondition: Returns the root of the set holding id, every node
+	//				  on the way now points directly at the root
+	uint32_t find(uint32_t id);
+
+	// unite()
+	// Precondition: a and b were returned by makeSet
+	// Postcondition: The sets holding a and b are joined by rank,
+	//				  returns the root of the joined set
+	uint32_t unite(uint32_t a, uint32_t b);
+
+	// size()
+	// Postcondition: Returns the number of ids made
+	size_t size() const;
+
+private:
+	vector<uint32_t> parent;
+	vector<uint8_t> rank;
+};